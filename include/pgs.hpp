@@ -21,3 +21,21 @@
 #pragma once
 
 #include "Subtitle.hpp"
+#include "DisplaySetInfo.hpp"
+#include "SubtitleEvent.hpp"
+#include "EventIndex.hpp"
+#include "ParseReport.hpp"
+#include "StreamCursor.hpp"
+#include "SupWriter.hpp"
+#include "TimeTransform.hpp"
+#include "StreamEditor.hpp"
+#include "StreamOptimizer.hpp"
+#include "ImageWriter.hpp"
+#include "BdnExporter.hpp"
+#include "VobSubWriter.hpp"
+#include "MatroskaReader.hpp"
+#include "TransportStreamReader.hpp"
+#include "DedupIndex.hpp"
+#include "PerceptualHash.hpp"
+#include "TextSegmenter.hpp"
+#include "FrameBlender.hpp"
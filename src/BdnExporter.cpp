@@ -0,0 +1,351 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#include "BdnExporter.hpp"
+#include "PgsUtil.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+using namespace Pgs;
+
+constexpr size_t BdnExporter::BATCH_SIZE;
+
+namespace
+{
+    /**
+     * \brief Frame rate of a PresentationComposition frame rate code.
+     */
+    struct FrameRate
+    {
+        const char *name; /**< Frame rate as written in BDN XML. */
+        uint32_t numerator;
+        uint32_t denominator;
+    };
+
+    FrameRate getFrameRate(const uint8_t &code)
+    {
+        switch (code)
+        {
+            case 0x20u:
+                return {"24", 24u, 1u};
+            case 0x30u:
+                return {"25", 25u, 1u};
+            case 0x40u:
+                return {"29.97", 30000u, 1001u};
+            case 0x60u:
+                return {"50", 50u, 1u};
+            case 0x70u:
+                return {"59.94", 60000u, 1001u};
+            case 0x10u:
+            default:
+                return {"23.976", 24000u, 1001u};
+        }
+    }
+
+    const char *getVideoFormat(const uint16_t &height)
+    {
+        if (height >= 1080u)
+        {
+            return "1080p";
+        }
+        if (height >= 720u)
+        {
+            return "720p";
+        }
+        if (height >= 576u)
+        {
+            return "576i";
+        }
+        return "480i";
+    }
+
+    string escapeXml(const string &text)
+    {
+        string escaped;
+        escaped.reserve(text.size());
+        for (const char &c : text)
+        {
+            switch (c)
+            {
+                case '&':
+                    escaped += "&amp;";
+                    break;
+                case '<':
+                    escaped += "&lt;";
+                    break;
+                case '>':
+                    escaped += "&gt;";
+                    break;
+                case '"':
+                    escaped += "&quot;";
+                    break;
+                default:
+                    escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    string getImageName(const size_t &index)
+    {
+        std::ostringstream name;
+        name << std::setw(5) << std::setfill('0') << index << ImageWriter::getExtension(ImageFormat::PNG);
+        return name.str();
+    }
+}
+
+BdnExporter::BdnExporter(const string &title, const string &languageCode, const unsigned &numThreads)
+{
+    this->title = title;
+    this->languageCode = languageCode;
+    this->numThreads = numThreads;
+}
+
+vector<Segment> BdnExporter::importSegments(const char *data, const DisplaySetInfo &displaySet)
+{
+    vector<Segment> segments;
+    const char *setStart = data + displaySet.getOffset();
+    uint64_t readPos = 0u;
+    while (readPos < displaySet.getSize())
+    {
+        Segment segment;
+        uint32_t readSize = 0u;
+        if (segment.tryImport(setStart + readPos, displaySet.getSize() - readPos, readSize) != ParseError::None)
+        {
+            break;
+        }
+        readPos += readSize;
+        segments.push_back(segment);
+    }
+
+    return segments;
+}
+
+shared_ptr<PaletteDefinition> BdnExporter::findPalette(const char *data, const vector<DisplaySetInfo> &displaySets,
+                                                       const uint32_t &index, const uint8_t &paletteID)
+{
+    for (uint32_t i = index + 1u; i-- > 0u;)
+    {
+        const auto &displaySet = displaySets[i];
+        if (displaySet.getNumPaletteDefinitions() > 0u)
+        {
+            for (const auto &segment : BdnExporter::importSegments(data, displaySet))
+            {
+                const auto pds = std::dynamic_pointer_cast<PaletteDefinition>(segment.getData());
+                if (pds && pds->getId() == paletteID)
+                {
+                    return pds;
+                }
+            }
+        }
+
+        if (displaySet.getPcs()->getCompositionState() == CompositionState::EpochStart)
+        {
+            break;
+        }
+    }
+
+    return nullptr;
+}
+
+shared_ptr<ObjectDefinition> BdnExporter::findObject(const char *data, const vector<DisplaySetInfo> &displaySets,
+                                                     const uint32_t &index, const uint16_t &objectID)
+{
+    for (uint32_t i = index + 1u; i-- > 0u;)
+    {
+        const auto &displaySet = displaySets[i];
+        const auto &objects = displaySet.getObjectDefinitions();
+        const bool defined = std::any_of(objects.begin(), objects.end(), [&](const shared_ptr<ObjectDefinition> &ods) {
+            return ods->getId() == objectID && ods->isFirstFragment();
+        });
+
+        if (defined)
+        {
+            shared_ptr<ObjectDefinition> object;
+            for (const auto &segment : BdnExporter::importSegments(data, displaySet))
+            {
+                const auto ods = std::dynamic_pointer_cast<ObjectDefinition>(segment.getData());
+                if (!ods || ods->getId() != objectID)
+                {
+                    continue;
+                }
+
+                if (ods->isFirstFragment())
+                {
+                    object = std::make_shared<ObjectDefinition>(*ods);
+                }
+                else if (object)
+                {
+                    object->appendFragment(*ods);
+                }
+            }
+            return object;
+        }
+
+        if (displaySet.getPcs()->getCompositionState() == CompositionState::EpochStart)
+        {
+            break;
+        }
+    }
+
+    return nullptr;
+}
+
+void BdnExporter::writeImage(const char *data, const vector<DisplaySetInfo> &displaySets, const SubtitleEvent &event,
+                             const string &path)
+{
+    const auto &index = event.getStartIndex();
+    const auto object = BdnExporter::findObject(data, displaySets, index, event.getObjectID());
+    if (!object)
+    {
+        throw WriteError("BdnExporter::writeImage: object definition of an event is missing.");
+    }
+
+    // Palette indices without a palette entry stay fully transparent.
+    std::array<std::array<uint8_t, 4>, 256> colorTable{};
+    const auto palette = BdnExporter::findPalette(data, displaySets, index,
+                                                  displaySets[index].getPcs()->getPaletteID());
+    if (palette)
+    {
+        for (const auto &entry : palette->getEntries())
+        {
+            colorTable[entry.first] = entry.second->getRGBA();
+        }
+    }
+
+    const auto &width = object->getWidth();
+    const auto &height = object->getHeight();
+    const auto lines = object->getDecodedObjectData();
+    vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4u, 0u);
+    for (size_t y = 0; y < std::min<size_t>(lines.size(), height); ++y)
+    {
+        uint8_t *out = pixels.data() + y * width * 4u;
+        for (size_t x = 0; x < std::min<size_t>(lines[y].size(), width); ++x)
+        {
+            std::copy(colorTable[lines[y][x]].begin(), colorTable[lines[y][x]].end(), out + x * 4u);
+        }
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        throw WriteError(("BdnExporter::writeImage: failed to open '" + path + "'.").c_str());
+    }
+    ImageWriter::write(file, pixels.data(), width, height, ImageFormat::PNG);
+}
+
+uint64_t BdnExporter::write(const char *data, const uint64_t &size, std::ostream &xml,
+                            const string &imageDirectory) const
+{
+    const auto displaySets = DisplaySetInfo::scanAll(data, size);
+
+    vector<SubtitleEvent> events;
+    for (const auto &event : SubtitleEvent::deriveAll(displaySets))
+    {
+        if (!event.isOpen() && event.getDuration() > 0u && event.getWidth() > 0u && event.getHeight() > 0u)
+        {
+            events.push_back(event);
+        }
+    }
+
+    uint16_t videoHeight = 1080u;
+    uint8_t frameRateCode = 0x10u;
+    if (!displaySets.empty())
+    {
+        videoHeight = displaySets.front().getPcs()->getHeight();
+        frameRateCode = displaySets.front().getPcs()->getFrameRate();
+    }
+    const auto frameRate = getFrameRate(frameRateCode);
+
+    xml << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        << "<BDN Version=\"0.93\" xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" "
+        << "xsi:noNamespaceSchemaLocation=\"BD-03-006-0093b BDN File Format.xsd\">\n"
+        << "  <Description>\n"
+        << "    <Name Title=\"" << escapeXml(this->title) << "\" Content=\"\"/>\n"
+        << "    <Language Code=\"" << escapeXml(this->languageCode) << "\"/>\n"
+        << "    <Format VideoFormat=\"" << getVideoFormat(videoHeight) << "\" FrameRate=\""
+        << frameRate.name << "\" DropFrame=\"False\"/>\n"
+        << "    <Events Type=\"Graphic\" FirstEventInTC=\""
+        << BdnExporter::toTimecode(events.empty() ? 0u : events.front().getStartTime(), frameRateCode)
+        << "\" LastEventOutTC=\""
+        << BdnExporter::toTimecode(events.empty() ? 0u : events.back().getEndTime(), frameRateCode)
+        << "\" NumberofEvents=\"" << events.size() << "\"/>\n"
+        << "  </Description>\n"
+        << "  <Events>\n";
+
+    const string directory = imageDirectory.empty() || imageDirectory.back() == '/' ? imageDirectory :
+                             imageDirectory + '/';
+
+    for (size_t batchStart = 0u; batchStart < events.size(); batchStart += BdnExporter::BATCH_SIZE)
+    {
+        const size_t batchEnd = std::min(events.size(), batchStart + BdnExporter::BATCH_SIZE);
+
+        parallelFor(batchStart, batchEnd, this->numThreads, [&](size_t i) {
+            BdnExporter::writeImage(data, displaySets, events[i], directory + getImageName(i));
+        });
+
+        for (size_t i = batchStart; i < batchEnd; ++i)
+        {
+            const auto &event = events[i];
+            xml << "    <Event InTC=\"" << BdnExporter::toTimecode(event.getStartTime(), frameRateCode)
+                << "\" OutTC=\"" << BdnExporter::toTimecode(event.getEndTime(), frameRateCode)
+                << "\" Forced=\"" << (event.getForcedFlag() ? "True" : "False") << "\">\n"
+                << "      <Graphic Width=\"" << event.getWidth() << "\" Height=\"" << event.getHeight()
+                << "\" X=\"" << event.getHPos() << "\" Y=\"" << event.getVPos() << "\">" << getImageName(i)
+                << "</Graphic>\n"
+                << "    </Event>\n";
+        }
+    }
+
+    xml << "  </Events>\n"
+        << "</BDN>\n";
+    if (!xml)
+    {
+        throw WriteError("BdnExporter::write: failed to write the XML document.");
+    }
+
+    return events.size();
+}
+
+string BdnExporter::toTimecode(const uint32_t &time, const uint8_t &frameRate)
+{
+    const auto rate = getFrameRate(frameRate);
+    const uint32_t nominalRate = (rate.numerator + rate.denominator - 1u) / rate.denominator;
+
+    // Timecodes follow the clock; the frame count only covers the fraction of a second.
+    const uint32_t seconds = time / 90000u;
+    const uint64_t remainder = time % 90000u;
+    const auto frame = static_cast<uint32_t>(
+            std::min<uint64_t>((remainder * rate.numerator) / (90000u * static_cast<uint64_t>(rate.denominator)),
+                               nominalRate - 1u));
+
+    std::ostringstream timecode;
+    timecode << std::setfill('0') << std::setw(2) << seconds / 3600u << ':' << std::setw(2) << (seconds / 60u) % 60u
+             << ':' << std::setw(2) << seconds % 60u << ':' << std::setw(2) << frame;
+    return timecode.str();
+}
@@ -0,0 +1,124 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#pragma once
+
+#include "DisplaySetInfo.hpp"
+#include "SubtitleEvent.hpp"
+#include "PaletteDefinition.hpp"
+#include "ImageWriter.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Pgs
+{
+    /**
+     * \brief Exports PGS streams as BDN XML with one PNG image per event, as used by Blu-ray authoring tools.
+     *
+     * \details
+     * Events are derived from a header-only scan of the stream (see SubtitleEvent::deriveAll), so positions and
+     * in/out times come straight from the PresentationComposition and CompositionObject of each event. Images are
+     * then decoded and written in batches, each batch spread over several threads, and the XML entries of a batch
+     * are written once its images are done. Only one batch of images is held in memory at a time, no matter how
+     * long the stream is.
+     * <br/><br/>Images are named after the position of their event in the XML, e.g. "00042.png", so exporting the
+     * same stream twice produces the same files.
+     */
+    class BdnExporter
+    {
+    protected:
+        std::string title; /**< Title written to the XML description. */
+        std::string languageCode; /**< ISO 639-2 language code written to the XML description. */
+        unsigned numThreads; /**< Number of threads rendering images, or 0 for one per hardware thread. */
+
+        /**
+         * \brief Imports every segment of a display set.
+         * \param data pointer to the raw PGS data the display set was scanned from
+         * \param displaySet display set to import
+         * \return imported segments, in stream order
+         */
+        static std::vector<Segment> importSegments(const char *data, const DisplaySetInfo &displaySet);
+
+        /**
+         * \brief Finds the palette in use at a display set, looking back to the start of its epoch.
+         * \return palette, or nullptr if none was defined
+         */
+        static std::shared_ptr<PaletteDefinition> findPalette(const char *data,
+                                                              const std::vector<DisplaySetInfo> &displaySets,
+                                                              const uint32_t &index, const uint8_t &paletteID);
+
+        /**
+         * \brief Finds the object in use at a display set, looking back to the start of its epoch.
+         * \return complete object with all fragments joined, or nullptr if none was defined
+         */
+        static std::shared_ptr<ObjectDefinition> findObject(const char *data,
+                                                            const std::vector<DisplaySetInfo> &displaySets,
+                                                            const uint32_t &index, const uint16_t &objectID);
+
+        /**
+         * \brief Decodes the image of an event and writes it to a PNG file.
+         */
+        static void writeImage(const char *data, const std::vector<DisplaySetInfo> &displaySets,
+                               const SubtitleEvent &event, const std::string &path);
+    public:
+        /**
+         * \brief Number of events whose images are rendered before their XML entries are written.
+         */
+        static constexpr size_t BATCH_SIZE = 64u;
+
+        /**
+         * \brief Creates an exporter.
+         * \param title title written to the XML description
+         * \param languageCode ISO 639-2 language code written to the XML description
+         * \param numThreads number of threads rendering images, or 0 to use one per hardware thread
+         */
+        explicit BdnExporter(const std::string &title = "Undefined", const std::string &languageCode = "und",
+                             const unsigned &numThreads = 0u);
+
+        /**
+         * \brief Exports a PGS stream.
+         *
+         * \details
+         * Events that never end are left out, since BDN XML needs an out time for every event.
+         *
+         * \param data pointer to raw PGS data
+         * \param size number of bytes in the data array
+         * \param xml stream receiving the XML document
+         * \param imageDirectory directory the images are written to. Must already exist.
+         * \return number of events exported
+         *
+         * \throws WriteError if the XML or an image can't be written.
+         */
+        uint64_t write(const char *data, const uint64_t &size, std::ostream &xml,
+                       const std::string &imageDirectory) const;
+
+        /**
+         * \brief Converts a time to a SMPTE timecode (HH:MM:SS:FF).
+         * \param time time with 90kHz accuracy
+         * \param frameRate frame rate code as stored in the PresentationComposition
+         * \return timecode string
+         */
+        static std::string toTimecode(const uint32_t &time, const uint8_t &frameRate);
+    };
+}
@@ -0,0 +1,162 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace Pgs
+{
+    /**
+     * \brief Loads a 16-bit big-endian value from a possibly unaligned address.
+     * \param data pointer to the first byte of the value
+     * \return value in host byte order
+     */
+    inline uint16_t loadBigEndian16(const uint8_t *data) noexcept
+    {
+#if defined(__GNUC__) && defined(__BYTE_ORDER__)
+        uint16_t value;
+        std::memcpy(&value, data, sizeof(value));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        value = __builtin_bswap16(value);
+#endif
+        return value;
+#else
+        return static_cast<uint16_t>((data[0] << 8u) | data[1]);
+#endif
+    }
+
+    /**
+     * \brief Loads a 32-bit big-endian value from a possibly unaligned address.
+     * \param data pointer to the first byte of the value
+     * \return value in host byte order
+     */
+    inline uint32_t loadBigEndian32(const uint8_t *data) noexcept
+    {
+#if defined(__GNUC__) && defined(__BYTE_ORDER__)
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        value = __builtin_bswap32(value);
+#endif
+        return value;
+#else
+        return (static_cast<uint32_t>(data[0]) << 24u) | (static_cast<uint32_t>(data[1]) << 16u) |
+               (static_cast<uint32_t>(data[2]) << 8u) | data[3];
+#endif
+    }
+
+    /**
+     * \brief Loads a 24-bit big-endian value from a possibly unaligned address.
+     * \param data pointer to the first byte of the value
+     * \return value in host byte order
+     */
+    inline uint32_t loadBigEndian24(const uint8_t *data) noexcept
+    {
+        return (static_cast<uint32_t>(data[0]) << 16u) | loadBigEndian16(data + 1);
+    }
+
+    /**
+     * \brief Sequential big-endian reader over the data of a single segment.
+     *
+     * \details
+     * The read functions don't check bounds. Callers check the number of bytes they're about to read with canRead()
+     * once per fixed-size block of fields (a segment header, the fixed part of a PCS, a composition object, ...) and
+     * then read each field without further branching.
+     */
+    class ByteReader
+    {
+    protected:
+        const uint8_t *data; /**< Pointer to the first readable byte. */
+        uint32_t size; /**< Number of readable bytes. */
+        uint32_t position; /**< Current read position, relative to data. */
+    public:
+        /**
+         * \brief Creates a reader over the provided data.
+         * \param data pointer to raw data array
+         * \param size number of bytes in the data array
+         * \param position initial read position
+         */
+        ByteReader(const char *data, const uint32_t &size, const uint32_t &position = 0u) noexcept
+                : data(reinterpret_cast<const uint8_t *>(data)), size(size), position(position)
+        {}
+
+        /**
+         * \brief Checks whether the requested number of bytes can be read from the current position.
+         * \param count number of bytes
+         * \return true if count bytes remain.
+         */
+        [[nodiscard]] bool canRead(const uint32_t &count) const noexcept
+        {
+            return this->position <= this->size && count <= this->size - this->position;
+        }
+
+        uint8_t read8() noexcept
+        {
+            return this->data[this->position++];
+        }
+
+        uint16_t read16() noexcept
+        {
+            const uint16_t value = loadBigEndian16(this->data + this->position);
+            this->position += 2u;
+            return value;
+        }
+
+        uint32_t read24() noexcept
+        {
+            const uint32_t value = loadBigEndian24(this->data + this->position);
+            this->position += 3u;
+            return value;
+        }
+
+        uint32_t read32() noexcept
+        {
+            const uint32_t value = loadBigEndian32(this->data + this->position);
+            this->position += 4u;
+            return value;
+        }
+
+        void skip(const uint32_t &count) noexcept
+        {
+            this->position += count;
+        }
+
+        // =======
+        // Getters
+        // =======
+
+        [[nodiscard]] const uint8_t *getCurrent() const noexcept
+        {
+            return this->data + this->position;
+        }
+
+        [[nodiscard]] const uint32_t &getPosition() const noexcept
+        {
+            return this->position;
+        }
+
+        [[nodiscard]] uint32_t getRemaining() const noexcept
+        {
+            return this->position < this->size ? this->size - this->position : 0u;
+        }
+    };
+}
@@ -0,0 +1,140 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace Pgs
+{
+    /**
+     * \brief Stores a 16-bit value in big-endian byte order at a possibly unaligned address.
+     * \param data pointer to the first byte of the destination
+     * \param value value in host byte order
+     */
+    inline void storeBigEndian16(uint8_t *data, uint16_t value) noexcept
+    {
+#if defined(__GNUC__) && defined(__BYTE_ORDER__)
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        value = __builtin_bswap16(value);
+#endif
+        std::memcpy(data, &value, sizeof(value));
+#else
+        data[0] = static_cast<uint8_t>(value >> 8u);
+        data[1] = static_cast<uint8_t>(value);
+#endif
+    }
+
+    /**
+     * \brief Stores a 32-bit value in big-endian byte order at a possibly unaligned address.
+     * \param data pointer to the first byte of the destination
+     * \param value value in host byte order
+     */
+    inline void storeBigEndian32(uint8_t *data, uint32_t value) noexcept
+    {
+#if defined(__GNUC__) && defined(__BYTE_ORDER__)
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        value = __builtin_bswap32(value);
+#endif
+        std::memcpy(data, &value, sizeof(value));
+#else
+        data[0] = static_cast<uint8_t>(value >> 24u);
+        data[1] = static_cast<uint8_t>(value >> 16u);
+        data[2] = static_cast<uint8_t>(value >> 8u);
+        data[3] = static_cast<uint8_t>(value);
+#endif
+    }
+
+    /**
+     * \brief Sequential big-endian writer appending to a byte buffer.
+     *
+     * \details
+     * This is the counterpart of ByteReader used when serializing segments. Values are appended to the end of the
+     * buffer, which grows as needed.
+     */
+    class ByteWriter
+    {
+    protected:
+        std::vector<uint8_t> &buffer; /**< Buffer receiving the written bytes. */
+    public:
+        /**
+         * \brief Creates a writer appending to the provided buffer.
+         * \param buffer buffer to append to. Must outlive the writer.
+         */
+        explicit ByteWriter(std::vector<uint8_t> &buffer) noexcept : buffer(buffer)
+        {}
+
+        void write8(const uint8_t &value)
+        {
+            this->buffer.push_back(value);
+        }
+
+        void write16(const uint16_t &value)
+        {
+            const size_t position = this->buffer.size();
+            this->buffer.resize(position + 2u);
+            storeBigEndian16(this->buffer.data() + position, value);
+        }
+
+        void write24(const uint32_t &value)
+        {
+            this->write8(static_cast<uint8_t>(value >> 16u));
+            this->write16(static_cast<uint16_t>(value));
+        }
+
+        void write32(const uint32_t &value)
+        {
+            const size_t position = this->buffer.size();
+            this->buffer.resize(position + 4u);
+            storeBigEndian32(this->buffer.data() + position, value);
+        }
+
+        void writeBytes(const uint8_t *data, const size_t &size)
+        {
+            this->buffer.insert(this->buffer.end(), data, data + size);
+        }
+
+        /**
+         * \brief Overwrites a previously written 16-bit value.
+         *
+         * \details
+         * This is used for size fields that are only known after the data following them has been written.
+         *
+         * \param position position of the value within the buffer
+         * \param value new value
+         */
+        void patch16(const size_t &position, const uint16_t &value) noexcept
+        {
+            storeBigEndian16(this->buffer.data() + position, value);
+        }
+
+        /**
+         * \brief Gets the position the next value will be written at.
+         * \return number of bytes in the buffer
+         */
+        [[nodiscard]] size_t getPosition() const noexcept
+        {
+            return this->buffer.size();
+        }
+    };
+}
@@ -0,0 +1,151 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#include "DedupIndex.hpp"
+#include "PgsUtil.hpp"
+
+#include <stdexcept>
+#include <unordered_map>
+
+using std::shared_ptr;
+using std::vector;
+
+using namespace Pgs;
+
+constexpr uint32_t DedupIndex::NO_INDEX;
+
+namespace
+{
+    /**
+     * \brief Serializes the palette of a Subtitle as index, Y, Cr, Cb and alpha bytes per entry.
+     */
+    vector<uint8_t> getPaletteBytes(const Subtitle &subtitle)
+    {
+        vector<uint8_t> bytes;
+        const auto palette = subtitle.getPds();
+        if (!palette)
+        {
+            return bytes;
+        }
+
+        bytes.reserve(palette->getEntries().size() * 5u);
+        for (const auto &entry : palette->getEntries())
+        {
+            bytes.push_back(entry.first);
+            const auto color = entry.second->getYCrCbA();
+            bytes.insert(bytes.end(), color.begin(), color.end());
+        }
+        return bytes;
+    }
+
+    bool isSameImage(const Subtitle &lhs, const Subtitle &rhs, const bool &includePalette)
+    {
+        const auto lhsObject = lhs.getOds(0u);
+        const auto rhsObject = rhs.getOds(0u);
+        if (lhsObject->getWidth() != rhsObject->getWidth() || lhsObject->getHeight() != rhsObject->getHeight())
+        {
+            return false;
+        }
+        if (includePalette && getPaletteBytes(lhs) != getPaletteBytes(rhs))
+        {
+            return false;
+        }
+
+        // Objects are only joined when one of them is split.
+        if (lhs.getOds(1u) == nullptr && rhs.getOds(1u) == nullptr)
+        {
+            return lhsObject->getEncodedObjectData() == rhsObject->getEncodedObjectData();
+        }
+        return lhs.getEncodedImageData() == rhs.getEncodedImageData();
+    }
+}
+
+DedupIndex::DedupIndex(const vector<shared_ptr<Subtitle>> &subtitles, const bool &includePalette)
+{
+    if (subtitles.size() >= NO_INDEX)
+    {
+        throw std::length_error("DedupIndex: too many subtitles.");
+    }
+
+    this->canonicalIndices.assign(subtitles.size(), NO_INDEX);
+    this->hashes.assign(subtitles.size(), 0u);
+
+    // Canonical indices by hash. Almost always a single one, unless different images collide.
+    std::unordered_map<uint64_t, vector<uint32_t>> candidates;
+    candidates.reserve(subtitles.size());
+
+    for (uint32_t i = 0; i < subtitles.size(); ++i)
+    {
+        const auto &subtitle = subtitles[i];
+        if (!subtitle || !subtitle->containsImage() || !subtitle->getOds(0u))
+        {
+            continue;
+        }
+
+        uint64_t hash = subtitle->getContentHash();
+        if (includePalette)
+        {
+            const auto palette = getPaletteBytes(*subtitle);
+            hash = hashBytes(palette.data(), palette.size(), hash);
+        }
+        this->hashes[i] = hash;
+
+        auto &matches = candidates[hash];
+        for (const auto &candidate : matches)
+        {
+            if (isSameImage(*subtitles[candidate], *subtitle, includePalette))
+            {
+                this->canonicalIndices[i] = candidate;
+                break;
+            }
+        }
+
+        if (this->canonicalIndices[i] == NO_INDEX)
+        {
+            this->canonicalIndices[i] = i;
+            this->uniqueIndices.push_back(i);
+            matches.push_back(i);
+        }
+    }
+}
+
+const uint32_t &DedupIndex::getCanonicalIndex(const uint32_t &index) const
+{
+    return this->canonicalIndices.at(index);
+}
+
+// =======
+// Getters
+// =======
+
+const vector<uint32_t> &DedupIndex::getCanonicalIndices() const noexcept
+{
+    return this->canonicalIndices;
+}
+
+const vector<uint32_t> &DedupIndex::getUniqueIndices() const noexcept
+{
+    return this->uniqueIndices;
+}
+
+const vector<uint64_t> &DedupIndex::getHashes() const noexcept
+{
+    return this->hashes;
+}
@@ -0,0 +1,88 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#pragma once
+
+#include "Subtitle.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Pgs
+{
+    /**
+     * \brief Maps every Subtitle of a stream to the first Subtitle showing the same image.
+     *
+     * \details
+     * Songs, signs and repeated lines show the same image many times. With the index, decoding or OCR only has to
+     * run once per unique image, i.e. for getUniqueIndices(), and the result can be looked up for every other Subtitle
+     * through getCanonicalIndex().
+     * <br/><br/>Images are matched through Subtitle::getContentHash, so nothing is decoded. Subtitles with the same
+     * hash are compared byte for byte before being merged, so hash collisions never merge different images.
+     */
+    class DedupIndex
+    {
+    protected:
+        std::vector<uint32_t> canonicalIndices; /**< Index of the canonical Subtitle of every Subtitle. */
+        std::vector<uint32_t> uniqueIndices; /**< Indices of the canonical Subtitles, in ascending order. */
+        std::vector<uint64_t> hashes; /**< Content hash of every Subtitle. */
+
+    public:
+        /**
+         * \brief Value used for Subtitles without an image.
+         */
+        static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+        /**
+         * \brief Creates an empty DedupIndex.
+         */
+        DedupIndex() = default;
+
+        /**
+         * \brief Indexes the images of the provided Subtitles.
+         * \param subtitles subtitles in stream order, e.g. from Subtitle::createAll
+         * \param includePalette set to true to only merge images that are also shown with the same palette, for
+         * deduplicating decoded color images rather than palette indices.
+         */
+        explicit DedupIndex(const std::vector<std::shared_ptr<Subtitle>> &subtitles,
+                            const bool &includePalette = false);
+
+        /**
+         * \brief Gets the index of the first Subtitle showing the same image as the provided one.
+         * \param index index of a Subtitle
+         * \return index of the canonical Subtitle, which is index itself for the first occurrence of an image, or
+         * NO_INDEX if the Subtitle doesn't contain an image.
+         *
+         * \throws std::out_of_range if index isn't an indexed Subtitle.
+         */
+        [[nodiscard]] const uint32_t &getCanonicalIndex(const uint32_t &index) const;
+
+        // =======
+        // Getters
+        // =======
+
+        [[nodiscard]] const std::vector<uint32_t> &getCanonicalIndices() const noexcept;
+
+        [[nodiscard]] const std::vector<uint32_t> &getUniqueIndices() const noexcept;
+
+        [[nodiscard]] const std::vector<uint64_t> &getHashes() const noexcept;
+    };
+}
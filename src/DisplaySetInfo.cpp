@@ -0,0 +1,226 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#include "DisplaySetInfo.hpp"
+
+using std::shared_ptr;
+using std::vector;
+
+using namespace Pgs;
+
+DisplaySetInfo::DisplaySetInfo()
+{
+    this->offset = 0u;
+    this->size = 0u;
+    this->presentationTime = 0u;
+    this->decodingTime = 0u;
+    this->presentationComposition = shared_ptr<PresentationComposition>();
+    this->windowDefinition = shared_ptr<WindowDefinition>();
+    this->objectDefinitions = vector<shared_ptr<ObjectDefinition>>();
+    this->numPaletteDefinitions = 0u;
+}
+
+vector<DisplaySetInfo> DisplaySetInfo::scanAll(const char *data, const uint64_t &size)
+{
+    ParseReport report;
+    return DisplaySetInfo::scanAll(data, size, report);
+}
+
+vector<DisplaySetInfo> DisplaySetInfo::scanAll(const char *data, const uint64_t &size, ParseReport &report)
+{
+    auto displaySets = vector<DisplaySetInfo>();
+    if (data == nullptr || size == 0)
+    {
+        report.add(ParseDiagnostic(0u, 0u, SegmentType::PresentationComposition, ParseError::NoData));
+        return displaySets;
+    }
+
+    /*
+     * Walk the stream one segment header at a time. Every segment's size is known from its header, so the payloads
+     * that aren't needed (PDS and the RLE data of each ODS) are skipped over without being touched.
+     */
+    DisplaySetInfo current;
+    bool inDisplaySet = false;
+    bool damaged = false;
+    uint64_t readPos = 0u;
+    while (readPos + Segment::MIN_BYTE_SIZE <= size)
+    {
+        readPos = Segment::findNext(data, size, readPos);
+        if (readPos >= size)
+        {
+            break;
+        }
+
+        Segment segment;
+        uint16_t headerSize = 0u;
+        if (segment.tryImportHeader(data + readPos, size - readPos, headerSize) != ParseError::None)
+        {
+            break;
+        }
+        const uint64_t segmentEnd = readPos + headerSize + segment.getSegmentSize();
+        if (segmentEnd > size)
+        {
+            report.add(ParseDiagnostic(inDisplaySet ? current.offset : readPos, readPos, segment.getSegmentType(),
+                                       ParseError::TruncatedSegment));
+            break;
+        }
+
+        const char *segmentData = data + readPos + headerSize;
+        const uint16_t &segmentSize = segment.getSegmentSize();
+        if (segment.getSegmentType() == SegmentType::PresentationComposition && inDisplaySet && !damaged)
+        {
+            // A PCS always opens a display set, even if the previous one was missing its End segment.
+            report.add(ParseDiagnostic(current.offset, readPos, SegmentType::EndOfDisplaySet,
+                                       ParseError::IncompleteDisplaySet));
+        }
+        if (!inDisplaySet || segment.getSegmentType() == SegmentType::PresentationComposition)
+        {
+            current = DisplaySetInfo();
+            current.offset = readPos;
+            inDisplaySet = true;
+            damaged = false;
+        }
+
+        uint16_t readSize = 0u;
+        auto error = ParseError::None;
+        switch (segment.getSegmentType())
+        {
+            case SegmentType::PresentationComposition:
+                current.presentationComposition = std::make_shared<PresentationComposition>();
+                error = current.presentationComposition->tryImport(segmentData, segmentSize, readSize);
+                break;
+            case SegmentType::WindowDefinition:
+                current.windowDefinition = std::make_shared<WindowDefinition>();
+                error = current.windowDefinition->tryImport(segmentData, segmentSize, readSize);
+                break;
+            case SegmentType::PaletteDefinition:
+                ++current.numPaletteDefinitions;
+                break;
+            case SegmentType::ObjectDefinition:
+            {
+                auto ods = std::make_shared<ObjectDefinition>();
+                error = ods->tryImportHeader(segmentData, segmentSize, readSize);
+                current.objectDefinitions.push_back(ods);
+                break;
+            }
+            case SegmentType::EndOfDisplaySet:
+                current.presentationTime = segment.getPresentationTimestamp();
+                current.decodingTime = segment.getDecodingTimestamp();
+                current.size = static_cast<uint32_t>(segmentEnd - current.offset);
+                if (current.presentationComposition && !damaged)
+                {
+                    displaySets.push_back(current);
+                }
+                inDisplaySet = false;
+                break;
+            default:
+                break;
+        }
+
+        if (error != ParseError::None && !damaged)
+        {
+            // Drop the damaged display set and pick up again at the next one.
+            report.add(ParseDiagnostic(current.offset, readPos, segment.getSegmentType(), error));
+            damaged = true;
+        }
+
+        readPos = segmentEnd;
+    }
+
+    if (inDisplaySet && !damaged && current.presentationComposition)
+    {
+        report.add(ParseDiagnostic(current.offset, readPos, SegmentType::EndOfDisplaySet,
+                                   ParseError::IncompleteDisplaySet));
+    }
+
+    return displaySets;
+}
+
+// =======
+// Getters
+// =======
+
+const uint64_t &DisplaySetInfo::getOffset() const noexcept
+{
+    return this->offset;
+}
+
+const uint32_t &DisplaySetInfo::getSize() const noexcept
+{
+    return this->size;
+}
+
+const uint32_t &DisplaySetInfo::getPresentationTime() const noexcept
+{
+    return this->presentationTime;
+}
+
+uint32_t DisplaySetInfo::getPresentationTimeMs() const noexcept
+{
+    return this->presentationTime / 90;
+}
+
+const uint32_t &DisplaySetInfo::getDecodingTime() const noexcept
+{
+    return this->decodingTime;
+}
+
+shared_ptr<PresentationComposition> DisplaySetInfo::getPcs() const noexcept
+{
+    return this->presentationComposition;
+}
+
+shared_ptr<WindowDefinition> DisplaySetInfo::getWds() const noexcept
+{
+    return this->windowDefinition;
+}
+
+const vector<shared_ptr<ObjectDefinition>> &DisplaySetInfo::getObjectDefinitions() const noexcept
+{
+    return this->objectDefinitions;
+}
+
+const uint8_t &DisplaySetInfo::getNumPaletteDefinitions() const noexcept
+{
+    return this->numPaletteDefinitions;
+}
+
+bool DisplaySetInfo::containsImage() const noexcept
+{
+    return this->presentationComposition && this->presentationComposition->getCompositionObjectCount() > 0;
+}
+
+bool DisplaySetInfo::containsForcedImage() const noexcept
+{
+    if (!this->presentationComposition)
+    {
+        return false;
+    }
+
+    for (const auto &compositionObject : this->presentationComposition->getCompositionObjects())
+    {
+        if (compositionObject->getForcedFlag())
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,139 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#pragma once
+
+#include "Segment.hpp"
+#include "PresentationComposition.hpp"
+#include "WindowDefinition.hpp"
+#include "ObjectDefinition.hpp"
+#include "ParseReport.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Pgs
+{
+    /**
+     * \brief Timing and geometry of a single display set, gathered without importing any image data.
+     *
+     * \details
+     * A DisplaySetInfo is produced by a header-only scan of a PGS stream. The PresentationComposition and
+     * WindowDefinition segments are fully imported since they are small, but ObjectDefinition segments only have
+     * their header fields read and their RLE payloads are skipped. PaletteDefinition segments are only counted.
+     * <br/><br/>The offset and size of the display set are kept so that the original bytes can be located again
+     * later on, e.g. to import the full Subtitle with Subtitle::create.
+     */
+    class DisplaySetInfo
+    {
+    protected:
+        uint64_t offset; /**< Byte offset of the first segment of the display set within the scanned data. */
+        uint32_t size; /**< Number of bytes from the first segment up to and including the End segment. */
+        uint32_t presentationTime; /**< Presentation time of the display set with 90kHz accuracy. */
+        uint32_t decodingTime; /**< Decoding time of the display set with 90kHz accuracy. */
+        std::shared_ptr<PresentationComposition> presentationComposition; /**< Imported composition segment. */
+        std::shared_ptr<WindowDefinition> windowDefinition; /**< Imported window segment, if present. */
+        std::vector<std::shared_ptr<ObjectDefinition>> objectDefinitions; /**< Header-only object definitions. */
+        uint8_t numPaletteDefinitions; /**< Number of palette segments that were skipped. */
+
+    public:
+        /**
+         * \brief Creates a new, empty DisplaySetInfo instance.
+         */
+        DisplaySetInfo();
+
+        /**
+         * \brief Scans the provided data for display sets without decoding or copying any object data.
+         *
+         * \details
+         * Only segment headers, PCS and WDS fields, and the ODS headers are read. Display sets that cannot be read
+         * are skipped and scanning continues from the next segment.
+         *
+         * \param data pointer to raw data array
+         * \param size number of bytes in the data array
+         * \return vector containing one entry per complete display set, in stream order.
+         */
+        static std::vector<DisplaySetInfo> scanAll(const char *data, const uint64_t &size);
+
+        /**
+         * \brief Scans the provided data for display sets without decoding or copying any object data.
+         * \param data pointer to raw data array
+         * \param size number of bytes in the data array
+         * \param report report receiving one diagnostic per skipped display set
+         * \return vector containing one entry per complete display set, in stream order.
+         */
+        static std::vector<DisplaySetInfo> scanAll(const char *data, const uint64_t &size, ParseReport &report);
+
+        // =======
+        // Getters
+        // =======
+
+        [[nodiscard]] const uint64_t &getOffset() const noexcept;
+
+        [[nodiscard]] const uint32_t &getSize() const noexcept;
+
+        /**
+         * \brief Retrieves the presentationTime exactly as it's stored in this instance.
+         * \return presentationTime with 90kHz accuracy
+         */
+        [[nodiscard]] const uint32_t &getPresentationTime() const noexcept;
+
+        /**
+         * \brief Retrieves the presentationTime as a millisecond value.
+         * \return presentationTime with millisecond accuracy
+         */
+        [[nodiscard]] uint32_t getPresentationTimeMs() const noexcept;
+
+        /**
+         * \brief Retrieves the decodingTime exactly as it's stored in this instance.
+         * \return decodingTime with 90kHz accuracy
+         */
+        [[nodiscard]] const uint32_t &getDecodingTime() const noexcept;
+
+        [[nodiscard]] std::shared_ptr<PresentationComposition> getPcs() const noexcept;
+
+        [[nodiscard]] std::shared_ptr<WindowDefinition> getWds() const noexcept;
+
+        /**
+         * \brief Retrieves the header-only ObjectDefinitions found in this display set.
+         *
+         * \details
+         * The returned instances contain IDs, versions, sequence flags and dimensions, but no encoded object data.
+         *
+         * \return vector of ObjectDefinitions in stream order
+         */
+        [[nodiscard]] const std::vector<std::shared_ptr<ObjectDefinition>> &getObjectDefinitions() const noexcept;
+
+        [[nodiscard]] const uint8_t &getNumPaletteDefinitions() const noexcept;
+
+        /**
+         * \brief Quick check to confirm whether the display set shows anything.
+         * \return true if the composition references at least one object
+         */
+        [[nodiscard]] bool containsImage() const noexcept;
+
+        /**
+         * \brief Quick check to confirm whether the display set shows anything while subtitles are turned off.
+         * \return true if the composition references at least one forced object
+         */
+        [[nodiscard]] bool containsForcedImage() const noexcept;
+    };
+}
@@ -0,0 +1,278 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#include "EventIndex.hpp"
+
+#include <algorithm>
+
+using std::vector;
+
+using namespace Pgs;
+
+EventIndex::EventIndex()
+{
+    this->root = EventIndex::NO_NODE;
+}
+
+EventIndex::EventIndex(const vector<DisplaySetInfo> &displaySets) :
+        EventIndex(SubtitleEvent::deriveAll(displaySets), displaySets)
+{
+}
+
+EventIndex::EventIndex(vector<SubtitleEvent> events, const vector<DisplaySetInfo> &displaySets)
+{
+    this->events = std::move(events);
+
+    // Zero-length events are never visible, so they're left out of the tree.
+    auto eventIndices = vector<uint32_t>();
+    eventIndices.reserve(this->events.size());
+    for (uint32_t i = 0u; i < this->events.size(); ++i)
+    {
+        if (this->events[i].getEndTime() > this->events[i].getStartTime())
+        {
+            eventIndices.push_back(i);
+        }
+    }
+
+    this->byStart.reserve(eventIndices.size());
+    this->byEnd.reserve(eventIndices.size());
+    this->root = this->build(eventIndices);
+
+    for (uint32_t i = 0u; i < displaySets.size(); ++i)
+    {
+        const auto &pcs = displaySets[i].getPcs();
+        if (pcs && pcs->getCompositionState() != CompositionState::Normal)
+        {
+            this->randomAccessPoints.emplace_back(displaySets[i].getPresentationTime(), i);
+        }
+    }
+    std::stable_sort(this->randomAccessPoints.begin(), this->randomAccessPoints.end(),
+                     [](const std::pair<uint32_t, uint32_t> &lhs, const std::pair<uint32_t, uint32_t> &rhs)
+                     {
+                         return lhs.first < rhs.first;
+                     });
+}
+
+uint32_t EventIndex::build(vector<uint32_t> &eventIndices)
+{
+    if (eventIndices.empty())
+    {
+        return EventIndex::NO_NODE;
+    }
+
+    /*
+     * The median start time is used as the center. The event it belongs to always overlaps the center (it isn't
+     * zero-length), so every node holds at least one event and both halves shrink.
+     */
+    const auto middle = eventIndices.begin() + eventIndices.size() / 2;
+    std::nth_element(eventIndices.begin(), middle, eventIndices.end(),
+                     [this](const uint32_t &lhs, const uint32_t &rhs)
+                     {
+                         return this->events[lhs].getStartTime() < this->events[rhs].getStartTime();
+                     });
+    const uint32_t center = this->events[*middle].getStartTime();
+
+    auto left = vector<uint32_t>();
+    auto right = vector<uint32_t>();
+    auto overlapping = vector<uint32_t>();
+    for (const auto &eventIndex : eventIndices)
+    {
+        const auto &event = this->events[eventIndex];
+        if (event.getEndTime() <= center)
+        {
+            left.push_back(eventIndex);
+        }
+        else if (event.getStartTime() > center)
+        {
+            right.push_back(eventIndex);
+        }
+        else
+        {
+            overlapping.push_back(eventIndex);
+        }
+    }
+    eventIndices.clear();
+    eventIndices.shrink_to_fit();
+
+    Node node{};
+    node.center = center;
+    node.first = static_cast<uint32_t>(this->byStart.size());
+    node.count = static_cast<uint32_t>(overlapping.size());
+
+    std::sort(overlapping.begin(), overlapping.end(), [this](const uint32_t &lhs, const uint32_t &rhs)
+    {
+        return this->events[lhs].getStartTime() < this->events[rhs].getStartTime();
+    });
+    this->byStart.insert(this->byStart.end(), overlapping.begin(), overlapping.end());
+
+    std::sort(overlapping.begin(), overlapping.end(), [this](const uint32_t &lhs, const uint32_t &rhs)
+    {
+        return this->events[lhs].getEndTime() > this->events[rhs].getEndTime();
+    });
+    this->byEnd.insert(this->byEnd.end(), overlapping.begin(), overlapping.end());
+
+    const auto nodeIndex = static_cast<uint32_t>(this->nodes.size());
+    this->nodes.push_back(node);
+
+    const uint32_t leftNode = this->build(left);
+    const uint32_t rightNode = this->build(right);
+    this->nodes[nodeIndex].left = leftNode;
+    this->nodes[nodeIndex].right = rightNode;
+
+    return nodeIndex;
+}
+
+void EventIndex::findAt(const uint32_t &time, vector<uint32_t> &results) const
+{
+    uint32_t nodeIndex = this->root;
+    while (nodeIndex != EventIndex::NO_NODE)
+    {
+        const auto &node = this->nodes[nodeIndex];
+        if (time < node.center)
+        {
+            // Every event here ends after the center, so only the start time needs checking.
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                if (this->events[this->byStart[i]].getStartTime() > time)
+                {
+                    break;
+                }
+                results.push_back(this->byStart[i]);
+            }
+            nodeIndex = node.left;
+        }
+        else
+        {
+            // Every event here starts at or before the center, so only the end time needs checking.
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                if (this->events[this->byEnd[i]].getEndTime() <= time)
+                {
+                    break;
+                }
+                results.push_back(this->byEnd[i]);
+            }
+            nodeIndex = node.right;
+        }
+    }
+}
+
+vector<uint32_t> EventIndex::findAt(const uint32_t &time) const
+{
+    auto results = vector<uint32_t>();
+    this->findAt(time, results);
+    return results;
+}
+
+void EventIndex::findInRange(const uint32_t &startTime, const uint32_t &endTime, vector<uint32_t> &results) const
+{
+    if (endTime <= startTime)
+    {
+        return;
+    }
+
+    auto pending = vector<uint32_t>();
+    if (this->root != EventIndex::NO_NODE)
+    {
+        pending.push_back(this->root);
+    }
+
+    while (!pending.empty())
+    {
+        const auto &node = this->nodes[pending.back()];
+        pending.pop_back();
+
+        if (endTime <= node.center)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                if (this->events[this->byStart[i]].getStartTime() >= endTime)
+                {
+                    break;
+                }
+                results.push_back(this->byStart[i]);
+            }
+            if (node.left != EventIndex::NO_NODE)
+            {
+                pending.push_back(node.left);
+            }
+        }
+        else if (startTime > node.center)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                if (this->events[this->byEnd[i]].getEndTime() <= startTime)
+                {
+                    break;
+                }
+                results.push_back(this->byEnd[i]);
+            }
+            if (node.right != EventIndex::NO_NODE)
+            {
+                pending.push_back(node.right);
+            }
+        }
+        else
+        {
+            // The center lies inside the range, so every event at this node overlaps it.
+            results.insert(results.end(), this->byStart.begin() + node.first,
+                           this->byStart.begin() + node.first + node.count);
+            if (node.left != EventIndex::NO_NODE)
+            {
+                pending.push_back(node.left);
+            }
+            if (node.right != EventIndex::NO_NODE)
+            {
+                pending.push_back(node.right);
+            }
+        }
+    }
+}
+
+vector<uint32_t> EventIndex::findInRange(const uint32_t &startTime, const uint32_t &endTime) const
+{
+    auto results = vector<uint32_t>();
+    this->findInRange(startTime, endTime, results);
+    return results;
+}
+
+uint32_t EventIndex::findRandomAccessPoint(const uint32_t &time) const noexcept
+{
+    const auto next = std::upper_bound(this->randomAccessPoints.begin(), this->randomAccessPoints.end(), time,
+                                       [](const uint32_t &value, const std::pair<uint32_t, uint32_t> &point)
+                                       {
+                                           return value < point.first;
+                                       });
+    if (next == this->randomAccessPoints.begin())
+    {
+        return EventIndex::NO_INDEX;
+    }
+
+    return (next - 1)->second;
+}
+
+// =======
+// Getters
+// =======
+
+const vector<SubtitleEvent> &EventIndex::getEvents() const noexcept
+{
+    return this->events;
+}
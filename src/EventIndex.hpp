@@ -0,0 +1,140 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#pragma once
+
+#include "DisplaySetInfo.hpp"
+#include "SubtitleEvent.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace Pgs
+{
+    /**
+     * \brief Index over the SubtitleEvents of a stream answering "what is visible at time t" queries.
+     *
+     * \details
+     * The events are stored in a centered interval tree. Every node holds the events overlapping its center point
+     * twice, once sorted by start time and once by end time, so a point or range query only visits one path down the
+     * tree plus the events it reports, i.e. O(log n + k).
+     * <br/><br/>Events are treated as half-open intervals [start, end). Events without an end stay visible until
+     * SubtitleEvent::OPEN_END.
+     * <br/><br/>The index also keeps the presentation times of every EpochStart and AcquisitionPoint display set, which
+     * are the points a decoder can start from to rebuild the screen at a given time.
+     */
+    class EventIndex
+    {
+    protected:
+        /**
+         * \brief Node of the interval tree. Its events are stored at [first, first + count) in both byStart and byEnd.
+         */
+        struct Node
+        {
+            uint32_t center;
+            uint32_t first;
+            uint32_t count;
+            uint32_t left;
+            uint32_t right;
+        };
+
+        static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+        std::vector<SubtitleEvent> events; /**< Indexed events. Query results are indices into this vector. */
+        std::vector<Node> nodes; /**< Interval tree nodes. */
+        std::vector<uint32_t> byStart; /**< Event indices of each node, sorted by ascending start time. */
+        std::vector<uint32_t> byEnd; /**< Event indices of each node, sorted by descending end time. */
+        uint32_t root;
+        std::vector<std::pair<uint32_t, uint32_t>> randomAccessPoints; /**< (presentation time, display set index) pairs. */
+
+        uint32_t build(std::vector<uint32_t> &eventIndices);
+
+    public:
+        /**
+         * \brief Value returned when no display set matches a lookup.
+         */
+        static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+        /**
+         * \brief Creates an empty EventIndex.
+         */
+        EventIndex();
+
+        /**
+         * \brief Derives the events of the provided display sets and indexes them.
+         * \param displaySets display sets in stream order, e.g. from DisplaySetInfo::scanAll
+         */
+        explicit EventIndex(const std::vector<DisplaySetInfo> &displaySets);
+
+        /**
+         * \brief Indexes already derived events.
+         * \param events events derived from displaySets
+         * \param displaySets display sets the events were derived from
+         */
+        EventIndex(std::vector<SubtitleEvent> events, const std::vector<DisplaySetInfo> &displaySets);
+
+        /**
+         * \brief Finds all events visible at the provided time.
+         * \param time time with 90kHz accuracy
+         * \param results vector the indices of the matching events are appended to, in no particular order
+         */
+        void findAt(const uint32_t &time, std::vector<uint32_t> &results) const;
+
+        /**
+         * \brief Finds all events visible at the provided time.
+         * \param time time with 90kHz accuracy
+         * \return indices of the matching events in no particular order
+         */
+        [[nodiscard]] std::vector<uint32_t> findAt(const uint32_t &time) const;
+
+        /**
+         * \brief Finds all events visible at any point in [startTime, endTime).
+         * \param startTime start of the range with 90kHz accuracy
+         * \param endTime end of the range with 90kHz accuracy
+         * \param results vector the indices of the matching events are appended to, in no particular order
+         */
+        void findInRange(const uint32_t &startTime, const uint32_t &endTime, std::vector<uint32_t> &results) const;
+
+        /**
+         * \brief Finds all events visible at any point in [startTime, endTime).
+         * \param startTime start of the range with 90kHz accuracy
+         * \param endTime end of the range with 90kHz accuracy
+         * \return indices of the matching events in no particular order
+         */
+        [[nodiscard]] std::vector<uint32_t> findInRange(const uint32_t &startTime, const uint32_t &endTime) const;
+
+        /**
+         * \brief Finds the last EpochStart or AcquisitionPoint display set presented at or before the provided time.
+         *
+         * \details
+         * Decoding every display set from the returned one up to the provided time reproduces the screen at that time.
+         *
+         * \param time time with 90kHz accuracy
+         * \return index of the display set, or NO_INDEX if there is none.
+         */
+        [[nodiscard]] uint32_t findRandomAccessPoint(const uint32_t &time) const noexcept;
+
+        // =======
+        // Getters
+        // =======
+
+        [[nodiscard]] const std::vector<SubtitleEvent> &getEvents() const noexcept;
+    };
+}
@@ -0,0 +1,416 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#include "FrameBlender.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using std::array;
+using std::vector;
+
+using namespace Pgs;
+
+namespace
+{
+    constexpr size_t Y_INDEX = 0u;
+    constexpr size_t CR_INDEX = 1u;
+    constexpr size_t CB_INDEX = 2u;
+    constexpr size_t ALPHA_INDEX = 3u;
+
+    /**
+     * \brief Blends colors onto a line of 8-bit samples.
+     * \param weights alpha of every color, scaled to 0-256
+     */
+    void blendLine8(uint8_t *samples, const uint16_t *colors, const uint16_t *weights, const size_t &count)
+    {
+        size_t i = 0u;
+#if defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i fullWeight = _mm_set1_epi16(256);
+        const __m128i rounding = _mm_set1_epi16(128);
+        for (; i + 8u <= count; i += 8u)
+        {
+            // color * a + sample * (256 - a) + 128 is at most 255 * 256 + 128, so it fits 16 unsigned bits.
+            const __m128i sample = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(samples + i)),
+                                                     zero);
+            const __m128i color = _mm_loadu_si128(reinterpret_cast<const __m128i *>(colors + i));
+            const __m128i weight = _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights + i));
+            __m128i sum = _mm_mullo_epi16(color, weight);
+            sum = _mm_add_epi16(sum, _mm_mullo_epi16(sample, _mm_sub_epi16(fullWeight, weight)));
+            sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 8);
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(samples + i), _mm_packus_epi16(sum, zero));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            samples[i] = static_cast<uint8_t>((colors[i] * weights[i] + samples[i] * (256u - weights[i]) + 128u) >> 8u);
+        }
+    }
+
+    /**
+     * \brief Blends colors onto a line of 10-bit samples stored in 16-bit words.
+     * \param weights alpha of every color, scaled to 0-256
+     * \param shift number of bits the samples are shifted up by in their words
+     */
+    void blendLine16(uint8_t *line, const uint16_t *colors, const uint16_t *weights, const size_t &count,
+                     const unsigned &shift)
+    {
+        size_t i = 0u;
+#if defined(__SSE2__)
+        const __m128i fullWeight = _mm_set1_epi16(256);
+        const __m128i rounding = _mm_set1_epi32(128);
+        const __m128i shiftCount = _mm_cvtsi32_si128(static_cast<int>(shift));
+        for (; i + 8u <= count; i += 8u)
+        {
+            // Pair every color with its sample and every weight with its inverse, so one multiply-add per pair
+            // gives the 32-bit blend sum.
+            __m128i sample = _mm_loadu_si128(reinterpret_cast<const __m128i *>(line + i * 2u));
+            sample = _mm_srl_epi16(sample, shiftCount);
+            const __m128i color = _mm_loadu_si128(reinterpret_cast<const __m128i *>(colors + i));
+            const __m128i weight = _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights + i));
+            const __m128i inverse = _mm_sub_epi16(fullWeight, weight);
+
+            __m128i low = _mm_madd_epi16(_mm_unpacklo_epi16(color, sample), _mm_unpacklo_epi16(weight, inverse));
+            __m128i high = _mm_madd_epi16(_mm_unpackhi_epi16(color, sample), _mm_unpackhi_epi16(weight, inverse));
+            low = _mm_srli_epi32(_mm_add_epi32(low, rounding), 8);
+            high = _mm_srli_epi32(_mm_add_epi32(high, rounding), 8);
+            const __m128i result = _mm_sll_epi16(_mm_packs_epi32(low, high), shiftCount);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(line + i * 2u), result);
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            uint16_t sample;
+            std::memcpy(&sample, line + i * 2u, sizeof(sample));
+            const uint32_t value = sample >> shift;
+            sample = static_cast<uint16_t>(((colors[i] * weights[i] + value * (256u - weights[i]) + 128u) >> 8u)
+                                           << shift);
+            std::memcpy(line + i * 2u, &sample, sizeof(sample));
+        }
+    }
+
+    /**
+     * \brief Blends a line of colors onto a plane line of the frame's bit depth.
+     */
+    void blendLine(const FrameFormat &format, uint8_t *line, const uint16_t *colors, const uint16_t *weights,
+                   const size_t &count)
+    {
+        switch (format)
+        {
+            case FrameFormat::I420:
+            case FrameFormat::NV12:
+                blendLine8(line, colors, weights, count);
+                break;
+            case FrameFormat::I420P10:
+                blendLine16(line, colors, weights, count, 0u);
+                break;
+            case FrameFormat::P010:
+                blendLine16(line, colors, weights, count, 6u);
+                break;
+        }
+    }
+
+    /**
+     * \brief Blends one color onto a run of packed 32-bit pixels.
+     * \param color color in the byte order of the frame, with an alpha of 255 so the frame alpha is composited
+     * \param weight alpha of the color, scaled to 0-256
+     */
+    void blendRun32(uint8_t *pixels, const array<uint8_t, 4> &color, const uint16_t &weight, const size_t &count)
+    {
+        // color * weight + 128 is the same for every pixel of the run.
+        array<uint16_t, 4> weightedColor{};
+        for (size_t channel = 0; channel < 4u; ++channel)
+        {
+            weightedColor[channel] = static_cast<uint16_t>(color[channel] * weight + 128u);
+        }
+        const auto inverse = static_cast<uint16_t>(256u - weight);
+
+        size_t i = 0u;
+#if defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i weighted = _mm_setr_epi16(
+                static_cast<int16_t>(weightedColor[0]), static_cast<int16_t>(weightedColor[1]),
+                static_cast<int16_t>(weightedColor[2]), static_cast<int16_t>(weightedColor[3]),
+                static_cast<int16_t>(weightedColor[0]), static_cast<int16_t>(weightedColor[1]),
+                static_cast<int16_t>(weightedColor[2]), static_cast<int16_t>(weightedColor[3]));
+        const __m128i inverseWeight = _mm_set1_epi16(static_cast<int16_t>(inverse));
+        for (; i + 4u <= count; i += 4u)
+        {
+            const __m128i frame = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i * 4u));
+            __m128i low = _mm_mullo_epi16(_mm_unpacklo_epi8(frame, zero), inverseWeight);
+            __m128i high = _mm_mullo_epi16(_mm_unpackhi_epi8(frame, zero), inverseWeight);
+            low = _mm_srli_epi16(_mm_add_epi16(low, weighted), 8);
+            high = _mm_srli_epi16(_mm_add_epi16(high, weighted), 8);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + i * 4u), _mm_packus_epi16(low, high));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            for (size_t channel = 0; channel < 4u; ++channel)
+            {
+                uint8_t &sample = pixels[i * 4u + channel];
+                sample = static_cast<uint8_t>((weightedColor[channel] + sample * inverse) >> 8u);
+            }
+        }
+    }
+
+    inline uint16_t toWeight(const uint8_t &alpha) noexcept
+    {
+        return static_cast<uint16_t>(alpha + (alpha >> 7u));
+    }
+}
+
+void FrameBlender::blend(const vector<vector<uint8_t>> &indices, const array<array<uint8_t, 4>, 256> &colors,
+                         VideoFrame &frame, const int64_t &x, const int64_t &y)
+{
+    const bool interleaved = frame.format == FrameFormat::NV12 || frame.format == FrameFormat::P010;
+    if (frame.planes[0] == nullptr || frame.planes[1] == nullptr || (!interleaved && frame.planes[2] == nullptr))
+    {
+        throw std::invalid_argument("FrameBlender::blend: frame is missing a plane.");
+    }
+
+    const bool tenBit = frame.format == FrameFormat::I420P10 || frame.format == FrameFormat::P010;
+    const unsigned depthShift = tenBit ? 2u : 0u;
+    const size_t sampleSize = tenBit ? 2u : 1u;
+
+    // Bounding box of the visible pixels, in image coordinates.
+    int64_t left = INT64_MAX, right = 0, top = INT64_MAX, bottom = 0;
+    for (size_t row = 0; row < indices.size(); ++row)
+    {
+        const auto &line = indices[row];
+        const auto first = std::find_if(line.begin(), line.end(), [&](const uint8_t &index) {
+            return colors[index][ALPHA_INDEX] != 0u;
+        });
+        if (first == line.end())
+        {
+            continue;
+        }
+        const auto last = std::find_if(line.rbegin(), line.rend(), [&](const uint8_t &index) {
+            return colors[index][ALPHA_INDEX] != 0u;
+        });
+        left = std::min<int64_t>(left, first - line.begin());
+        right = std::max<int64_t>(right, line.rend() - last);
+        top = std::min<int64_t>(top, static_cast<int64_t>(row));
+        bottom = static_cast<int64_t>(row) + 1;
+    }
+
+    // Clip to the frame, in frame coordinates.
+    const int64_t startX = std::max<int64_t>(x + left, 0);
+    const int64_t endX = std::min<int64_t>(x + right, frame.width);
+    const int64_t startY = std::max<int64_t>(y + top, 0);
+    const int64_t endY = std::min<int64_t>(y + bottom, frame.height);
+    if (startX >= endX || startY >= endY)
+    {
+        return;
+    }
+
+    auto colorAt = [&](const int64_t &frameX, const int64_t &frameY) -> const array<uint8_t, 4> & {
+        static const array<uint8_t, 4> transparent = {0u, 0u, 0u, 0u};
+        const int64_t row = frameY - y;
+        const int64_t column = frameX - x;
+        if (row < 0 || column < 0 || row >= static_cast<int64_t>(indices.size()) ||
+            column >= static_cast<int64_t>(indices[row].size()))
+        {
+            return transparent;
+        }
+        return colors[indices[row][column]];
+    };
+
+    // Luma
+    const auto lumaCount = static_cast<size_t>(endX - startX);
+    vector<uint16_t> lineColors(lumaCount * 2u), lineWeights(lumaCount * 2u);
+    for (int64_t frameY = startY; frameY < endY; ++frameY)
+    {
+        for (size_t i = 0; i < lumaCount; ++i)
+        {
+            const auto &color = colorAt(startX + static_cast<int64_t>(i), frameY);
+            lineColors[i] = static_cast<uint16_t>(color[Y_INDEX] << depthShift);
+            lineWeights[i] = toWeight(color[ALPHA_INDEX]);
+        }
+        uint8_t *line = frame.planes[0] + static_cast<size_t>(frameY) * frame.strides[0] +
+                        static_cast<size_t>(startX) * sampleSize;
+        blendLine(frame.format, line, lineColors.data(), lineWeights.data(), lumaCount);
+    }
+
+    // Chroma, one sample per 2x2 pixels.
+    const int64_t chromaStartX = startX / 2, chromaEndX = (endX + 1) / 2;
+    const int64_t chromaStartY = startY / 2, chromaEndY = (endY + 1) / 2;
+    const auto chromaCount = static_cast<size_t>(chromaEndX - chromaStartX);
+    vector<uint16_t> crColors(chromaCount), cbColors(chromaCount), chromaWeights(chromaCount);
+    for (int64_t chromaY = chromaStartY; chromaY < chromaEndY; ++chromaY)
+    {
+        for (size_t i = 0; i < chromaCount; ++i)
+        {
+            const int64_t frameX = (chromaStartX + static_cast<int64_t>(i)) * 2;
+            uint32_t weightSum = 0u, crSum = 0u, cbSum = 0u;
+            for (int64_t dy = 0; dy < 2; ++dy)
+            {
+                for (int64_t dx = 0; dx < 2; ++dx)
+                {
+                    const auto &color = colorAt(frameX + dx, chromaY * 2 + dy);
+                    const uint16_t weight = toWeight(color[ALPHA_INDEX]);
+                    weightSum += weight;
+                    crSum += color[CR_INDEX] * weight;
+                    cbSum += color[CB_INDEX] * weight;
+                }
+            }
+            crColors[i] = static_cast<uint16_t>((weightSum == 0u ? 128u : (crSum + weightSum / 2u) / weightSum)
+                                                << depthShift);
+            cbColors[i] = static_cast<uint16_t>((weightSum == 0u ? 128u : (cbSum + weightSum / 2u) / weightSum)
+                                                << depthShift);
+            chromaWeights[i] = static_cast<uint16_t>((weightSum + 2u) / 4u);
+        }
+
+        const size_t offset = static_cast<size_t>(chromaY);
+        if (interleaved)
+        {
+            for (size_t i = 0; i < chromaCount; ++i)
+            {
+                lineColors[i * 2u] = cbColors[i];
+                lineColors[i * 2u + 1u] = crColors[i];
+                lineWeights[i * 2u] = chromaWeights[i];
+                lineWeights[i * 2u + 1u] = chromaWeights[i];
+            }
+            uint8_t *line = frame.planes[1] + offset * frame.strides[1] +
+                            static_cast<size_t>(chromaStartX) * 2u * sampleSize;
+            blendLine(frame.format, line, lineColors.data(), lineWeights.data(), chromaCount * 2u);
+        }
+        else
+        {
+            uint8_t *uLine = frame.planes[1] + offset * frame.strides[1] +
+                             static_cast<size_t>(chromaStartX) * sampleSize;
+            uint8_t *vLine = frame.planes[2] + offset * frame.strides[2] +
+                             static_cast<size_t>(chromaStartX) * sampleSize;
+            blendLine(frame.format, uLine, cbColors.data(), chromaWeights.data(), chromaCount);
+            blendLine(frame.format, vLine, crColors.data(), chromaWeights.data(), chromaCount);
+        }
+    }
+}
+
+void FrameBlender::blend(const Subtitle &subtitle, VideoFrame &frame)
+{
+    if (!subtitle.containsImage())
+    {
+        return;
+    }
+
+    array<array<uint8_t, 4>, 256> colors{};
+    if (subtitle.getPds())
+    {
+        for (const auto &entry : subtitle.getPds()->getEntries())
+        {
+            colors[entry.first] = entry.second->getYCrCbA();
+        }
+    }
+
+    int64_t x = 0, y = 0;
+    if (subtitle.getPcs() && !subtitle.getPcs()->getCompositionObjects().empty())
+    {
+        x = subtitle.getPcs()->getCompositionObjects()[0]->getHPos();
+        y = subtitle.getPcs()->getCompositionObjects()[0]->getVPos();
+    }
+
+    FrameBlender::blend(subtitle.decodeImage(), colors, frame, x, y);
+}
+
+void FrameBlender::blendPacked(const vector<uint8_t> &data, const uint16_t &imageWidth, const uint16_t &imageHeight,
+                               const array<array<uint8_t, 4>, 256> &colors, uint8_t *buffer, const uint32_t &width,
+                               const uint32_t &height, const size_t &stride, const PackedFormat &format,
+                               const int64_t &x, const int64_t &y)
+{
+    if (buffer == nullptr)
+    {
+        throw std::invalid_argument("FrameBlender::blendPacked: frame buffer is null.");
+    }
+
+    // Colors in the byte order of the frame.
+    array<array<uint8_t, 4>, 256> pixels{};
+    for (size_t i = 0; i < colors.size(); ++i)
+    {
+        const auto &color = colors[i];
+        pixels[i] = format == PackedFormat::BGRA ? array<uint8_t, 4>{color[2], color[1], color[0], 255u} :
+                    array<uint8_t, 4>{color[0], color[1], color[2], 255u};
+    }
+
+    ObjectDefinition::forEachRun(data, imageWidth, imageHeight, [&](const uint16_t &row, const uint16_t &column,
+                                                                    const uint16_t &length, const uint8_t &index) {
+        const uint8_t &alpha = colors[index][3];
+        const int64_t frameY = y + row;
+        if (alpha == 0u || frameY < 0 || frameY >= static_cast<int64_t>(height))
+        {
+            return;
+        }
+
+        const int64_t start = std::max<int64_t>(x + column, 0);
+        const int64_t end = std::min<int64_t>(x + column + length, width);
+        if (start >= end)
+        {
+            return;
+        }
+
+        uint8_t *out = buffer + static_cast<size_t>(frameY) * stride + static_cast<size_t>(start) * 4u;
+        const auto count = static_cast<size_t>(end - start);
+        if (alpha == 255u)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                std::memcpy(out + i * 4u, pixels[index].data(), 4u);
+            }
+            return;
+        }
+        blendRun32(out, pixels[index], toWeight(alpha), count);
+    });
+}
+
+void FrameBlender::blendPacked(const Subtitle &subtitle, uint8_t *buffer, const uint32_t &width,
+                               const uint32_t &height, const size_t &stride, const PackedFormat &format,
+                               const int64_t &x, const int64_t &y)
+{
+    if (!subtitle.containsImage() || !subtitle.getOds(0))
+    {
+        return;
+    }
+
+    array<array<uint8_t, 4>, 256> colors{};
+    if (subtitle.getPds())
+    {
+        for (const auto &entry : subtitle.getPds()->getEntries())
+        {
+            colors[entry.first] = entry.second->getRGBA();
+        }
+    }
+
+    // Only split objects need their data joined.
+    const auto &firstFragment = subtitle.getOds(0);
+    if (subtitle.getOds(1) == nullptr)
+    {
+        FrameBlender::blendPacked(firstFragment->getEncodedObjectData(), firstFragment->getWidth(),
+                                  firstFragment->getHeight(), colors, buffer, width, height, stride, format, x, y);
+        return;
+    }
+    FrameBlender::blendPacked(subtitle.getEncodedImageData(), firstFragment->getWidth(), firstFragment->getHeight(),
+                              colors, buffer, width, height, stride, format, x, y);
+}
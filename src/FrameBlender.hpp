@@ -0,0 +1,153 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#pragma once
+
+#include "Subtitle.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Pgs
+{
+    /**
+     * \brief Layouts of 4:2:0 video frames FrameBlender can blend onto.
+     */
+    enum class FrameFormat
+    {
+        I420, /**< 8-bit Y, U and V planes. */
+        NV12, /**< 8-bit Y plane and an interleaved UV plane. */
+        I420P10, /**< 10-bit Y, U and V planes, stored in the low bits of little endian 16-bit words. */
+        P010 /**< 10-bit Y plane and an interleaved UV plane, stored in the high bits of 16-bit words. */
+    };
+
+    /**
+     * \brief Byte orders of packed 32-bit frames FrameBlender can blend onto.
+     */
+    enum class PackedFormat
+    {
+        BGRA, /**< Blue, green, red and alpha bytes, as used by most preview surfaces. */
+        RGBA /**< Red, green, blue and alpha bytes. */
+    };
+
+    /**
+     * \brief Decoded video frame FrameBlender writes to. The planes are owned by the caller.
+     */
+    struct VideoFrame
+    {
+        FrameFormat format; /**< Layout of the planes. */
+        uint32_t width; /**< Width of the luma plane in pixels. */
+        uint32_t height; /**< Height of the luma plane in pixels. */
+        std::array<uint8_t *, 3> planes; /**< Y, U and V planes. For NV12 and P010, U is the UV plane and V unused. */
+        std::array<size_t, 3> strides; /**< Number of bytes between the starts of two lines of every plane. */
+    };
+
+    /**
+     * \brief Composites subtitle images onto 4:2:0 YUV video frames, for burning subtitles in, and onto packed 32-bit
+     * frames, for previews.
+     *
+     * \details
+     * Colors are taken straight from the palette's Y, Cb, Cr and alpha values, so nothing goes through RGB. Each
+     * line is first looked up into color and weight buffers, then blended with SSE2 kernels when available.
+     * <br/><br/>Chroma samples take the alpha weighted average color of the 2x2 pixels they cover, and their
+     * average alpha, so edges are blended the same way on all planes. Alpha is scaled to 0-256 so blending is
+     * out = (color * a + frame * (256 - a) + 128) >> 8, with fully opaque pixels replacing the frame exactly.
+     * <br/><br/>Only the bounding box of the visible pixels is blended, clipped to the frame.
+     */
+    class FrameBlender
+    {
+    public:
+        /**
+         * \brief Blends an image onto a frame.
+         * \param indices lines of palette indices, e.g. from Subtitle::decodeImage
+         * \param colors Y, Cr, Cb and alpha value of every palette index, as returned by PaletteEntry::getYCrCbA
+         * \param frame frame to blend onto
+         * \param x column of the frame the left edge of the image is placed at. May be outside of the frame.
+         * \param y line of the frame the top edge of the image is placed at. May be outside of the frame.
+         *
+         * \throws std::invalid_argument if a plane the format uses is null.
+         */
+        static void blend(const std::vector<std::vector<uint8_t>> &indices,
+                          const std::array<std::array<uint8_t, 4>, 256> &colors, VideoFrame &frame,
+                          const int64_t &x, const int64_t &y);
+
+        /**
+         * \brief Blends the image of a Subtitle onto a frame at its composition position.
+         *
+         * \details
+         * The frame is expected to have the video size of the stream. Subtitles without an image leave the frame
+         * untouched.
+         *
+         * \param subtitle subtitle to blend
+         * \param frame frame to blend onto
+         *
+         * \throws std::invalid_argument if a plane the format uses is null.
+         */
+        static void blend(const Subtitle &subtitle, VideoFrame &frame);
+
+        /**
+         * \brief Blends PGS run-length encoded data onto a packed 32-bit frame.
+         *
+         * \details
+         * The image is never decoded into pixels. Runs are blended one at a time: fully transparent runs are
+         * skipped, fully opaque runs are filled with their color, and the others are blended with an SSE2 kernel
+         * when available, so the cost follows the number of visible pixels. The frame's alpha is composited with
+         * the "over" operator, so opaque frames stay opaque.
+         *
+         * \param data RLE-compressed data
+         * \param imageWidth width of the decompressed image
+         * \param imageHeight height of the decompressed image
+         * \param colors red, green, blue and alpha value of every palette index, as returned by PaletteEntry::getRGBA
+         * \param buffer first pixel of the frame
+         * \param width frame width in pixels
+         * \param height frame height in pixels
+         * \param stride number of bytes between the starts of two lines of the frame
+         * \param format byte order of the frame
+         * \param x column of the frame the left edge of the image is placed at. May be outside of the frame.
+         * \param y line of the frame the top edge of the image is placed at. May be outside of the frame.
+         */
+        static void blendPacked(const std::vector<uint8_t> &data, const uint16_t &imageWidth,
+                                const uint16_t &imageHeight, const std::array<std::array<uint8_t, 4>, 256> &colors,
+                                uint8_t *buffer, const uint32_t &width, const uint32_t &height, const size_t &stride,
+                                const PackedFormat &format, const int64_t &x, const int64_t &y);
+
+        /**
+         * \brief Blends the image of a Subtitle onto a packed 32-bit frame.
+         *
+         * \details
+         * Same as the RLE overload, with the colors taken from the Subtitle's palette. Subtitles without an image
+         * leave the frame untouched.
+         *
+         * \param subtitle subtitle to blend
+         * \param buffer first pixel of the frame
+         * \param width frame width in pixels
+         * \param height frame height in pixels
+         * \param stride number of bytes between the starts of two lines of the frame
+         * \param format byte order of the frame
+         * \param x column of the frame the left edge of the image is placed at. May be outside of the frame.
+         * \param y line of the frame the top edge of the image is placed at. May be outside of the frame.
+         */
+        static void blendPacked(const Subtitle &subtitle, uint8_t *buffer, const uint32_t &width,
+                                const uint32_t &height, const size_t &stride, const PackedFormat &format,
+                                const int64_t &x, const int64_t &y);
+    };
+}
@@ -0,0 +1,377 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#include "ImageWriter.hpp"
+#include "ByteWriter.hpp"
+#include "PgsUtil.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using std::vector;
+
+using namespace Pgs;
+
+namespace
+{
+    const std::array<uint32_t, 256> &getCrcTable()
+    {
+        static const std::array<uint32_t, 256> table = [] {
+            std::array<uint32_t, 256> crcTable{};
+            for (uint32_t i = 0; i < crcTable.size(); ++i)
+            {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; ++bit)
+                {
+                    crc = (crc & 1u) ? 0xEDB88320u ^ (crc >> 1u) : crc >> 1u;
+                }
+                crcTable[i] = crc;
+            }
+            return crcTable;
+        }();
+
+        return table;
+    }
+
+    uint32_t crc32(const uint8_t *data, const size_t &size, uint32_t crc = 0u)
+    {
+        const auto &table = getCrcTable();
+        crc = ~crc;
+        for (size_t i = 0; i < size; ++i)
+        {
+            crc = table[(crc ^ data[i]) & 0xFFu] ^ (crc >> 8u);
+        }
+
+        return ~crc;
+    }
+
+    /**
+     * \brief Running Adler-32 checksum, as required at the end of zlib streams.
+     */
+    class Adler32
+    {
+    protected:
+        uint32_t a = 1u;
+        uint32_t b = 0u;
+    public:
+        void update(const uint8_t *data, size_t size)
+        {
+            // 5552 is the largest count of bytes that can be summed up before b could overflow.
+            while (size > 0u)
+            {
+                const size_t count = std::min<size_t>(size, 5552u);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    this->a += data[i];
+                    this->b += this->a;
+                }
+                this->a %= 65521u;
+                this->b %= 65521u;
+                data += count;
+                size -= count;
+            }
+        }
+
+        [[nodiscard]] uint32_t getValue() const noexcept
+        {
+            return (this->b << 16u) | this->a;
+        }
+    };
+
+    constexpr uint8_t QOI_OP_INDEX = 0x00u;
+    constexpr uint8_t QOI_OP_DIFF = 0x40u;
+    constexpr uint8_t QOI_OP_LUMA = 0x80u;
+    constexpr uint8_t QOI_OP_RUN = 0xC0u;
+    constexpr uint8_t QOI_OP_RGB = 0xFEu;
+    constexpr uint8_t QOI_OP_RGBA = 0xFFu;
+    constexpr uint8_t QOI_MAX_RUN = 62u;
+}
+
+void ImageWriter::encodePam(vector<uint8_t> &out, const uint8_t *pixels, const uint16_t &width,
+                            const uint16_t &height)
+{
+    std::ostringstream header;
+    header << "P7\nWIDTH " << width << "\nHEIGHT " << height << "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+    const auto headerString = header.str();
+
+    out.insert(out.end(), headerString.begin(), headerString.end());
+    out.insert(out.end(), pixels, pixels + static_cast<size_t>(width) * height * 4u);
+}
+
+void ImageWriter::encodeQoi(vector<uint8_t> &out, const uint8_t *pixels, const uint16_t &width,
+                            const uint16_t &height)
+{
+    ByteWriter writer(out);
+    writer.writeBytes(reinterpret_cast<const uint8_t *>("qoif"), 4u);
+    writer.write32(width);
+    writer.write32(height);
+    writer.write8(4u); // channels
+    writer.write8(0u); // sRGB with linear alpha
+
+    std::array<std::array<uint8_t, 4>, 64> seen{};
+    std::array<uint8_t, 4> previous = {0u, 0u, 0u, 255u};
+    uint8_t run = 0u;
+
+    const size_t numPixels = static_cast<size_t>(width) * height;
+    for (size_t i = 0; i < numPixels; ++i)
+    {
+        std::array<uint8_t, 4> pixel;
+        std::memcpy(pixel.data(), pixels + i * 4u, 4u);
+
+        if (pixel == previous)
+        {
+            ++run;
+            if (run == QOI_MAX_RUN || i + 1u == numPixels)
+            {
+                writer.write8(QOI_OP_RUN | (run - 1u));
+                run = 0u;
+            }
+            continue;
+        }
+
+        if (run > 0u)
+        {
+            writer.write8(QOI_OP_RUN | (run - 1u));
+            run = 0u;
+        }
+
+        const uint8_t index = (pixel[0] * 3u + pixel[1] * 5u + pixel[2] * 7u + pixel[3] * 11u) % 64u;
+        if (seen[index] == pixel)
+        {
+            writer.write8(QOI_OP_INDEX | index);
+        }
+        else
+        {
+            seen[index] = pixel;
+            if (pixel[3] == previous[3])
+            {
+                const auto dr = static_cast<int8_t>(pixel[0] - previous[0]);
+                const auto dg = static_cast<int8_t>(pixel[1] - previous[1]);
+                const auto db = static_cast<int8_t>(pixel[2] - previous[2]);
+                const auto drDg = static_cast<int8_t>(dr - dg);
+                const auto dbDg = static_cast<int8_t>(db - dg);
+
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                {
+                    writer.write8(QOI_OP_DIFF | ((dr + 2) << 4u) | ((dg + 2) << 2u) | (db + 2));
+                }
+                else if (dg >= -32 && dg <= 31 && drDg >= -8 && drDg <= 7 && dbDg >= -8 && dbDg <= 7)
+                {
+                    writer.write8(QOI_OP_LUMA | (dg + 32));
+                    writer.write8(((drDg + 8) << 4u) | (dbDg + 8));
+                }
+                else
+                {
+                    writer.write8(QOI_OP_RGB);
+                    writer.writeBytes(pixel.data(), 3u);
+                }
+            }
+            else
+            {
+                writer.write8(QOI_OP_RGBA);
+                writer.writeBytes(pixel.data(), 4u);
+            }
+        }
+
+        previous = pixel;
+    }
+
+    // End marker
+    const uint8_t padding[] = {0u, 0u, 0u, 0u, 0u, 0u, 0u, 1u};
+    writer.writeBytes(padding, sizeof(padding));
+}
+
+void ImageWriter::writePngChunk(vector<uint8_t> &out, const char *type, const vector<uint8_t> &data)
+{
+    ByteWriter writer(out);
+    writer.write32(static_cast<uint32_t>(data.size()));
+    const size_t typePos = writer.getPosition();
+    writer.writeBytes(reinterpret_cast<const uint8_t *>(type), 4u);
+    writer.writeBytes(data.data(), data.size());
+    writer.write32(crc32(out.data() + typePos, data.size() + 4u));
+}
+
+void ImageWriter::encodePng(vector<uint8_t> &out, const uint8_t *pixels, const uint16_t &width,
+                            const uint16_t &height)
+{
+    const uint8_t signature[] = {0x89u, 'P', 'N', 'G', '\r', '\n', 0x1Au, '\n'};
+    out.insert(out.end(), signature, signature + sizeof(signature));
+
+    vector<uint8_t> header;
+    ByteWriter headerWriter(header);
+    headerWriter.write32(width);
+    headerWriter.write32(height);
+    headerWriter.write8(8u); // bit depth
+    headerWriter.write8(6u); // truecolor with alpha
+    headerWriter.write8(0u); // deflate
+    headerWriter.write8(0u); // adaptive filtering
+    headerWriter.write8(0u); // no interlacing
+    ImageWriter::writePngChunk(out, "IHDR", header);
+
+    /*
+     * Every row starts with a filter type byte (0, none). The rows are then wrapped in stored deflate blocks, which
+     * can hold up to 65535 bytes each.
+     */
+    const size_t rowSize = static_cast<size_t>(width) * 4u;
+    const size_t rawSize = (rowSize + 1u) * height;
+    const size_t maxBlockSize = UINT16_MAX;
+    const size_t numBlocks = std::max<size_t>(1u, (rawSize + maxBlockSize - 1u) / maxBlockSize);
+
+    vector<uint8_t> compressed;
+    compressed.reserve(rawSize + numBlocks * 5u + 6u);
+    ByteWriter writer(compressed);
+    writer.write8(0x78u); // deflate with a 32kb window
+    writer.write8(0x01u); // no preset dictionary, fastest compression
+
+    Adler32 adler;
+    size_t rawPos = 0u;
+    size_t blockRemaining = 0u;
+    auto writeRaw = [&](const uint8_t *data, size_t size) {
+        adler.update(data, size);
+        while (size > 0u)
+        {
+            if (blockRemaining == 0u)
+            {
+                const size_t blockSize = std::min(maxBlockSize, rawSize - rawPos);
+                writer.write8(rawPos + blockSize >= rawSize ? 1u : 0u);
+                writer.write8(blockSize & 0xFFu);
+                writer.write8(blockSize >> 8u);
+                writer.write8(~blockSize & 0xFFu);
+                writer.write8((~blockSize >> 8u) & 0xFFu);
+                blockRemaining = blockSize;
+            }
+
+            const size_t count = std::min(size, blockRemaining);
+            writer.writeBytes(data, count);
+            data += count;
+            size -= count;
+            rawPos += count;
+            blockRemaining -= count;
+        }
+    };
+
+    if (rawSize == 0u)
+    {
+        // An empty stored block, since a zlib stream needs at least one.
+        const uint8_t emptyBlock[] = {1u, 0u, 0u, 0xFFu, 0xFFu};
+        writer.writeBytes(emptyBlock, sizeof(emptyBlock));
+    }
+
+    const uint8_t filter = 0u;
+    for (uint16_t y = 0; y < height; ++y)
+    {
+        writeRaw(&filter, 1u);
+        writeRaw(pixels + y * rowSize, rowSize);
+    }
+    writer.write32(adler.getValue());
+
+    ImageWriter::writePngChunk(out, "IDAT", compressed);
+    ImageWriter::writePngChunk(out, "IEND", vector<uint8_t>());
+}
+
+vector<uint8_t> ImageWriter::encode(const uint8_t *pixels, const uint16_t &width, const uint16_t &height,
+                                    const ImageFormat &format)
+{
+    vector<uint8_t> out;
+    switch (format)
+    {
+        case ImageFormat::PAM:
+            ImageWriter::encodePam(out, pixels, width, height);
+            break;
+        case ImageFormat::QOI:
+            ImageWriter::encodeQoi(out, pixels, width, height);
+            break;
+        case ImageFormat::PNG:
+            ImageWriter::encodePng(out, pixels, width, height);
+            break;
+    }
+
+    return out;
+}
+
+void ImageWriter::write(std::ostream &stream, const uint8_t *pixels, const uint16_t &width, const uint16_t &height,
+                        const ImageFormat &format)
+{
+    const auto encoded = ImageWriter::encode(pixels, width, height, format);
+    stream.write(reinterpret_cast<const char *>(encoded.data()), static_cast<std::streamsize>(encoded.size()));
+    if (!stream)
+    {
+        throw WriteError("ImageWriter::write: failed to write to the output stream.");
+    }
+}
+
+void ImageWriter::write(const std::string &path, const Subtitle &subtitle, const ImageFormat &format)
+{
+    uint16_t width, height;
+    const auto pixels = subtitle.getImageData(ColorSpace::RGBA, width, height);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        throw WriteError(("ImageWriter::write: failed to open '" + path + "'.").c_str());
+    }
+    ImageWriter::write(file, pixels.data(), width, height, format);
+}
+
+uint64_t ImageWriter::writeAll(const vector<std::shared_ptr<Subtitle>> &subtitles, const std::string &pathPrefix,
+                               const ImageFormat &format, const unsigned &numThreads)
+{
+    std::atomic<uint64_t> numWritten(0u);
+    parallelFor(0u, subtitles.size(), numThreads, [&](size_t i) {
+        const auto &subtitle = subtitles[i];
+        if (!subtitle || !subtitle->containsImage())
+        {
+            return;
+        }
+
+        std::ostringstream path;
+        path << pathPrefix << std::setw(5) << std::setfill('0') << i << ImageWriter::getExtension(format);
+        ImageWriter::write(path.str(), *subtitle, format);
+        ++numWritten;
+    });
+
+    return numWritten;
+}
+
+uint64_t ImageWriter::writeAll(const char *data, const uint64_t &size, const std::string &pathPrefix,
+                               const ImageFormat &format, const unsigned &numThreads)
+{
+    return ImageWriter::writeAll(Subtitle::createAll(data, size), pathPrefix, format, numThreads);
+}
+
+const char *ImageWriter::getExtension(const ImageFormat &format) noexcept
+{
+    switch (format)
+    {
+        case ImageFormat::PAM:
+            return ".pam";
+        case ImageFormat::QOI:
+            return ".qoi";
+        case ImageFormat::PNG:
+            return ".png";
+    }
+
+    return "";
+}
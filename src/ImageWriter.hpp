@@ -0,0 +1,156 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#pragma once
+
+#include "Subtitle.hpp"
+#include "SupWriter.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Pgs
+{
+    /**
+     * \brief Image file formats ImageWriter can produce.
+     */
+    enum class ImageFormat
+    {
+        PAM, /**< Netpbm PAM with an RGB_ALPHA tuple type. Uncompressed. */
+        QOI, /**< Quite OK Image format. Lossless and fast to encode. */
+        PNG /**< PNG holding uncompressed (stored) deflate blocks. */
+    };
+
+    /**
+     * \brief Writes 8-bit RGBA images without depending on any image library.
+     *
+     * \details
+     * Images are taken as a single buffer holding 4 bytes per pixel, row by row, as returned by
+     * Subtitle::getImageData. None of the formats compress beyond what QOI does by itself; the goal is to get
+     * bitmaps onto disk quickly rather than small.
+     */
+    class ImageWriter
+    {
+    protected:
+        /**
+         * \brief Appends a PAM image.
+         */
+        static void encodePam(std::vector<uint8_t> &out, const uint8_t *pixels, const uint16_t &width,
+                              const uint16_t &height);
+
+        /**
+         * \brief Appends a QOI image.
+         */
+        static void encodeQoi(std::vector<uint8_t> &out, const uint8_t *pixels, const uint16_t &width,
+                              const uint16_t &height);
+
+        /**
+         * \brief Appends a PNG image using stored deflate blocks.
+         */
+        static void encodePng(std::vector<uint8_t> &out, const uint8_t *pixels, const uint16_t &width,
+                              const uint16_t &height);
+
+        /**
+         * \brief Appends a PNG chunk, including its length and CRC.
+         * \param out buffer to append to
+         * \param type 4 character chunk type
+         * \param data chunk data
+         */
+        static void writePngChunk(std::vector<uint8_t> &out, const char *type, const std::vector<uint8_t> &data);
+    public:
+        /**
+         * \brief Encodes an RGBA image in the requested format.
+         * \param pixels image data, 4 bytes per pixel, row by row
+         * \param width image width in pixels
+         * \param height image height in pixels
+         * \param format format to encode to
+         * \return encoded image file
+         */
+        static std::vector<uint8_t> encode(const uint8_t *pixels, const uint16_t &width, const uint16_t &height,
+                                           const ImageFormat &format);
+
+        /**
+         * \brief Encodes an RGBA image and writes it to a stream.
+         * \param stream stream to write to
+         * \param pixels image data, 4 bytes per pixel, row by row
+         * \param width image width in pixels
+         * \param height image height in pixels
+         * \param format format to encode to
+         *
+         * \throws WriteError if the stream reports a failure.
+         */
+        static void write(std::ostream &stream, const uint8_t *pixels, const uint16_t &width, const uint16_t &height,
+                          const ImageFormat &format);
+
+        /**
+         * \brief Writes the image of a Subtitle to a file.
+         * \param path path of the file to create
+         * \param subtitle Subtitle containing an image
+         * \param format format to encode to
+         *
+         * \throws WriteError if the file can't be written.
+         */
+        static void write(const std::string &path, const Subtitle &subtitle, const ImageFormat &format);
+
+        /**
+         * \brief Writes the image of every Subtitle containing one, using several threads.
+         *
+         * \details
+         * File names are made of the prefix, the index of the Subtitle padded to 5 digits, and the extension of the
+         * format, e.g. "out/sub_00042.qoi". Each thread decodes, converts and writes whole images on its own, so the
+         * work scales with the number of threads until the disk can't keep up.
+         *
+         * \param subtitles Subtitles to export
+         * \param pathPrefix prefix of every file path
+         * \param format format to encode to
+         * \param numThreads number of threads to use, or 0 to use one per hardware thread
+         * \return number of images written
+         *
+         * \throws WriteError if any file can't be written. Other images may have been written already.
+         */
+        static uint64_t writeAll(const std::vector<std::shared_ptr<Subtitle>> &subtitles,
+                                 const std::string &pathPrefix, const ImageFormat &format,
+                                 const unsigned &numThreads = 0u);
+
+        /**
+         * \brief Imports a PGS stream and writes the image of every Subtitle containing one, using several threads.
+         * \param data pointer to raw PGS data
+         * \param size number of bytes in the data array
+         * \param pathPrefix prefix of every file path
+         * \param format format to encode to
+         * \param numThreads number of threads to use, or 0 to use one per hardware thread
+         * \return number of images written
+         *
+         * \throws WriteError if any file can't be written.
+         */
+        static uint64_t writeAll(const char *data, const uint64_t &size, const std::string &pathPrefix,
+                                 const ImageFormat &format, const unsigned &numThreads = 0u);
+
+        /**
+         * \brief Gets the file extension used for a format, including the dot.
+         * \param format image format
+         * \return file extension
+         */
+        static const char *getExtension(const ImageFormat &format) noexcept;
+    };
+}
@@ -0,0 +1,846 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#include "MatroskaReader.hpp"
+#include "ByteWriter.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+#if defined(PGS_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+using std::string;
+using std::vector;
+
+using namespace Pgs;
+
+constexpr uint64_t MatroskaTrack::NO_COMPRESSION;
+
+namespace
+{
+    constexpr uint64_t UNKNOWN_SIZE = UINT64_MAX;
+
+    // Element IDs, with their length marker bits kept as Matroska lists them.
+    constexpr uint32_t ID_EBML = 0x1A45DFA3u;
+    constexpr uint32_t ID_SEGMENT = 0x18538067u;
+    constexpr uint32_t ID_SEEK_HEAD = 0x114D9B74u;
+    constexpr uint32_t ID_SEEK = 0x4DBBu;
+    constexpr uint32_t ID_SEEK_ID = 0x53ABu;
+    constexpr uint32_t ID_SEEK_POSITION = 0x53ACu;
+    constexpr uint32_t ID_INFO = 0x1549A966u;
+    constexpr uint32_t ID_TIMESTAMP_SCALE = 0x2AD7B1u;
+    constexpr uint32_t ID_TRACKS = 0x1654AE6Bu;
+    constexpr uint32_t ID_TRACK_ENTRY = 0xAEu;
+    constexpr uint32_t ID_TRACK_NUMBER = 0xD7u;
+    constexpr uint32_t ID_CODEC_ID = 0x86u;
+    constexpr uint32_t ID_LANGUAGE = 0x22B59Cu;
+    constexpr uint32_t ID_NAME = 0x536Eu;
+    constexpr uint32_t ID_FLAG_DEFAULT = 0x88u;
+    constexpr uint32_t ID_FLAG_FORCED = 0x55AAu;
+    constexpr uint32_t ID_CONTENT_ENCODINGS = 0x6D80u;
+    constexpr uint32_t ID_CONTENT_ENCODING = 0x6240u;
+    constexpr uint32_t ID_CONTENT_COMPRESSION = 0x5034u;
+    constexpr uint32_t ID_CONTENT_COMP_ALGO = 0x4254u;
+    constexpr uint32_t ID_CONTENT_COMP_SETTINGS = 0x4255u;
+    constexpr uint32_t ID_CLUSTER = 0x1F43B675u;
+    constexpr uint32_t ID_CLUSTER_TIMESTAMP = 0xE7u;
+    constexpr uint32_t ID_SIMPLE_BLOCK = 0xA3u;
+    constexpr uint32_t ID_BLOCK_GROUP = 0xA0u;
+    constexpr uint32_t ID_BLOCK = 0xA1u;
+    constexpr uint32_t ID_CUES = 0x1C53BB6Bu;
+    constexpr uint32_t ID_CUE_POINT = 0xBBu;
+    constexpr uint32_t ID_CUE_TRACK_POSITIONS = 0xB7u;
+    constexpr uint32_t ID_CUE_TRACK = 0xF7u;
+    constexpr uint32_t ID_CUE_CLUSTER_POSITION = 0xF1u;
+    constexpr uint32_t ID_TAGS = 0x1254C367u;
+    constexpr uint32_t ID_CHAPTERS = 0x1043A770u;
+    constexpr uint32_t ID_ATTACHMENTS = 0x1941A469u;
+
+    constexpr const char *PGS_CODEC_ID = "S_HDMV/PGS";
+    constexpr uint64_t ZLIB_COMPRESSION = 0u;
+    constexpr uint64_t HEADER_STRIPPING = 3u;
+
+    struct ElementHeader
+    {
+        uint64_t start; /**< Stream position of the element ID. */
+        uint32_t id;
+        uint64_t size; /**< Data size, or UNKNOWN_SIZE. */
+        uint64_t dataStart; /**< Stream position of the element data. */
+
+        [[nodiscard]] uint64_t getEnd() const noexcept
+        {
+            return this->size == UNKNOWN_SIZE ? UNKNOWN_SIZE : this->dataStart + this->size;
+        }
+    };
+
+    uint64_t getPosition(std::istream &stream)
+    {
+        return static_cast<uint64_t>(stream.tellg());
+    }
+
+    void seek(std::istream &stream, const uint64_t &position)
+    {
+        stream.clear();
+        stream.seekg(static_cast<std::streamoff>(position));
+    }
+
+    /**
+     * \brief Reads an EBML variable size integer.
+     * \param keepMarker true to keep the length marker bit, as used for element IDs
+     * \return false at the end of the stream
+     */
+    bool readVint(std::istream &stream, uint64_t &value, const bool &keepMarker, uint8_t &length)
+    {
+        const int first = stream.get();
+        if (first == std::char_traits<char>::eof())
+        {
+            return false;
+        }
+        if (first == 0)
+        {
+            throw ImportException("MatroskaReader: invalid EBML variable size integer.");
+        }
+
+        length = 1u;
+        while ((first & (0x80 >> (length - 1u))) == 0)
+        {
+            ++length;
+        }
+
+        value = keepMarker ? static_cast<uint64_t>(first) : static_cast<uint64_t>(first & (0xFF >> length));
+        for (uint8_t i = 1u; i < length; ++i)
+        {
+            const int next = stream.get();
+            if (next == std::char_traits<char>::eof())
+            {
+                throw ImportException("MatroskaReader: unexpected end of stream.");
+            }
+            value = (value << 8u) | static_cast<uint8_t>(next);
+        }
+
+        return true;
+    }
+
+    bool readElementHeader(std::istream &stream, ElementHeader &header)
+    {
+        header.start = getPosition(stream);
+
+        uint64_t id;
+        uint8_t length;
+        if (!readVint(stream, id, true, length))
+        {
+            return false;
+        }
+        if (length > 4u)
+        {
+            throw ImportException("MatroskaReader: element ID is longer than 4 bytes.");
+        }
+        header.id = static_cast<uint32_t>(id);
+
+        if (!readVint(stream, header.size, false, length))
+        {
+            throw ImportException("MatroskaReader: unexpected end of stream.");
+        }
+        // A size with all value bits set means the size is unknown.
+        if (header.size == (uint64_t(1u) << (7u * length)) - 1u)
+        {
+            header.size = UNKNOWN_SIZE;
+        }
+        header.dataStart = getPosition(stream);
+
+        return true;
+    }
+
+    vector<uint8_t> readBytes(std::istream &stream, const uint64_t &size)
+    {
+        vector<uint8_t> bytes(size);
+        stream.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(size));
+        if (static_cast<uint64_t>(stream.gcount()) != size)
+        {
+            throw ImportException("MatroskaReader: unexpected end of stream.");
+        }
+        return bytes;
+    }
+
+    uint64_t readUnsigned(std::istream &stream, const uint64_t &size)
+    {
+        if (size > 8u)
+        {
+            throw ImportException("MatroskaReader: unsigned integer element is longer than 8 bytes.");
+        }
+
+        uint64_t value = 0u;
+        for (const auto &byte : readBytes(stream, size))
+        {
+            value = (value << 8u) | byte;
+        }
+        return value;
+    }
+
+    string readString(std::istream &stream, const uint64_t &size)
+    {
+        const auto bytes = readBytes(stream, size);
+        const auto end = std::find(bytes.begin(), bytes.end(), 0u);
+        return string(bytes.begin(), end);
+    }
+
+    /**
+     * \brief Calls the handler for every child of an element with a known size, then moves past the child.
+     */
+    template<typename Handler>
+    void readChildren(std::istream &stream, const ElementHeader &parent, Handler handler)
+    {
+        if (parent.size == UNKNOWN_SIZE)
+        {
+            throw ImportException("MatroskaReader: unexpected element of unknown size.");
+        }
+
+        seek(stream, parent.dataStart);
+        ElementHeader child{};
+        while (getPosition(stream) < parent.getEnd() && readElementHeader(stream, child))
+        {
+            if (child.getEnd() > parent.getEnd())
+            {
+                throw ImportException("MatroskaReader: element is larger than its parent.");
+            }
+            handler(child);
+            seek(stream, child.getEnd());
+        }
+    }
+
+    bool isTopLevel(const uint32_t &id)
+    {
+        return id == ID_CLUSTER || id == ID_CUES || id == ID_SEEK_HEAD || id == ID_INFO || id == ID_TRACKS ||
+               id == ID_TAGS || id == ID_CHAPTERS || id == ID_ATTACHMENTS || id == ID_SEGMENT || id == ID_EBML;
+    }
+
+    /**
+     * \brief Splits the payload of a laced block into its frames.
+     * \param payload block data following the block header
+     * \param lacing lacing bits of the block flags
+     */
+    vector<vector<uint8_t>> splitFrames(const vector<uint8_t> &payload, const uint8_t &lacing)
+    {
+        if (lacing == 0u)
+        {
+            return {payload};
+        }
+        if (payload.empty())
+        {
+            throw ImportException("MatroskaReader: laced block without frames.");
+        }
+
+        const size_t numFrames = payload[0] + 1u;
+        size_t readPos = 1u;
+        vector<uint64_t> sizes;
+
+        auto readLacedVint = [&](uint64_t &value) -> uint8_t {
+            if (readPos >= payload.size() || payload[readPos] == 0u)
+            {
+                throw ImportException("MatroskaReader: invalid EBML lacing.");
+            }
+            uint8_t length = 1u;
+            while ((payload[readPos] & (0x80u >> (length - 1u))) == 0u)
+            {
+                ++length;
+            }
+            if (readPos + length > payload.size())
+            {
+                throw ImportException("MatroskaReader: invalid EBML lacing.");
+            }
+            value = payload[readPos] & (0xFFu >> length);
+            for (uint8_t i = 1u; i < length; ++i)
+            {
+                value = (value << 8u) | payload[readPos + i];
+            }
+            readPos += length;
+            return length;
+        };
+
+        switch (lacing)
+        {
+            case 0x02u: // Xiph
+                for (size_t i = 0; i + 1u < numFrames; ++i)
+                {
+                    uint64_t size = 0u;
+                    uint8_t byte;
+                    do
+                    {
+                        if (readPos >= payload.size())
+                        {
+                            throw ImportException("MatroskaReader: invalid Xiph lacing.");
+                        }
+                        byte = payload[readPos++];
+                        size += byte;
+                    } while (byte == 0xFFu);
+                    sizes.push_back(size);
+                }
+                break;
+            case 0x06u: // EBML, with each size after the first stored as a signed difference
+            {
+                uint64_t size;
+                readLacedVint(size);
+                sizes.push_back(size);
+                for (size_t i = 1; i + 1u < numFrames; ++i)
+                {
+                    uint64_t difference;
+                    const auto length = readLacedVint(difference);
+                    const auto bias = (int64_t(1) << (7u * length - 1u)) - 1;
+                    const int64_t next = static_cast<int64_t>(sizes.back()) + static_cast<int64_t>(difference) - bias;
+                    if (next < 0)
+                    {
+                        throw ImportException("MatroskaReader: invalid EBML lacing.");
+                    }
+                    sizes.push_back(static_cast<uint64_t>(next));
+                }
+                break;
+            }
+            default: // Fixed size
+                break;
+        }
+
+        const uint64_t remaining = payload.size() - readPos;
+        if (lacing == 0x04u)
+        {
+            sizes.assign(numFrames - 1u, remaining / numFrames);
+        }
+
+        uint64_t total = 0u;
+        for (const auto &size : sizes)
+        {
+            total += size;
+        }
+        if (total > remaining)
+        {
+            throw ImportException("MatroskaReader: laced frames are larger than their block.");
+        }
+        sizes.push_back(remaining - total);
+
+        vector<vector<uint8_t>> frames;
+        for (const auto &size : sizes)
+        {
+            frames.emplace_back(payload.begin() + readPos, payload.begin() + readPos + size);
+            readPos += size;
+        }
+        return frames;
+    }
+
+#if defined(PGS_HAVE_ZLIB)
+    vector<uint8_t> inflateFrame(const vector<uint8_t> &compressed)
+    {
+        z_stream zstream{};
+        if (inflateInit(&zstream) != Z_OK)
+        {
+            throw ImportException("MatroskaReader: failed to initialize zlib.");
+        }
+
+        vector<uint8_t> frame(std::max<size_t>(compressed.size() * 4u, 1024u));
+        zstream.next_in = const_cast<Bytef *>(compressed.data());
+        zstream.avail_in = static_cast<uInt>(compressed.size());
+
+        int result;
+        do
+        {
+            if (zstream.total_out == frame.size())
+            {
+                frame.resize(frame.size() * 2u);
+            }
+            zstream.next_out = frame.data() + zstream.total_out;
+            zstream.avail_out = static_cast<uInt>(frame.size() - zstream.total_out);
+            result = inflate(&zstream, Z_NO_FLUSH);
+        } while (result == Z_OK);
+
+        frame.resize(zstream.total_out);
+        inflateEnd(&zstream);
+        if (result != Z_STREAM_END)
+        {
+            throw ImportException("MatroskaReader: failed to decompress a zlib compressed frame.");
+        }
+        return frame;
+    }
+#endif
+}
+
+MatroskaTrack::MatroskaTrack()
+{
+    this->number = 0u;
+    this->language = "eng";
+    this->forced = false;
+    this->defaultTrack = true;
+    this->compressionAlgorithm = MatroskaTrack::NO_COMPRESSION;
+}
+
+// ====================
+// MatroskaTrack Getters
+// ====================
+
+const uint64_t &MatroskaTrack::getNumber() const noexcept
+{
+    return this->number;
+}
+
+const string &MatroskaTrack::getLanguage() const noexcept
+{
+    return this->language;
+}
+
+const string &MatroskaTrack::getName() const noexcept
+{
+    return this->name;
+}
+
+const bool &MatroskaTrack::isForced() const noexcept
+{
+    return this->forced;
+}
+
+const bool &MatroskaTrack::isDefault() const noexcept
+{
+    return this->defaultTrack;
+}
+
+const uint64_t &MatroskaTrack::getCompressionAlgorithm() const noexcept
+{
+    return this->compressionAlgorithm;
+}
+
+const vector<uint8_t> &MatroskaTrack::getStrippedHeader() const noexcept
+{
+    return this->strippedHeader;
+}
+
+// ==============
+// MatroskaReader
+// ==============
+
+MatroskaReader::MatroskaReader(std::istream &stream) : stream(stream)
+{
+    this->segmentDataStart = 0u;
+    this->segmentDataEnd = UNKNOWN_SIZE;
+    this->firstClusterPosition = UNKNOWN_SIZE;
+    this->cuesPosition = UNKNOWN_SIZE;
+    this->timestampScale = 1000000u;
+
+    this->readHeaders();
+}
+
+void MatroskaReader::readHeaders()
+{
+    seek(this->stream, 0u);
+
+    ElementHeader header{};
+    if (!readElementHeader(this->stream, header) || header.id != ID_EBML || header.size == UNKNOWN_SIZE)
+    {
+        throw ImportException("MatroskaReader: stream doesn't start with an EBML header.");
+    }
+    seek(this->stream, header.getEnd());
+
+    if (!readElementHeader(this->stream, header) || header.id != ID_SEGMENT)
+    {
+        throw ImportException("MatroskaReader: stream doesn't contain a Segment.");
+    }
+    this->segmentDataStart = header.dataStart;
+    this->segmentDataEnd = header.getEnd();
+
+    // Everything needed is stored before the first Cluster, except the Cues which the SeekHead points to.
+    while (getPosition(this->stream) < this->segmentDataEnd && readElementHeader(this->stream, header))
+    {
+        if (header.id == ID_CLUSTER)
+        {
+            this->firstClusterPosition = header.start;
+            break;
+        }
+
+        switch (header.id)
+        {
+            case ID_INFO:
+                readChildren(this->stream, header, [&](const ElementHeader &child) {
+                    if (child.id == ID_TIMESTAMP_SCALE)
+                    {
+                        this->timestampScale = readUnsigned(this->stream, child.size);
+                    }
+                });
+                break;
+            case ID_TRACKS:
+                this->readTracks(header.getEnd());
+                break;
+            case ID_SEEK_HEAD:
+                readChildren(this->stream, header, [&](const ElementHeader &seekEntry) {
+                    if (seekEntry.id != ID_SEEK)
+                    {
+                        return;
+                    }
+                    uint64_t id = 0u, position = UNKNOWN_SIZE;
+                    readChildren(this->stream, seekEntry, [&](const ElementHeader &child) {
+                        if (child.id == ID_SEEK_ID)
+                        {
+                            id = readUnsigned(this->stream, child.size);
+                        }
+                        else if (child.id == ID_SEEK_POSITION)
+                        {
+                            position = readUnsigned(this->stream, child.size);
+                        }
+                    });
+                    if (id == ID_CUES && position != UNKNOWN_SIZE)
+                    {
+                        this->cuesPosition = this->segmentDataStart + position;
+                    }
+                });
+                break;
+            case ID_CUES:
+                this->cuesPosition = header.start;
+                break;
+            default:
+                break;
+        }
+
+        if (header.size == UNKNOWN_SIZE)
+        {
+            throw ImportException("MatroskaReader: unexpected element of unknown size.");
+        }
+        seek(this->stream, header.getEnd());
+    }
+
+    if (this->timestampScale == 0u)
+    {
+        throw ImportException("MatroskaReader: invalid timestamp scale.");
+    }
+}
+
+void MatroskaReader::readTracks(const uint64_t &end)
+{
+    ElementHeader tracks{};
+    tracks.dataStart = getPosition(this->stream);
+    tracks.size = end - tracks.dataStart;
+
+    readChildren(this->stream, tracks, [&](const ElementHeader &entry) {
+        if (entry.id != ID_TRACK_ENTRY)
+        {
+            return;
+        }
+
+        MatroskaTrack track;
+        string codecID;
+        readChildren(this->stream, entry, [&](const ElementHeader &child) {
+            switch (child.id)
+            {
+                case ID_TRACK_NUMBER:
+                    track.number = readUnsigned(this->stream, child.size);
+                    break;
+                case ID_CODEC_ID:
+                    codecID = readString(this->stream, child.size);
+                    break;
+                case ID_LANGUAGE:
+                    track.language = readString(this->stream, child.size);
+                    break;
+                case ID_NAME:
+                    track.name = readString(this->stream, child.size);
+                    break;
+                case ID_FLAG_DEFAULT:
+                    track.defaultTrack = readUnsigned(this->stream, child.size) != 0u;
+                    break;
+                case ID_FLAG_FORCED:
+                    track.forced = readUnsigned(this->stream, child.size) != 0u;
+                    break;
+                case ID_CONTENT_ENCODINGS:
+                    readChildren(this->stream, child, [&](const ElementHeader &encoding) {
+                        if (encoding.id != ID_CONTENT_ENCODING)
+                        {
+                            return;
+                        }
+                        readChildren(this->stream, encoding, [&](const ElementHeader &compression) {
+                            if (compression.id != ID_CONTENT_COMPRESSION)
+                            {
+                                return;
+                            }
+                            track.compressionAlgorithm = ZLIB_COMPRESSION;
+                            readChildren(this->stream, compression, [&](const ElementHeader &setting) {
+                                if (setting.id == ID_CONTENT_COMP_ALGO)
+                                {
+                                    track.compressionAlgorithm = readUnsigned(this->stream, setting.size);
+                                }
+                                else if (setting.id == ID_CONTENT_COMP_SETTINGS)
+                                {
+                                    track.strippedHeader = readBytes(this->stream, setting.size);
+                                }
+                            });
+                        });
+                    });
+                    break;
+                default:
+                    break;
+            }
+        });
+
+        if (codecID == PGS_CODEC_ID)
+        {
+            this->tracks.push_back(track);
+        }
+    });
+}
+
+vector<uint64_t> MatroskaReader::readCueClusters(const uint64_t &trackNumber)
+{
+    vector<uint64_t> positions;
+    seek(this->stream, this->cuesPosition);
+
+    ElementHeader cues{};
+    if (!readElementHeader(this->stream, cues) || cues.id != ID_CUES || cues.size == UNKNOWN_SIZE)
+    {
+        return positions;
+    }
+
+    readChildren(this->stream, cues, [&](const ElementHeader &cuePoint) {
+        if (cuePoint.id != ID_CUE_POINT)
+        {
+            return;
+        }
+        readChildren(this->stream, cuePoint, [&](const ElementHeader &trackPositions) {
+            if (trackPositions.id != ID_CUE_TRACK_POSITIONS)
+            {
+                return;
+            }
+            uint64_t track = 0u, position = UNKNOWN_SIZE;
+            readChildren(this->stream, trackPositions, [&](const ElementHeader &child) {
+                if (child.id == ID_CUE_TRACK)
+                {
+                    track = readUnsigned(this->stream, child.size);
+                }
+                else if (child.id == ID_CUE_CLUSTER_POSITION)
+                {
+                    position = readUnsigned(this->stream, child.size);
+                }
+            });
+            if (track == trackNumber && position != UNKNOWN_SIZE)
+            {
+                positions.push_back(this->segmentDataStart + position);
+            }
+        });
+    });
+
+    std::sort(positions.begin(), positions.end());
+    positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+    return positions;
+}
+
+uint64_t MatroskaReader::readCluster(const MatroskaTrack &track, std::ostream &out)
+{
+    ElementHeader cluster{};
+    if (!readElementHeader(this->stream, cluster) || cluster.id != ID_CLUSTER)
+    {
+        throw ImportException("MatroskaReader: expected a Cluster.");
+    }
+
+    uint64_t clusterTime = 0u;
+    uint64_t numFrames = 0u;
+
+    auto readBlock = [&](const ElementHeader &block) {
+        uint64_t blockTrack;
+        uint8_t length;
+        if (!readVint(this->stream, blockTrack, false, length))
+        {
+            throw ImportException("MatroskaReader: unexpected end of stream.");
+        }
+        // Blocks of other tracks are skipped without reading their payload.
+        if (blockTrack != track.number)
+        {
+            return;
+        }
+
+        const auto header = readBytes(this->stream, 3u);
+        const auto relativeTime = static_cast<int16_t>(header[0] << 8u | header[1]);
+        const uint8_t lacing = header[2] & 0x06u;
+        const int64_t time = std::max<int64_t>(0, static_cast<int64_t>(clusterTime) + relativeTime);
+
+        const uint64_t payloadStart = getPosition(this->stream);
+        if (payloadStart > block.getEnd())
+        {
+            throw ImportException("MatroskaReader: block is smaller than its header.");
+        }
+        const auto payload = readBytes(this->stream, block.getEnd() - payloadStart);
+
+        // PGS timestamps wrap around at 32 bits.
+        const auto presentationTime = static_cast<uint32_t>(static_cast<uint64_t>(time) * this->timestampScale * 9u /
+                                                            100000u);
+        for (auto &frame : splitFrames(payload, lacing))
+        {
+            MatroskaReader::writeFrame(track, std::move(frame), presentationTime, out);
+            ++numFrames;
+        }
+    };
+
+    ElementHeader child{};
+    while (getPosition(this->stream) < cluster.getEnd() && readElementHeader(this->stream, child))
+    {
+        // A Cluster of unknown size ends where the next top-level element starts.
+        if (cluster.size == UNKNOWN_SIZE && isTopLevel(child.id))
+        {
+            seek(this->stream, child.start);
+            break;
+        }
+        if (child.size == UNKNOWN_SIZE)
+        {
+            throw ImportException("MatroskaReader: unexpected element of unknown size.");
+        }
+
+        switch (child.id)
+        {
+            case ID_CLUSTER_TIMESTAMP:
+                clusterTime = readUnsigned(this->stream, child.size);
+                break;
+            case ID_SIMPLE_BLOCK:
+                readBlock(child);
+                break;
+            case ID_BLOCK_GROUP:
+                readChildren(this->stream, child, [&](const ElementHeader &groupChild) {
+                    if (groupChild.id == ID_BLOCK)
+                    {
+                        readBlock(groupChild);
+                    }
+                });
+                break;
+            default:
+                break;
+        }
+        seek(this->stream, child.getEnd());
+    }
+
+    return numFrames;
+}
+
+void MatroskaReader::writeFrame(const MatroskaTrack &track, vector<uint8_t> frame, const uint32_t &presentationTime,
+                                std::ostream &out)
+{
+    if (track.compressionAlgorithm == HEADER_STRIPPING)
+    {
+        frame.insert(frame.begin(), track.strippedHeader.begin(), track.strippedHeader.end());
+    }
+    else if (track.compressionAlgorithm == ZLIB_COMPRESSION)
+    {
+#if defined(PGS_HAVE_ZLIB)
+        frame = inflateFrame(frame);
+#else
+        throw ImportException("MatroskaReader: track is zlib compressed, but pgs++ was built without zlib.");
+#endif
+    }
+    else if (track.compressionAlgorithm != MatroskaTrack::NO_COMPRESSION)
+    {
+        throw ImportException("MatroskaReader: track uses an unsupported compression algorithm.");
+    }
+
+    // Put the magic number and timestamps back in front of every segment.
+    vector<uint8_t> segments;
+    segments.reserve(frame.size() + frame.size() / 8u + 16u);
+    ByteWriter writer(segments);
+    size_t readPos = 0u;
+    while (readPos + 3u <= frame.size())
+    {
+        const size_t segmentSize = 3u + (static_cast<size_t>(frame[readPos + 1u]) << 8u | frame[readPos + 2u]);
+        if (readPos + segmentSize > frame.size())
+        {
+            break;
+        }
+
+        writer.write8('P');
+        writer.write8('G');
+        writer.write32(presentationTime);
+        writer.write32(0u);
+        writer.writeBytes(frame.data() + readPos, segmentSize);
+        readPos += segmentSize;
+    }
+
+    out.write(reinterpret_cast<const char *>(segments.data()), static_cast<std::streamsize>(segments.size()));
+}
+
+uint64_t MatroskaReader::extract(const uint64_t &trackNumber, std::ostream &out, const bool &useCues)
+{
+    const auto track = std::find_if(this->tracks.begin(), this->tracks.end(), [&](const MatroskaTrack &entry) {
+        return entry.number == trackNumber;
+    });
+    if (track == this->tracks.end())
+    {
+        throw ImportException("MatroskaReader::extract: file doesn't contain a PGS track with that number.");
+    }
+
+    uint64_t numFrames = 0u;
+    const auto clusters = useCues && this->cuesPosition != UNKNOWN_SIZE ? this->readCueClusters(trackNumber) :
+                          vector<uint64_t>();
+    if (!clusters.empty())
+    {
+        for (const auto &position : clusters)
+        {
+            seek(this->stream, position);
+            numFrames += this->readCluster(*track, out);
+        }
+        return numFrames;
+    }
+
+    if (this->firstClusterPosition == UNKNOWN_SIZE)
+    {
+        return 0u;
+    }
+
+    seek(this->stream, this->firstClusterPosition);
+    ElementHeader header{};
+    uint64_t position = this->firstClusterPosition;
+    while (position < this->segmentDataEnd && readElementHeader(this->stream, header))
+    {
+        if (header.id == ID_CLUSTER)
+        {
+            seek(this->stream, header.start);
+            numFrames += this->readCluster(*track, out);
+        }
+        else if (header.size == UNKNOWN_SIZE)
+        {
+            throw ImportException("MatroskaReader: unexpected element of unknown size.");
+        }
+        else
+        {
+            seek(this->stream, header.getEnd());
+        }
+        position = getPosition(this->stream);
+    }
+
+    return numFrames;
+}
+
+vector<char> MatroskaReader::extract(const uint64_t &trackNumber, const bool &useCues)
+{
+    std::ostringstream out;
+    this->extract(trackNumber, out, useCues);
+    const auto data = out.str();
+    return vector<char>(data.begin(), data.end());
+}
+
+// =======
+// Getters
+// =======
+
+const vector<MatroskaTrack> &MatroskaReader::getTracks() const noexcept
+{
+    return this->tracks;
+}
+
+const uint64_t &MatroskaReader::getTimestampScale() const noexcept
+{
+    return this->timestampScale;
+}
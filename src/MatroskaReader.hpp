@@ -0,0 +1,177 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#pragma once
+
+#include "SegmentData.hpp"
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Pgs
+{
+    /**
+     * \brief A PGS subtitle track found in a Matroska file.
+     */
+    class MatroskaTrack
+    {
+    protected:
+        uint64_t number; /**< Track number used by the blocks of the track. */
+        std::string language; /**< Language of the track, "eng" if not set. */
+        std::string name; /**< Name of the track, if any. */
+        bool forced; /**< True if the track is flagged as forced. */
+        bool defaultTrack; /**< True if the track is flagged as default. */
+        uint64_t compressionAlgorithm; /**< ContentCompAlgo of the track, or NO_COMPRESSION. */
+        std::vector<uint8_t> strippedHeader; /**< Bytes removed from every frame by header stripping. */
+    public:
+        /**
+         * \brief Value of compressionAlgorithm for tracks whose frames are stored as they are.
+         */
+        static constexpr uint64_t NO_COMPRESSION = UINT64_MAX;
+
+        MatroskaTrack();
+
+        // =======
+        // Getters
+        // =======
+
+        [[nodiscard]] const uint64_t &getNumber() const noexcept;
+
+        [[nodiscard]] const std::string &getLanguage() const noexcept;
+
+        [[nodiscard]] const std::string &getName() const noexcept;
+
+        [[nodiscard]] const bool &isForced() const noexcept;
+
+        [[nodiscard]] const bool &isDefault() const noexcept;
+
+        [[nodiscard]] const uint64_t &getCompressionAlgorithm() const noexcept;
+
+        [[nodiscard]] const std::vector<uint8_t> &getStrippedHeader() const noexcept;
+
+        friend class MatroskaReader;
+    };
+
+    /**
+     * \brief Extracts PGS subtitle tracks (S_HDMV/PGS) from Matroska (.mkv/.mks) files.
+     *
+     * \details
+     * Matroska stores each PGS display set as one block, with its segments stripped of the "PG" magic number and
+     * timestamps. The reader puts those back, using the block timestamp as the PTS, so the output is regular PGS
+     * data that Subtitle::createAll and DisplaySetInfo::scanAll accept as is.
+     * <br/><br/>Only element headers are read while walking the file. Blocks of other tracks are skipped with a
+     * seek after reading their track number, so video and audio payloads are never read. Every Cluster is visited
+     * by default, since muxers aren't required to list every subtitle block in the Cues. Visiting only the clusters
+     * the Cues list for the track can be requested when the Cues are known to be complete.
+     * <br/><br/>zlib compressed tracks (mkvmerge's default for PGS) can only be read when the library was built
+     * with zlib. Header stripping is always supported.
+     */
+    class MatroskaReader
+    {
+    protected:
+        std::istream &stream; /**< Stream holding the Matroska file. */
+        uint64_t segmentDataStart; /**< Stream position of the Segment's data, which positions are relative to. */
+        uint64_t segmentDataEnd; /**< Stream position of the Segment's end, or UINT64_MAX if unknown. */
+        uint64_t firstClusterPosition; /**< Stream position of the first Cluster. */
+        uint64_t cuesPosition; /**< Stream position of the Cues, or UINT64_MAX if unknown. */
+        uint64_t timestampScale; /**< Nanoseconds per block timestamp unit. */
+        std::vector<MatroskaTrack> tracks; /**< PGS tracks found in the file. */
+
+        /**
+         * \brief Reads the top-level elements found before the first Cluster.
+         */
+        void readHeaders();
+
+        /**
+         * \brief Reads the Tracks element and keeps the PGS tracks.
+         */
+        void readTracks(const uint64_t &end);
+
+        /**
+         * \brief Reads the positions of the Clusters holding blocks of a track from the Cues.
+         * \return Cluster stream positions in ascending order, or an empty vector if there are none.
+         */
+        std::vector<uint64_t> readCueClusters(const uint64_t &trackNumber);
+
+        /**
+         * \brief Reads a Cluster, appending the frames of a track.
+         * \param track track to extract
+         * \param out stream receiving the PGS data
+         * \return number of frames written
+         */
+        uint64_t readCluster(const MatroskaTrack &track, std::ostream &out);
+
+        /**
+         * \brief Converts one frame of a track back into PGS segments.
+         * \param track track the frame belongs to
+         * \param frame frame data as stored in the block
+         * \param presentationTime frame timestamp with 90kHz accuracy
+         * \param out stream receiving the PGS data
+         */
+        static void writeFrame(const MatroskaTrack &track, std::vector<uint8_t> frame, const uint32_t &presentationTime,
+                               std::ostream &out);
+    public:
+        /**
+         * \brief Reads the headers of a Matroska file.
+         * \param stream stream holding the file. Must be seekable and outlive the reader.
+         *
+         * \throws ImportException if the stream isn't a Matroska file.
+         */
+        explicit MatroskaReader(std::istream &stream);
+
+        /**
+         * \brief Extracts a PGS track.
+         *
+         * \param trackNumber number of the track to extract
+         * \param out stream receiving the PGS data
+         * \param useCues set to true to only visit the Clusters the Cues list for the track, if there are any.
+         * Subtitle blocks in Clusters without a cue entry are then left out.
+         * \return number of display sets extracted
+         *
+         * \throws ImportException if the track doesn't exist, the file is malformed or the track can't be decompressed.
+         */
+        uint64_t extract(const uint64_t &trackNumber, std::ostream &out, const bool &useCues = false);
+
+        /**
+         * \brief Extracts a PGS track into memory.
+         * \param trackNumber number of the track to extract
+         * \param useCues set to true to only visit the Clusters the Cues list for the track, if there are any
+         * \return PGS data of the track
+         *
+         * \throws ImportException
+         */
+        std::vector<char> extract(const uint64_t &trackNumber, const bool &useCues = false);
+
+        // =======
+        // Getters
+        // =======
+
+        /**
+         * \brief Gets the PGS tracks found in the file.
+         * \return PGS tracks, in the order they're listed in the file
+         */
+        [[nodiscard]] const std::vector<MatroskaTrack> &getTracks() const noexcept;
+
+        [[nodiscard]] const uint64_t &getTimestampScale() const noexcept;
+    };
+}
@@ -19,22 +19,24 @@
 */
 
 #include "ObjectDefinition.hpp"
+#include "ByteReader.hpp"
+#include "ByteWriter.hpp"
 #include "PgsUtil.hpp"
-#include <endian.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
 
 using std::shared_ptr;
 using std::vector;
 
 using namespace Pgs;
 
-uint32_t ObjectDefinition::read3Bytes(const uint8_t *data, uint16_t &readPos)
-{
-    auto val = static_cast<uint32_t>((data[readPos] << 16u) | (data[readPos + 1] << 8u) |
-                                     (data[readPos + 2]) & 0x00FFFFFF);
-    readPos += 3;
-
-    return le32toh(val);
-}
+constexpr uint16_t ObjectDefinition::MIN_BYTE_SIZE;
+constexpr uint16_t ObjectDefinition::MIN_CONTINUATION_BYTE_SIZE;
+constexpr uint16_t ObjectDefinition::MAX_SEGMENT_DATA_SIZE;
+constexpr uint16_t ObjectDefinition::MAX_RUN_LENGTH;
 
 ObjectDefinition::ObjectDefinition()
 {
@@ -46,45 +48,310 @@ ObjectDefinition::ObjectDefinition()
     this->height = 0u;
 }
 
-uint16_t ObjectDefinition::import(const char *data, const uint16_t &size)
+ParseError ObjectDefinition::tryImportHeader(const char *data, const uint16_t &size, uint16_t &readSize)
 {
     if(!data)
     {
-        throw ImportException("ObjectDefinition: no data provided to import.");
+        return ParseError::NoData;
     }
 
-    if(size < ObjectDefinition::MIN_BYTE_SIZE)
+    if(size < ObjectDefinition::MIN_CONTINUATION_BYTE_SIZE)
     {
-        throw ImportException("ObjectDefinition: Insufficient data provided to import.");
+        return ParseError::InsufficientData;
     }
 
-    const auto byteData = reinterpret_cast<const uint8_t *>(data);
-    uint16_t readPos = 0u;
-    this->id = read2Bytes(byteData, readPos);
-    this->version = byteData[readPos];
-    ++readPos;
-    this->sequenceFlag = SequenceFlag(byteData[readPos]);
-    ++readPos;
+    ByteReader reader(data, size);
+    this->id = reader.read16();
+    this->version = reader.read8();
+    this->sequenceFlag = SequenceFlag(reader.read8());
+    this->objectData.clear();
+
+    // Only the first fragment of an object carries the data length and dimensions.
+    if (!this->isFirstFragment())
+    {
+        this->dataLength = 0u;
+        this->width = 0u;
+        this->height = 0u;
+
+        readSize = reader.getPosition();
+        return ParseError::None;
+    }
+
+    if(size < ObjectDefinition::MIN_BYTE_SIZE)
+    {
+        return ParseError::InsufficientData;
+    }
 
     /*
      * At some point, I should check what exactly this value is counting. An individual segment can't be
      * larger than 64kb, but a 24-bit size value allows for indexing up to ~16mb. This value is likely the
      * total number of bytes across the entire sequence.
      */
-    this->dataLength = read3Bytes(byteData, readPos);
+    this->dataLength = reader.read24();
+
+    this->width = reader.read16();
+    this->height = reader.read16();
+
+    readSize = reader.getPosition();
+    return ParseError::None;
+}
+
+uint16_t ObjectDefinition::importHeader(const char *data, const uint16_t &size)
+{
+    uint16_t readSize = 0u;
+    const auto error = this->tryImportHeader(data, size, readSize);
+    if (error != ParseError::None)
+    {
+        throw ImportException(getParseErrorMessage(error));
+    }
 
-    this->width = read2Bytes(byteData, readPos);
-    this->height = read2Bytes(byteData, readPos);
+    return readSize;
+}
+
+ParseError ObjectDefinition::tryImport(const char *data, const uint16_t &size, uint16_t &readSize)
+{
+    uint16_t readPos = 0u;
+    const auto error = this->tryImportHeader(data, size, readPos);
+    if (error != ParseError::None)
+    {
+        return error;
+    }
 
     const uint16_t remainingSize = size - readPos;
     this->objectData.resize(remainingSize);
-    for(uint16_t i = 0u; i < remainingSize; ++i)
+    if (remainingSize > 0u)
     {
-        this->objectData[i] = byteData[readPos];
-        ++readPos;
+        std::memcpy(this->objectData.data(), data + readPos, remainingSize);
+    }
+    readPos += remainingSize;
+
+    readSize = readPos;
+    return ParseError::None;
+}
+
+void ObjectDefinition::appendFragment(const ObjectDefinition &fragment)
+{
+    this->objectData.insert(this->objectData.end(), fragment.objectData.begin(), fragment.objectData.end());
+    this->sequenceFlag = SequenceFlag(static_cast<uint8_t>(this->sequenceFlag) |
+                                      static_cast<uint8_t>(fragment.sequenceFlag));
+}
+
+void ObjectDefinition::serialize(ByteWriter &writer) const
+{
+    writer.write16(this->id);
+    writer.write8(this->version);
+    writer.write8(static_cast<uint8_t>(this->sequenceFlag));
+    if (this->isFirstFragment())
+    {
+        writer.write24(this->dataLength);
+        writer.write16(this->width);
+        writer.write16(this->height);
+    }
+    writer.writeBytes(this->objectData.data(), this->objectData.size());
+}
+
+vector<shared_ptr<ObjectDefinition>> ObjectDefinition::splitFragments() const
+{
+    const auto flag = static_cast<uint8_t>(this->sequenceFlag);
+    const auto firstBit = static_cast<uint8_t>(SequenceFlag::First);
+    const auto lastBit = static_cast<uint8_t>(SequenceFlag::Last);
+
+    auto fragments = vector<shared_ptr<ObjectDefinition>>();
+    size_t readPos = 0u;
+    do
+    {
+        const bool first = fragments.empty() && this->isFirstFragment();
+        const size_t capacity = ObjectDefinition::MAX_SEGMENT_DATA_SIZE -
+                                (first ? ObjectDefinition::MIN_BYTE_SIZE : ObjectDefinition::MIN_CONTINUATION_BYTE_SIZE);
+        const size_t count = std::min(capacity, this->objectData.size() - readPos);
+
+        auto fragment = std::make_shared<ObjectDefinition>();
+        fragment->id = this->id;
+        fragment->version = this->version;
+        fragment->objectData.assign(this->objectData.begin() + readPos, this->objectData.begin() + readPos + count);
+        readPos += count;
+
+        // Only the first piece keeps the First bit and only the final piece keeps the Last bit.
+        const bool last = readPos >= this->objectData.size();
+        fragment->sequenceFlag = SequenceFlag((fragments.empty() ? flag & firstBit : 0u) |
+                                              (last ? flag & lastBit : 0u));
+        if (first)
+        {
+            fragment->dataLength = this->dataLength;
+            fragment->width = this->width;
+            fragment->height = this->height;
+        }
+
+        fragments.push_back(fragment);
+    } while (readPos < this->objectData.size());
+
+    return fragments;
+}
+
+vector<uint8_t> ObjectDefinition::encodeObjectData(const uint8_t *pixels, const uint16_t &width,
+                                                   const uint16_t &height, const uint32_t &stride)
+{
+    if (!pixels && width > 0u && height > 0u)
+    {
+        throw std::invalid_argument("ObjectDefinition::encodeObjectData: no pixel data provided.");
+    }
+
+    vector<uint8_t> data;
+    data.reserve(static_cast<size_t>(height) * (width / 4u + 2u));
+    for (uint16_t y = 0u; y < height; ++y)
+    {
+        const uint8_t *line = pixels + static_cast<size_t>(y) * stride;
+        uint32_t x = 0u;
+        while (x < width)
+        {
+            const auto length = static_cast<uint32_t>(findRunLength(line + x, width - x));
+            ObjectDefinition::encodeRun(data, line[x], length);
+            x += length;
+        }
+
+        // End of line
+        data.push_back(0u);
+        data.push_back(0u);
+    }
+
+    return data;
+}
+
+void ObjectDefinition::encodeRun(vector<uint8_t> &data, const uint8_t &color, uint32_t length)
+{
+    while (length > 0u)
+    {
+        const auto count = static_cast<uint16_t>(std::min<uint32_t>(length, ObjectDefinition::MAX_RUN_LENGTH));
+        length -= count;
+
+        if (color == 0u)
+        {
+            data.push_back(0u);
+            if (count < 64u)
+            {
+                // 00 00LLLLLL
+                data.push_back(static_cast<uint8_t>(count));
+            }
+            else
+            {
+                // 00 01LLLLLL LLLLLLLL
+                data.push_back(static_cast<uint8_t>(0x40u | (count >> 8u)));
+                data.push_back(static_cast<uint8_t>(count & 0xFFu));
+            }
+        }
+        else if (count < 3u)
+        {
+            // CCCCCCCC, once per pixel
+            data.insert(data.end(), count, color);
+        }
+        else
+        {
+            data.push_back(0u);
+            if (count < 64u)
+            {
+                // 00 10LLLLLL CCCCCCCC
+                data.push_back(static_cast<uint8_t>(0x80u | count));
+            }
+            else
+            {
+                // 00 11LLLLLL LLLLLLLL CCCCCCCC
+                data.push_back(static_cast<uint8_t>(0xC0u | (count >> 8u)));
+                data.push_back(static_cast<uint8_t>(count & 0xFFu));
+            }
+            data.push_back(color);
+        }
+    }
+}
+
+vector<shared_ptr<ObjectDefinition>> ObjectDefinition::createFragments(const uint16_t &id, const uint8_t &version,
+                                                                       const uint8_t *pixels, const uint16_t &width,
+                                                                       const uint16_t &height, const uint32_t &stride)
+{
+    return ObjectDefinition::createFragments(id, version, width, height,
+                                             ObjectDefinition::encodeObjectData(pixels, width, height, stride));
+}
+
+vector<shared_ptr<ObjectDefinition>> ObjectDefinition::createFragments(const uint16_t &id, const uint8_t &version,
+                                                                       const uint16_t &width, const uint16_t &height,
+                                                                       vector<uint8_t> encodedData)
+{
+    if (encodedData.size() + 4u > 0xFFFFFFu)
+    {
+        throw std::length_error("ObjectDefinition::createFragments: encoded object is too large.");
+    }
+
+    ObjectDefinition object;
+    object.id = id;
+    object.version = version;
+    object.sequenceFlag = SequenceFlag::Only;
+    object.dataLength = static_cast<uint32_t>(encodedData.size()) + 4u;
+    object.width = width;
+    object.height = height;
+    object.objectData = std::move(encodedData);
+
+    return object.splitFragments();
+}
+
+vector<vector<uint8_t>> ObjectDefinition::decodeObjectData(const vector<uint8_t> &data, const uint16_t &width,
+                                                           const uint16_t &height)
+{
+    auto outVec = vector<vector<uint8_t>>();
+    outVec.resize(height);
+
+    size_t readPos = 0u;
+    for (uint16_t i = 0u; i < height && readPos < data.size(); ++i)
+    {
+        outVec[i] = ObjectDefinition::decodeLine(data, width, readPos);
+    }
+
+    return outVec;
+}
+
+vector<Span> ObjectDefinition::findSpans(const vector<uint8_t> &data, const uint16_t &width, const uint16_t &height,
+                                        const std::array<bool, 256> &ink)
+{
+    vector<Span> spans;
+    ObjectDefinition::forEachRun(data, width, height, [&](const uint16_t &y, const uint16_t &x, const uint16_t &length,
+                                                          const uint8_t &color) {
+        if (!ink[color])
+        {
+            return;
+        }
+        if (!spans.empty() && spans.back().y == y && spans.back().x + spans.back().width == x)
+        {
+            spans.back().width += length;
+            return;
+        }
+        spans.push_back({x, y, length});
+    });
+    return spans;
+}
+
+BoundingBox ObjectDefinition::findBoundingBox(const vector<uint8_t> &data, const uint16_t &width,
+                                              const uint16_t &height, const std::array<bool, 256> &transparent)
+{
+    uint16_t left = width, right = 0u, top = height, bottom = 0u;
+    ObjectDefinition::forEachRun(data, width, height, [&](const uint16_t &y, const uint16_t &x, const uint16_t &length,
+                                                          const uint8_t &color) {
+        if (!transparent[color])
+        {
+            left = std::min(left, x);
+            right = std::max(right, static_cast<uint16_t>(x + length));
+            top = std::min(top, y);
+            bottom = static_cast<uint16_t>(y + 1u);
+        }
+    });
+
+    if (right <= left)
+    {
+        return {0u, 0u, 0u, 0u};
     }
+    return {left, top, static_cast<uint16_t>(right - left), static_cast<uint16_t>(bottom - top)};
+}
 
-    return readPos;
+BoundingBox ObjectDefinition::getBoundingBox(const std::array<bool, 256> &transparent) const
+{
+    return ObjectDefinition::findBoundingBox(this->objectData, this->width, this->height, transparent);
 }
 
 // =======
@@ -106,6 +373,11 @@ const SequenceFlag &ObjectDefinition::getSequenceFlag() const noexcept
     return this->sequenceFlag;
 }
 
+bool ObjectDefinition::isFirstFragment() const noexcept
+{
+    return (static_cast<uint8_t>(this->sequenceFlag) & static_cast<uint8_t>(SequenceFlag::First)) != 0u;
+}
+
 const uint32_t &ObjectDefinition::getDataLength() const noexcept
 {
     return this->dataLength;
@@ -128,90 +400,92 @@ const vector<uint8_t> &ObjectDefinition::getEncodedObjectData() const noexcept
 
 vector<vector<uint8_t>> ObjectDefinition::getDecodedObjectData() const noexcept
 {
-    auto outVec = vector<vector<uint8_t>>();
-    outVec.resize(this->height);
+    return ObjectDefinition::decodeObjectData(this->objectData, this->width, this->height);
+}
+
+uint64_t ObjectDefinition::getContentHash() const noexcept
+{
+    return hashBytes(this->objectData.data(), this->objectData.size(),
+                     static_cast<uint64_t>(this->width) << 16u | this->height);
+}
 
-    uint32_t startPoint = 0u, readPos = 0u;
-    for (uint16_t i = 0u; i < this->height; ++i)
+bool ObjectDefinition::readRun(const vector<uint8_t> &data, const uint16_t &width, size_t &readPos, uint8_t &color,
+                               uint16_t &length) noexcept
+{
+    const size_t size = data.size();
+    if (readPos >= size)
     {
-        uint8_t buff0 = 1u, buff1 = 1u;
-        // Determine line start and end points
-        while (((buff0 << 8u) | buff1) != 0u)
-        {
-            buff0 = this->objectData[readPos];
-            buff1 = this->objectData[readPos + 1];
-            ++readPos;
-        }
-        ++readPos;
-        outVec[i] = this->decodeLine(startPoint, readPos);
-        startPoint = readPos;
+        return false;
     }
 
-    return outVec;
-}
+    const uint8_t buff0 = data[readPos];
+    ++readPos;
+    if (buff0 != 0u)
+    {
+        color = buff0;
+        length = 1u;
+        return true;
+    }
 
-vector<uint8_t> ObjectDefinition::decodeLine(const uint32_t &startPos, const uint32_t &endPos) const
-{
-    std::vector<uint8_t> line;
+    if (readPos >= size)
+    {
+        return false;
+    }
+    const uint8_t buff1 = data[readPos];
+    ++readPos;
 
-    uint32_t readPos = startPos;
-    uint32_t linePos = 0u;
-    uint8_t buff0, buff1;
-    uint8_t color;
+    // 00 00 marks the end of the line.
+    if (buff1 == 0u)
+    {
+        return false;
+    }
+
+    uint8_t flagA = buff1 >> 7u;
+    uint8_t flagB = (buff1 & 0b01000000u) >> 6u;
 
-    while (readPos < endPos && linePos < this->width)
+    length = buff1 & 0b00111111u;
+    if (flagB != 0u)
     {
-        buff0 = this->objectData[readPos];
+        if (readPos >= size)
+        {
+            return false;
+        }
+        length = (length << 8u) | data[readPos];
         ++readPos;
+    }
+    else if (length == 0)
+    {
+        length = width;
+    }
 
-        if (buff0 != 0u)
+    if (flagA == 0u)
+    {
+        color = 0u;
+    }
+    else
+    {
+        if (readPos >= size)
         {
-            line.push_back(buff0);
-            ++linePos;
+            return false;
         }
-        else
-        {
-            buff1 = this->objectData[readPos];
-            ++readPos;
-            uint8_t flagA = buff1 >> 7u;
-            uint8_t flagB = (buff1 & 0b01000000u) >> 6u;
-
-            uint16_t pixCount = 0u;
+        color = data[readPos];
+        ++readPos;
+    }
 
-            if (flagB == 0u)
-            {
-                pixCount = buff1 & 0b00111111u;
-                if (pixCount == 0)
-                {
-                    pixCount = this->width - linePos;
-                }
-            }
-            else
-            {
-                pixCount = ((buff1 & 0b00111111u) << 8u) | this->objectData[readPos];
-                ++readPos;
-            }
+    return true;
+}
 
-            if (flagA == 0u)
-            {
-                color = 0u;
-            }
-            else
-            {
-                color = this->objectData[readPos];
-                ++readPos;
-            }
+vector<uint8_t> ObjectDefinition::decodeLine(const vector<uint8_t> &data, const uint16_t &width, size_t &readPos)
+{
+    std::vector<uint8_t> line;
+    line.reserve(width);
 
-            for (uint16_t i = 0; i < pixCount; i++)
-            {
-                if (linePos >= this->width)
-                {
-                    break;
-                }
-                line.push_back(color);
-                ++linePos;
-            }
-        }
+    uint8_t color;
+    uint16_t length;
+    while (ObjectDefinition::readRun(data, width, readPos, color, length))
+    {
+        const size_t count = std::min<size_t>(length, width - line.size());
+        line.insert(line.end(), count, color);
     }
 
     return line;
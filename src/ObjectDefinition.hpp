@@ -22,6 +22,9 @@
 
 #include "SegmentData.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -32,11 +35,38 @@ namespace Pgs
      */
     enum class SequenceFlag
     {
+        Middle = 0x00, /**< Used when object data is neither first nor last in its sequence */
         Last = 0x40, /**< Used when object data is last in its sequence */
         First = 0x80, /**< Used when object data is first in its sequence */
         Only = 0xC0 /**< Used when there is only one object data array in sequence */
     };
 
+    /**
+     * \brief Rectangle holding the non-transparent pixels of an image, relative to the image's top left corner.
+     */
+    struct BoundingBox
+    {
+        uint16_t x; /**< First column holding a non-transparent pixel. */
+        uint16_t y; /**< First line holding a non-transparent pixel. */
+        uint16_t width; /**< Number of columns, 0 if the image is fully transparent. */
+        uint16_t height; /**< Number of lines, 0 if the image is fully transparent. */
+
+        [[nodiscard]] bool isEmpty() const noexcept
+        {
+            return this->width == 0u || this->height == 0u;
+        }
+    };
+
+    /**
+     * \brief Horizontal run of pixels on a single line of an image.
+     */
+    struct Span
+    {
+        uint16_t x; /**< First column of the run. */
+        uint16_t y; /**< Line of the run. */
+        uint16_t width; /**< Number of pixels in the run. */
+    };
+
     /**
      * \brief Subclass of SegmentData containing information needed for constructing a subtitle
      * image.
@@ -47,46 +77,265 @@ namespace Pgs
         uint16_t id; /**< ID of this object */
         uint8_t version; /**< Version of this object */
         SequenceFlag sequenceFlag; /**< Order of this object in its sequence */
-        uint32_t dataLength; /**< Number of bytes contained in the object data vector. */
+        uint32_t dataLength; /**< Number of RLE bytes across all fragments of the object, plus 4 for the dimensions. */
         uint16_t width; /**< Width of image after decompression */
         uint16_t height; /**< Height of image after decompression */
         std::vector<uint8_t> objectData; /**< RLE-compressed object data. */
 
         /**
-         * \brief Reads 3 bytes of data from the provided data.
-         * \details
-         * The number of bytes used to store an object data segment is held as a 24-bit value in the PGS file.
-         * A 32-bit value is the next closest thing we can use on an average computer, so the value is cast to 32-bits
-         * and 0-padded.
-         *
-         * \param data pointer to raw data array
-         * \param readPos position in data array to read from
-         * \return 32-bit value containing read data.
+         * \brief Decode an individual line from RLE-compressed data.
+         * \param data RLE-compressed data
+         * \param width width of the decompressed line
+         * \param readPos position to start reading from. Set to the position after the end of line code.
+         * \return decompressed line
          */
-        inline static uint32_t read3Bytes(const uint8_t *data, uint16_t &readPos);
+        static std::vector<uint8_t> decodeLine(const std::vector<uint8_t> &data, const uint16_t &width,
+                                               size_t &readPos);
 
         /**
-         * \brief Decode an individual line from the object data.
-         * \param startPos position to start reading from
-         * \param endPos position to stop reading at
-         * \return decompressed line
+         * \brief Reads the next run of a line from RLE-compressed data.
+         * \param data RLE-compressed data
+         * \param width width of the decompressed line
+         * \param readPos position to start reading from. Set to the position after the code.
+         * \param color set to the palette index of the run
+         * \param length set to the number of pixels in the run. May run past the end of the line.
+         * \return false at the end of line code or the end of the data
          */
-        [[nodiscard]] std::vector<uint8_t> decodeLine(const uint32_t &startPos, const uint32_t &endPos) const;
+        static bool readRun(const std::vector<uint8_t> &data, const uint16_t &width, size_t &readPos, uint8_t &color,
+                            uint16_t &length) noexcept;
+
+        /**
+         * \brief Appends the code for a single run of pixels to the RLE-compressed data.
+         * \param data RLE-compressed data to append to
+         * \param color palette index of the run
+         * \param length number of pixels in the run
+         */
+        static void encodeRun(std::vector<uint8_t> &data, const uint8_t &color, uint32_t length);
     public:
         static constexpr uint16_t MIN_BYTE_SIZE = 11u;
+        static constexpr uint16_t MIN_CONTINUATION_BYTE_SIZE = 4u; /**< Header size of fragments after the first. */
+        static constexpr uint16_t MAX_SEGMENT_DATA_SIZE = UINT16_MAX; /**< Largest data size of a single segment. */
+        static constexpr uint16_t MAX_RUN_LENGTH = 0x3FFFu; /**< Longest run a single RLE code can hold. */
 
         /**
          * \brief Creates a new ObjectDefinition instance.
          */
         ObjectDefinition();
 
+        /**
+         * \brief Imports only the header fields (ID, version, sequence flag, data length, and dimensions) without
+         * throwing on malformed data.
+         *
+         * \details
+         * The RLE-compressed object data is not copied, so getEncodedObjectData() will return an empty vector. This is
+         * intended for timeline scans that need object geometry but never decode the image.
+         *
+         * \param data pointer to raw data array
+         * \param size size of raw data array
+         * \param readSize set to the number of header bytes read from the data array on success
+         * \return ParseError::None on success, or the reason the import failed.
+         */
+        ParseError tryImportHeader(const char *data, const uint16_t &size, uint16_t &readSize);
+
+        /**
+         * \brief Imports only the header fields (ID, version, sequence flag, data length, and dimensions).
+         * \param data pointer to raw data array
+         * \param size size of raw data array
+         * \return number of header bytes read from the data array
+         *
+         * \throws ImportException
+         */
+        uint16_t importHeader(const char *data, const uint16_t &size);
+
         /**
          * \brief imports the provided data into the ObjectDefinition instance
          * \param data pointer to raw data array
          * \param size size of raw data array
-         * \return number of bytes read from the data array
+         * \param readSize set to the number of bytes read from the data array on success
+         * \return ParseError::None on success, or the reason the import failed.
+         */
+        ParseError tryImport(const char *data, const uint16_t &size, uint16_t &readSize) override;
+
+        /**
+         * \brief Appends the object data of the following fragment of the same object.
+         *
+         * \details
+         * The sequence flags are combined, so appending a Last fragment to a First fragment gives an instance flagged
+         * as Only, which holds the complete object.
+         *
+         * \param fragment next fragment in the sequence
+         */
+        void appendFragment(const ObjectDefinition &fragment);
+
+        /**
+         * \brief Writes the header and object data of this instance as the data of a single segment.
+         *
+         * \details
+         * The data length and dimensions are only written for First and Only fragments. Use splitFragments() first
+         * if the object data may not fit in one segment.
+         *
+         * \param writer writer to append the data to
+         */
+        void serialize(ByteWriter &writer) const override;
+
+        /**
+         * \brief Splits this instance into fragments that each fit in a single segment.
+         *
+         * \details
+         * This is the inverse of appendFragment(). If the object data already fits, the result holds a copy of this
+         * instance.
+         *
+         * \return fragments in stream order
          */
-        uint16_t import(const char *data, const uint16_t &size) override;
+        [[nodiscard]] std::vector<std::shared_ptr<ObjectDefinition>> splitFragments() const;
+
+        /**
+         * \brief Compresses an 8-bit indexed bitmap into PGS run-length encoded data.
+         *
+         * \details
+         * Each run uses the shortest code that can hold it. Lone pixels and pairs of a non-zero color are stored as
+         * literal bytes, and each line ends with an end of line code.
+         *
+         * \param pixels pointer to the first palette index of the bitmap
+         * \param width number of pixels per line
+         * \param height number of lines
+         * \param stride number of bytes between the starts of two lines
+         * \return RLE-compressed data
+         *
+         * \throws std::invalid_argument if pixels is null while the bitmap isn't empty.
+         */
+        static std::vector<uint8_t> encodeObjectData(const uint8_t *pixels, const uint16_t &width,
+                                                     const uint16_t &height, const uint32_t &stride);
+
+        /**
+         * \brief Decompresses PGS run-length encoded data into lines of palette indices.
+         * \param data RLE-compressed data
+         * \param width width of the decompressed image
+         * \param height height of the decompressed image
+         * \return 2D vector containing height lines of palette indices
+         */
+        static std::vector<std::vector<uint8_t>> decodeObjectData(const std::vector<uint8_t> &data,
+                                                                  const uint16_t &width, const uint16_t &height);
+
+        /**
+         * \brief Encodes an 8-bit indexed bitmap into the ObjectDefinition fragments needed to store it.
+         *
+         * \details
+         * Data that fits in a single segment gives one fragment flagged as Only. Otherwise the object is split into a
+         * First fragment, Middle fragments if needed, and a Last fragment, each filling a segment.
+         *
+         * \param id object ID
+         * \param version object version
+         * \param pixels pointer to the first palette index of the bitmap
+         * \param width number of pixels per line
+         * \param height number of lines
+         * \param stride number of bytes between the starts of two lines
+         * \return fragments in stream order
+         *
+         * \throws std::invalid_argument if pixels is null while the bitmap isn't empty.
+         * \throws std::length_error if the encoded data doesn't fit the 24-bit data length.
+         */
+        static std::vector<std::shared_ptr<ObjectDefinition>> createFragments(const uint16_t &id,
+                                                                              const uint8_t &version,
+                                                                              const uint8_t *pixels,
+                                                                              const uint16_t &width,
+                                                                              const uint16_t &height,
+                                                                              const uint32_t &stride);
+
+        /**
+         * \brief Splits already RLE-compressed data into the ObjectDefinition fragments needed to store it.
+         *
+         * \details
+         * Fragments are flagged the same way as those of the bitmap overload.
+         *
+         * \param id object ID
+         * \param version object version
+         * \param width width of the decompressed image
+         * \param height height of the decompressed image
+         * \param encodedData RLE-compressed data, e.g. from encodeObjectData()
+         * \return fragments in stream order
+         *
+         * \throws std::length_error if the encoded data doesn't fit the 24-bit data length.
+         */
+        static std::vector<std::shared_ptr<ObjectDefinition>> createFragments(const uint16_t &id,
+                                                                              const uint8_t &version,
+                                                                              const uint16_t &width,
+                                                                              const uint16_t &height,
+                                                                              std::vector<uint8_t> encodedData);
+
+        /**
+         * \brief Calls a function for every run of PGS run-length encoded data, without expanding it into pixels.
+         *
+         * \details
+         * Runs are clipped to the image width, and empty runs are skipped.
+         *
+         * \param data RLE-compressed data
+         * \param width width of the decompressed image
+         * \param height height of the decompressed image
+         * \param callback called as callback(y, x, length, color) for every run, in stream order
+         */
+        template<typename Callback>
+        static void forEachRun(const std::vector<uint8_t> &data, const uint16_t &width, const uint16_t &height,
+                               Callback callback)
+        {
+            size_t readPos = 0u;
+            uint8_t color;
+            uint16_t length;
+            for (uint16_t y = 0u; y < height && readPos < data.size(); ++y)
+            {
+                uint16_t x = 0u;
+                while (ObjectDefinition::readRun(data, width, readPos, color, length))
+                {
+                    const auto count = static_cast<uint16_t>(std::min<uint32_t>(length, width - x));
+                    if (count > 0u)
+                    {
+                        callback(y, x, count, color);
+                    }
+                    x += count;
+                }
+            }
+        }
+
+        /**
+         * \brief Collects the runs of inked pixels of PGS run-length encoded data.
+         *
+         * \details
+         * Neighbouring inked runs on the same line are joined even when their colors differ.
+         *
+         * \param data RLE-compressed data
+         * \param width width of the decompressed image
+         * \param height height of the decompressed image
+         * \param ink true for every palette index that counts as ink
+         * \return spans sorted by line, then by column
+         */
+        static std::vector<Span> findSpans(const std::vector<uint8_t> &data, const uint16_t &width,
+                                           const uint16_t &height, const std::array<bool, 256> &ink);
+
+        /**
+         * \brief Finds the tight bounding box of the non-transparent pixels of PGS run-length encoded data.
+         *
+         * \details
+         * Runs are visited without being expanded into pixels, so this costs a fraction of decodeObjectData.
+         *
+         * \param data RLE-compressed data
+         * \param width width of the decompressed image
+         * \param height height of the decompressed image
+         * \param transparent true for every palette index that is fully transparent
+         * \return bounding box, empty if every pixel is transparent
+         */
+        static BoundingBox findBoundingBox(const std::vector<uint8_t> &data, const uint16_t &width,
+                                           const uint16_t &height, const std::array<bool, 256> &transparent);
+
+        /**
+         * \brief Finds the tight bounding box of the non-transparent pixels of this ObjectDefinition instance.
+         *
+         * \details
+         * For objects split over several fragments, use appendFragment() first.
+         *
+         * \param transparent true for every palette index that is fully transparent
+         * \return bounding box, empty if every pixel is transparent
+         */
+        [[nodiscard]] BoundingBox getBoundingBox(const std::array<bool, 256> &transparent) const;
 
         // =======
         // Getters
@@ -110,6 +359,12 @@ namespace Pgs
          */
         [[maybe_unused]] [[nodiscard]] const SequenceFlag &getSequenceFlag() const noexcept;
 
+        /**
+         * \brief Checks whether this instance starts its sequence, meaning it holds the object data length and size.
+         * \return true for First and Only fragments
+         */
+        [[nodiscard]] bool isFirstFragment() const noexcept;
+
         /**
          * \brief Retrieves the size of the encoded data contained in this ObjectDefinition instance
          * \return data length
@@ -136,8 +391,24 @@ namespace Pgs
 
         /**
          * \brief Retrieves the decompressed image data in this ObjectDefinition instance
+         *
+         * \details
+         * Only the data of this instance is decoded. For objects split over several fragments, use appendFragment()
+         * first.
+         *
          * \return decompressed image data
          */
         [[maybe_unused]] [[nodiscard]] std::vector<std::vector<uint8_t>> getDecodedObjectData() const noexcept;
+
+        /**
+         * \brief Computes a hash identifying the image of this ObjectDefinition instance without decoding it.
+         *
+         * \details
+         * The compressed image data is hashed with hashBytes, seeded with the dimensions, so identical images encoded
+         * the same way get the same hash. For objects split over several fragments, use appendFragment() first.
+         *
+         * \return content hash
+         */
+        [[nodiscard]] uint64_t getContentHash() const noexcept;
     };
 }
@@ -19,6 +19,8 @@
 */
 
 #include "PaletteDefinition.hpp"
+#include "ByteReader.hpp"
+#include "ByteWriter.hpp"
 
 using std::shared_ptr;
 using std::vector;
@@ -27,36 +29,57 @@ using std::array;
 
 using namespace Pgs;
 
-shared_ptr<PaletteEntry> PaletteEntry::create(const char *data, const uint16_t &size, uint16_t &readPos)
+shared_ptr<PaletteEntry> PaletteEntry::tryCreate(const char *data, const uint16_t &size, uint16_t &readPos,
+                                                  ParseError &error)
 {
     if(!data)
     {
-        throw ImportException("PaletteEntry: no data provided to create method.");
+        error = ParseError::NoData;
+        return nullptr;
     }
 
     if(size < PaletteEntry::MIN_BYTE_SIZE)
     {
-        throw ImportException("PaletteEntry: Insufficient data provided to successfully complete creation.");
+        error = ParseError::InsufficientData;
+        return nullptr;
     }
 
     auto paletteEntry = std::make_shared<PaletteEntry>();
 
-    const auto byteData = reinterpret_cast<const uint8_t *>(data);
+    ByteReader reader(data + readPos, size);
+    paletteEntry->id = reader.read8();
+    paletteEntry->y = reader.read8();
+    paletteEntry->cr = reader.read8();
+    paletteEntry->cb = reader.read8();
+    paletteEntry->alpha = reader.read8();
+
+    readPos += reader.getPosition();
+
+    error = ParseError::None;
+    return paletteEntry;
+}
 
-    paletteEntry->id = byteData[readPos];
-    ++readPos;
-    paletteEntry->y = byteData[readPos];
-    ++readPos;
-    paletteEntry->cr = byteData[readPos];
-    ++readPos;
-    paletteEntry->cb = byteData[readPos];
-    ++readPos;
-    paletteEntry->alpha = byteData[readPos];
-    ++readPos;
+shared_ptr<PaletteEntry> PaletteEntry::create(const char *data, const uint16_t &size, uint16_t &readPos)
+{
+    ParseError error;
+    auto paletteEntry = PaletteEntry::tryCreate(data, size, readPos, error);
+    if (!paletteEntry)
+    {
+        throw ImportException(getParseErrorMessage(error));
+    }
 
     return paletteEntry;
 }
 
+void PaletteEntry::serialize(ByteWriter &writer) const
+{
+    writer.write8(this->id);
+    writer.write8(this->y);
+    writer.write8(this->cr);
+    writer.write8(this->cb);
+    writer.write8(this->alpha);
+}
+
 // ====================
 // PaletteEntry Getters
 // ====================
@@ -135,37 +158,53 @@ PaletteDefinition::PaletteDefinition() : SegmentData()
     this->entries = map<uint8_t, shared_ptr<PaletteEntry>>();
 }
 
-uint16_t PaletteDefinition::import(const char *data, const uint16_t &size)
+ParseError PaletteDefinition::tryImport(const char *data, const uint16_t &size, uint16_t &readSize)
 {
     if(!data)
     {
-        throw ImportException("PaletteDefinition: no data provided to import method.");
+        return ParseError::NoData;
     }
 
     if(size < PaletteDefinition::MIN_BYTE_SIZE)
     {
-        throw ImportException("PaletteDefinition: Insufficient data provided to successfully complete import.");
+        return ParseError::InsufficientData;
     }
 
-    const auto byteData = reinterpret_cast<const uint8_t *>(data);
-    uint16_t readPos = 0u;
-    this->id = byteData[readPos];
-    ++readPos;
-    this->version = byteData[readPos];
-    ++readPos;
+    ByteReader reader(data, size);
+    this->id = reader.read8();
+    this->version = reader.read8();
+    this->entries.clear();
+
+    uint16_t readPos = reader.getPosition();
 
     uint16_t remainingSize = size - readPos;
 
     this->numEntries = remainingSize / PaletteEntry::MIN_BYTE_SIZE;
 
+    ParseError error = ParseError::None;
     for (uint8_t i = 0; i < this->numEntries; ++i)
     {
-        auto entry = PaletteEntry::create(data, remainingSize, readPos);
+        auto entry = PaletteEntry::tryCreate(data, remainingSize, readPos, error);
+        if (!entry)
+        {
+            return error;
+        }
         this->entries.insert(std::make_pair(entry->getId(), entry));
         remainingSize = size - readPos;
     }
 
-    return readPos;
+    readSize = readPos;
+    return ParseError::None;
+}
+
+void PaletteDefinition::serialize(ByteWriter &writer) const
+{
+    writer.write8(this->id);
+    writer.write8(this->version);
+    for (const auto &entry : this->entries)
+    {
+        entry.second->serialize(writer);
+    }
 }
 
 // =======
@@ -56,6 +56,32 @@ namespace Pgs
          */
         PaletteEntry() = default;
 
+        /**
+         * \brief Creates a new PaletteEntry from the provided data without throwing on malformed data.
+         * \param data pointer to raw data array
+         * \param size number of bytes remaining in the data array
+         * \param readPos position in data array to read from. Updated on success.
+         * \param error set to the reason creation failed, or ParseError::None
+         * \return shared pointer to the new PaletteEntry, or nullptr on failure.
+         */
+        static std::shared_ptr<PaletteEntry> tryCreate(const char *data, const uint16_t &size, uint16_t &readPos,
+                                                       ParseError &error);
+
+        /**
+         * \brief Writes the palette entry in the same format it's imported from.
+         * \param writer writer to append the data to
+         */
+        void serialize(ByteWriter &writer) const;
+
+        /**
+         * \brief Creates a new PaletteEntry from the provided data.
+         * \param data pointer to raw data array
+         * \param size number of bytes remaining in the data array
+         * \param readPos position in data array to read from. Updated on success.
+         * \return shared pointer to the new PaletteEntry
+         *
+         * \throws ImportException
+         */
         static std::shared_ptr<PaletteEntry> create(const char *data, const uint16_t &size, uint16_t &readPos);
 
         // =======
@@ -112,7 +138,9 @@ namespace Pgs
          */
         PaletteDefinition();
 
-        uint16_t import(const char *data, const uint16_t &size) override;
+        ParseError tryImport(const char *data, const uint16_t &size, uint16_t &readSize) override;
+
+        void serialize(ByteWriter &writer) const override;
 
         // =======
         // Getters
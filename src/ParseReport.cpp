@@ -0,0 +1,87 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#include "ParseReport.hpp"
+
+using std::vector;
+
+using namespace Pgs;
+
+// =======================
+// ParseDiagnostic methods
+// =======================
+
+ParseDiagnostic::ParseDiagnostic(const uint64_t &displaySetOffset, const uint64_t &segmentOffset,
+                                 const SegmentType &segmentType, const ParseError &error)
+{
+    this->displaySetOffset = displaySetOffset;
+    this->segmentOffset = segmentOffset;
+    this->segmentType = segmentType;
+    this->error = error;
+}
+
+const uint64_t &ParseDiagnostic::getDisplaySetOffset() const noexcept
+{
+    return this->displaySetOffset;
+}
+
+const uint64_t &ParseDiagnostic::getSegmentOffset() const noexcept
+{
+    return this->segmentOffset;
+}
+
+const SegmentType &ParseDiagnostic::getSegmentType() const noexcept
+{
+    return this->segmentType;
+}
+
+const ParseError &ParseDiagnostic::getError() const noexcept
+{
+    return this->error;
+}
+
+const char *ParseDiagnostic::getMessage() const noexcept
+{
+    return getParseErrorMessage(this->error);
+}
+
+// ===================
+// ParseReport methods
+// ===================
+
+void ParseReport::add(const ParseDiagnostic &diagnostic)
+{
+    this->diagnostics.push_back(diagnostic);
+}
+
+void ParseReport::clear() noexcept
+{
+    this->diagnostics.clear();
+}
+
+bool ParseReport::hasErrors() const noexcept
+{
+    return !this->diagnostics.empty();
+}
+
+const vector<ParseDiagnostic> &ParseReport::getDiagnostics() const noexcept
+{
+    return this->diagnostics;
+}
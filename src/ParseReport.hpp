@@ -0,0 +1,110 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#pragma once
+
+#include "Segment.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace Pgs
+{
+    /**
+     * \brief Describes a single display set that could not be imported.
+     */
+    class ParseDiagnostic
+    {
+    protected:
+        uint64_t displaySetOffset; /**< Byte offset of the start of the affected display set. */
+        uint64_t segmentOffset; /**< Byte offset of the segment that failed to import. */
+        /**
+         * \brief Type byte of the segment that failed to import. May not be a known type.
+         *
+         * \details
+         * For errors not caused by a specific segment, this is the type that was expected: PresentationComposition
+         * when there was no data to start a display set, and EndOfDisplaySet when the display set was never closed.
+         */
+        SegmentType segmentType;
+        ParseError error; /**< Reason the import failed. */
+
+    public:
+        ParseDiagnostic(const uint64_t &displaySetOffset, const uint64_t &segmentOffset, const SegmentType &segmentType,
+                        const ParseError &error);
+
+        // =======
+        // Getters
+        // =======
+
+        [[nodiscard]] const uint64_t &getDisplaySetOffset() const noexcept;
+
+        [[nodiscard]] const uint64_t &getSegmentOffset() const noexcept;
+
+        [[nodiscard]] const SegmentType &getSegmentType() const noexcept;
+
+        [[nodiscard]] const ParseError &getError() const noexcept;
+
+        /**
+         * \brief Gets a short, human-readable description of the error.
+         * \return static string describing the error
+         */
+        [[nodiscard]] const char *getMessage() const noexcept;
+    };
+
+    /**
+     * \brief Collects the diagnostics produced by the non-throwing parse functions.
+     *
+     * \details
+     * Functions such as Subtitle::createAll(const char *, const uint64_t &, ParseReport &) skip damaged display sets
+     * and record why in the report instead of throwing or printing. A report is meant to be owned by a single thread,
+     * so parsing several streams in parallel needs one report per stream.
+     */
+    class ParseReport
+    {
+    protected:
+        std::vector<ParseDiagnostic> diagnostics; /**< Diagnostics in the order they were recorded. */
+
+    public:
+        ParseReport() = default;
+
+        /**
+         * \brief Records a new diagnostic.
+         * \param diagnostic diagnostic to record
+         */
+        void add(const ParseDiagnostic &diagnostic);
+
+        /**
+         * \brief Removes all recorded diagnostics.
+         */
+        void clear() noexcept;
+
+        /**
+         * \brief Checks whether any diagnostic has been recorded.
+         * \return true if at least one display set failed to import
+         */
+        [[nodiscard]] bool hasErrors() const noexcept;
+
+        // =======
+        // Getters
+        // =======
+
+        [[nodiscard]] const std::vector<ParseDiagnostic> &getDiagnostics() const noexcept;
+    };
+}
@@ -0,0 +1,244 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#include "PerceptualHash.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+using std::array;
+using std::vector;
+
+using namespace Pgs;
+
+constexpr uint8_t PerceptualHash::GRID_WIDTH;
+constexpr uint8_t PerceptualHash::GRID_HEIGHT;
+constexpr uint32_t PerceptualHashIndex::NO_NODE;
+
+array<uint8_t, 256> PerceptualHash::getIntensities(const PaletteDefinition *palette)
+{
+    array<uint8_t, 256> intensities{};
+    if (palette == nullptr)
+    {
+        return intensities;
+    }
+
+    for (const auto &entry : palette->getEntries())
+    {
+        const uint32_t luma = 64u + entry.second->getY() * 3u / 4u;
+        intensities[entry.first] = static_cast<uint8_t>(luma * entry.second->getAlpha() / 255u);
+    }
+    return intensities;
+}
+
+uint64_t PerceptualHash::compute(const vector<vector<uint8_t>> &indices, const array<uint8_t, 256> &intensities)
+{
+    const size_t height = indices.size();
+    const size_t width = height == 0u ? 0u : indices[0].size();
+    if (width == 0u)
+    {
+        return 0u;
+    }
+
+    // Area average of every grid cell, with each pixel assigned to exactly one cell.
+    array<uint32_t, GRID_WIDTH * GRID_HEIGHT> sums{};
+    array<uint32_t, GRID_WIDTH * GRID_HEIGHT> counts{};
+    vector<uint8_t> columnCells(width);
+    array<uint32_t, GRID_WIDTH> columnCounts{};
+    for (size_t x = 0; x < width; ++x)
+    {
+        columnCells[x] = static_cast<uint8_t>(x * GRID_WIDTH / width);
+        ++columnCounts[columnCells[x]];
+    }
+
+    for (size_t y = 0; y < height; ++y)
+    {
+        const auto &line = indices[y];
+        const size_t rowOffset = y * GRID_HEIGHT / height * GRID_WIDTH;
+        const size_t lineWidth = std::min(width, line.size());
+        for (size_t x = 0; x < lineWidth; ++x)
+        {
+            sums[rowOffset + columnCells[x]] += intensities[line[x]];
+        }
+        for (size_t column = 0; column < GRID_WIDTH; ++column)
+        {
+            // Lines shorter than the first one count their missing pixels as transparent.
+            counts[rowOffset + column] += columnCounts[column];
+        }
+    }
+
+    uint64_t hash = 0u;
+    for (size_t row = 0; row < GRID_HEIGHT; ++row)
+    {
+        for (size_t column = 0; column + 1u < GRID_WIDTH; ++column)
+        {
+            const size_t cell = row * GRID_WIDTH + column;
+            bool brighter;
+            if (counts[cell] == 0u || counts[cell + 1u] == 0u)
+            {
+                // Empty cells average to 0, so only a non-empty right cell with any brightness can be brighter.
+                brighter = counts[cell + 1u] != 0u && sums[cell + 1u] != 0u;
+            }
+            else
+            {
+                // Compare sums[a] / counts[a] < sums[b] / counts[b] without dividing.
+                const uint64_t left = static_cast<uint64_t>(sums[cell]) * counts[cell + 1u];
+                const uint64_t right = static_cast<uint64_t>(sums[cell + 1u]) * counts[cell];
+                brighter = left < right;
+            }
+            hash = (hash << 1u) | (brighter ? 1u : 0u);
+        }
+    }
+    return hash;
+}
+
+uint64_t PerceptualHash::compute(const Subtitle &subtitle)
+{
+    if (!subtitle.containsImage())
+    {
+        return 0u;
+    }
+
+    const auto palette = subtitle.getPds();
+    return PerceptualHash::compute(subtitle.decodeImage(), PerceptualHash::getIntensities(palette.get()));
+}
+
+unsigned PerceptualHash::distance(const uint64_t &lhs, const uint64_t &rhs) noexcept
+{
+    const uint64_t difference = lhs ^ rhs;
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_popcountll(difference));
+#else
+    uint64_t bits = difference - ((difference >> 1u) & 0x5555555555555555u);
+    bits = (bits & 0x3333333333333333u) + ((bits >> 2u) & 0x3333333333333333u);
+    bits = (bits + (bits >> 4u)) & 0x0F0F0F0F0F0F0F0Fu;
+    return static_cast<unsigned>((bits * 0x0101010101010101u) >> 56u);
+#endif
+}
+
+void PerceptualHashIndex::insert(const uint64_t &hash, const uint32_t &value)
+{
+    if (this->nodes.size() >= NO_NODE)
+    {
+        throw std::length_error("PerceptualHashIndex::insert: too many hashes.");
+    }
+
+    const auto newNode = static_cast<uint32_t>(this->nodes.size());
+    this->nodes.push_back({hash, value, NO_NODE, NO_NODE, 0u});
+    if (newNode == 0u)
+    {
+        return;
+    }
+
+    uint32_t current = 0u;
+    while (true)
+    {
+        const auto distance = static_cast<uint8_t>(PerceptualHash::distance(this->nodes[current].hash, hash));
+        uint32_t child = this->nodes[current].firstChild;
+        while (child != NO_NODE && this->nodes[child].distance != distance)
+        {
+            child = this->nodes[child].nextSibling;
+        }
+
+        if (child == NO_NODE)
+        {
+            this->nodes[newNode].distance = distance;
+            this->nodes[newNode].nextSibling = this->nodes[current].firstChild;
+            this->nodes[current].firstChild = newNode;
+            return;
+        }
+        current = child;
+    }
+}
+
+void PerceptualHashIndex::find(const uint64_t &hash, const unsigned &maxDistance, vector<uint32_t> &results) const
+{
+    if (this->nodes.empty())
+    {
+        return;
+    }
+
+    vector<uint32_t> pending = {0u};
+    while (!pending.empty())
+    {
+        const auto &node = this->nodes[pending.back()];
+        pending.pop_back();
+
+        const unsigned distance = PerceptualHash::distance(node.hash, hash);
+        if (distance <= maxDistance)
+        {
+            results.push_back(node.value);
+        }
+
+        const unsigned minChildDistance = distance > maxDistance ? distance - maxDistance : 0u;
+        const unsigned maxChildDistance = distance + maxDistance;
+        for (uint32_t child = node.firstChild; child != NO_NODE; child = this->nodes[child].nextSibling)
+        {
+            if (this->nodes[child].distance >= minChildDistance && this->nodes[child].distance <= maxChildDistance)
+            {
+                pending.push_back(child);
+            }
+        }
+    }
+}
+
+vector<uint32_t> PerceptualHashIndex::find(const uint64_t &hash, const unsigned &maxDistance) const
+{
+    vector<uint32_t> results;
+    this->find(hash, maxDistance, results);
+    return results;
+}
+
+vector<uint32_t> PerceptualHashIndex::cluster(const vector<uint64_t> &hashes, const unsigned &maxDistance)
+{
+    if (hashes.size() >= NO_NODE)
+    {
+        throw std::length_error("PerceptualHashIndex::cluster: too many hashes.");
+    }
+
+    // Only the first hash of every cluster is indexed.
+    PerceptualHashIndex leaders;
+    vector<uint32_t> clusters(hashes.size());
+    vector<uint32_t> matches;
+    for (uint32_t i = 0; i < hashes.size(); ++i)
+    {
+        matches.clear();
+        leaders.find(hashes[i], maxDistance, matches);
+        if (matches.empty())
+        {
+            leaders.insert(hashes[i], i);
+            clusters[i] = i;
+        }
+        else
+        {
+            clusters[i] = *std::min_element(matches.begin(), matches.end());
+        }
+    }
+    return clusters;
+}
+
+// =======
+// Getters
+// =======
+
+size_t PerceptualHashIndex::getSize() const noexcept
+{
+    return this->nodes.size();
+}
@@ -0,0 +1,150 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#pragma once
+
+#include "PaletteDefinition.hpp"
+#include "Subtitle.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace Pgs
+{
+    /**
+     * \brief Computes 64-bit perceptual hashes of subtitle images, for finding near-identical images.
+     *
+     * \details
+     * The hash is a difference hash (dHash). The image is reduced to a 9x8 grid of average intensities, and each bit
+     * tells whether a cell is brighter than its right neighbour. Re-encoded objects and small palette changes keep
+     * most bits, so near-identical images are within a small Hamming distance of each other, while exact hashes like
+     * Subtitle::getContentHash would differ completely.
+     * <br/><br/>Intensities are taken straight from the palette indices through a 256 entry table combining alpha
+     * and luma, so no color image is built. Transparent pixels are 0, and opaque pixels range from 64 (black) to
+     * 255 (white), so outlines stay distinct from the background.
+     */
+    class PerceptualHash
+    {
+    public:
+        static constexpr uint8_t GRID_WIDTH = 9u; /**< Number of grid columns, one more than the bits per row. */
+        static constexpr uint8_t GRID_HEIGHT = 8u; /**< Number of grid rows. */
+
+        /**
+         * \brief Builds the intensity of every palette index.
+         * \param palette palette of the image, or nullptr
+         * \return intensity per palette index. Indices missing from the palette have an intensity of 0.
+         */
+        [[nodiscard]] static std::array<uint8_t, 256> getIntensities(const PaletteDefinition *palette);
+
+        /**
+         * \brief Computes the perceptual hash of a decoded image.
+         * \param indices lines of palette indices, e.g. from Subtitle::decodeImage
+         * \param intensities intensity per palette index, from getIntensities
+         * \return perceptual hash, or 0 for an empty image
+         */
+        [[nodiscard]] static uint64_t compute(const std::vector<std::vector<uint8_t>> &indices,
+                                              const std::array<uint8_t, 256> &intensities);
+
+        /**
+         * \brief Computes the perceptual hash of the image of a Subtitle.
+         * \param subtitle subtitle to hash
+         * \return perceptual hash, or 0 if the Subtitle doesn't contain an image
+         */
+        [[nodiscard]] static uint64_t compute(const Subtitle &subtitle);
+
+        /**
+         * \brief Counts the bits two hashes differ in.
+         * \return Hamming distance between the hashes, from 0 to 64
+         */
+        [[nodiscard]] static unsigned distance(const uint64_t &lhs, const uint64_t &rhs) noexcept;
+    };
+
+    /**
+     * \brief Index of perceptual hashes answering "which hashes are within distance d" queries.
+     *
+     * \details
+     * The hashes are stored in a BK-tree. Every child of a node is stored under its distance to the node, so by the
+     * triangle inequality a query only descends into the children whose distance is within the query distance of the
+     * query's own distance to the node. Small query distances visit a small part of the tree.
+     */
+    class PerceptualHashIndex
+    {
+    protected:
+        /**
+         * \brief Node of the BK-tree. Children are kept in a singly linked list.
+         */
+        struct Node
+        {
+            uint64_t hash;
+            uint32_t value;
+            uint32_t firstChild;
+            uint32_t nextSibling;
+            uint8_t distance; /**< Distance to the parent node. */
+        };
+
+        static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+        std::vector<Node> nodes; /**< BK-tree nodes. The first node is the root. */
+    public:
+        /**
+         * \brief Inserts a hash.
+         * \param hash perceptual hash
+         * \param value value returned by queries matching the hash, e.g. the index of the image
+         */
+        void insert(const uint64_t &hash, const uint32_t &value);
+
+        /**
+         * \brief Finds all hashes within a distance of the provided hash.
+         * \param hash perceptual hash to look for
+         * \param maxDistance largest Hamming distance to report
+         * \param results vector the values of the matching hashes are appended to, in no particular order
+         */
+        void find(const uint64_t &hash, const unsigned &maxDistance, std::vector<uint32_t> &results) const;
+
+        /**
+         * \brief Finds all hashes within a distance of the provided hash.
+         * \param hash perceptual hash to look for
+         * \param maxDistance largest Hamming distance to report
+         * \return values of the matching hashes in no particular order
+         */
+        [[nodiscard]] std::vector<uint32_t> find(const uint64_t &hash, const unsigned &maxDistance) const;
+
+        /**
+         * \brief Groups near-identical hashes.
+         *
+         * \details
+         * Hashes are visited in order. A hash joins the earliest cluster whose first hash is within maxDistance,
+         * or starts a new cluster. To cluster several tracks together, concatenate their hashes.
+         *
+         * \param hashes perceptual hashes
+         * \param maxDistance largest Hamming distance to the first hash of a cluster
+         * \return index of the first hash of the cluster of every hash
+         */
+        [[nodiscard]] static std::vector<uint32_t> cluster(const std::vector<uint64_t> &hashes,
+                                                           const unsigned &maxDistance);
+
+        // =======
+        // Getters
+        // =======
+
+        [[nodiscard]] size_t getSize() const noexcept;
+    };
+}
@@ -19,21 +19,292 @@
 */
 
 #include "PgsUtil.hpp"
+#include "ByteReader.hpp"
 
-#include <endian.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 uint32_t Pgs::read4Bytes(const uint8_t *data, uint16_t &readPos)
 {
-    auto result = static_cast<uint32_t>((data[readPos] << 24u) | (data[readPos + 1] << 16u) |
-                                        (data[readPos + 2] << 8u) |
-                                        data[readPos + 3]);
+    const uint32_t result = loadBigEndian32(data + readPos);
     readPos += 4;
-    return le32toh(result);
+    return result;
 }
 
 uint16_t Pgs::read2Bytes(const uint8_t *data, uint16_t &readPos)
 {
-    auto result = static_cast<uint16_t>((data[readPos] << 8u) | data[readPos+1]);
+    const uint16_t result = loadBigEndian16(data + readPos);
     readPos += 2;
-    return le16toh(result);
+    return result;
+}
+
+const uint8_t *Pgs::findMagicNumber(const uint8_t *data, size_t size) noexcept
+{
+    if (!data || size < 2)
+    {
+        return nullptr;
+    }
+
+    size_t pos = 0u;
+    /*
+     * Compare a block against 'P' and the same block shifted by one byte against 'G'. Any bit left set after ANDing
+     * the two masks marks a "PG" pair.
+     */
+#if defined(__AVX2__)
+    const __m256i firstByte = _mm256_set1_epi8('P');
+    const __m256i secondByte = _mm256_set1_epi8('G');
+    for (; pos + 33 <= size; pos += 32)
+    {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+        const __m256i nextBlock = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos + 1));
+        const __m256i matches = _mm256_and_si256(_mm256_cmpeq_epi8(block, firstByte),
+                                                 _mm256_cmpeq_epi8(nextBlock, secondByte));
+        const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(matches));
+        if (mask != 0u)
+        {
+            return data + pos + __builtin_ctz(mask);
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i firstByte = _mm_set1_epi8('P');
+    const __m128i secondByte = _mm_set1_epi8('G');
+    for (; pos + 17 <= size; pos += 16)
+    {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+        const __m128i nextBlock = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos + 1));
+        const __m128i matches = _mm_and_si128(_mm_cmpeq_epi8(block, firstByte), _mm_cmpeq_epi8(nextBlock, secondByte));
+        const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(matches));
+        if (mask != 0u)
+        {
+            return data + pos + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    // Handle the tail (or everything, without SIMD support) with memchr.
+    while (pos + 1 < size)
+    {
+        const auto found = static_cast<const uint8_t *>(memchr(data + pos, 'P', size - pos - 1));
+        if (!found)
+        {
+            return nullptr;
+        }
+        if (found[1] == 'G')
+        {
+            return found;
+        }
+        pos = (found - data) + 1;
+    }
+
+    return nullptr;
+}
+
+size_t Pgs::findRunLength(const uint8_t *data, size_t size) noexcept
+{
+    if (!data || size == 0)
+    {
+        return 0u;
+    }
+
+    const uint8_t value = data[0];
+    size_t pos = 1u;
+    /*
+     * Compare a whole block against the run value. The first clear bit of the resulting mask is the first byte that
+     * doesn't belong to the run.
+     */
+#if defined(__AVX2__)
+    const __m256i runValue = _mm256_set1_epi8(static_cast<char>(value));
+    for (; pos + 32 <= size; pos += 32)
+    {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+        const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, runValue)));
+        if (mask != 0xFFFFFFFFu)
+        {
+            return pos + __builtin_ctz(~mask);
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i runValue = _mm_set1_epi8(static_cast<char>(value));
+    for (; pos + 16 <= size; pos += 16)
+    {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+        const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, runValue)));
+        if (mask != 0xFFFFu)
+        {
+            return pos + __builtin_ctz(~mask);
+        }
+    }
+#endif
+
+    while (pos < size && data[pos] == value)
+    {
+        ++pos;
+    }
+
+    return pos;
+}
+
+namespace
+{
+    constexpr uint64_t XXH_PRIME_1 = 0x9E3779B185EBCA87u;
+    constexpr uint64_t XXH_PRIME_2 = 0xC2B2AE3D27D4EB4Fu;
+    constexpr uint64_t XXH_PRIME_3 = 0x165667B19E3779F9u;
+    constexpr uint64_t XXH_PRIME_4 = 0x85EBCA77C2B2AE63u;
+    constexpr uint64_t XXH_PRIME_5 = 0x27D4EB2F165667C5u;
+
+    inline uint64_t rotateLeft(const uint64_t &value, const unsigned &bits) noexcept
+    {
+        return (value << bits) | (value >> (64u - bits));
+    }
+
+    // Compilers turn these into single unaligned loads on little endian targets.
+    inline uint64_t loadLittleEndian64(const uint8_t *data) noexcept
+    {
+        uint64_t value = 0u;
+        for (unsigned i = 0; i < 8u; ++i)
+        {
+            value |= static_cast<uint64_t>(data[i]) << (8u * i);
+        }
+        return value;
+    }
+
+    inline uint32_t loadLittleEndian32(const uint8_t *data) noexcept
+    {
+        return static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8u |
+               static_cast<uint32_t>(data[2]) << 16u | static_cast<uint32_t>(data[3]) << 24u;
+    }
+
+    inline uint64_t xxhRound(uint64_t accumulator, const uint64_t &input) noexcept
+    {
+        accumulator += input * XXH_PRIME_2;
+        return rotateLeft(accumulator, 31u) * XXH_PRIME_1;
+    }
+
+    inline uint64_t xxhMergeRound(uint64_t accumulator, const uint64_t &lane) noexcept
+    {
+        accumulator ^= xxhRound(0u, lane);
+        return accumulator * XXH_PRIME_1 + XXH_PRIME_4;
+    }
+}
+
+uint64_t Pgs::hashBytes(const uint8_t *data, size_t size, uint64_t seed) noexcept
+{
+    const uint8_t *end = data + size;
+    uint64_t hash;
+
+    if (size >= 32u)
+    {
+        uint64_t lane1 = seed + XXH_PRIME_1 + XXH_PRIME_2;
+        uint64_t lane2 = seed + XXH_PRIME_2;
+        uint64_t lane3 = seed;
+        uint64_t lane4 = seed - XXH_PRIME_1;
+
+        const uint8_t *const lastStripe = end - 32u;
+        do
+        {
+            lane1 = xxhRound(lane1, loadLittleEndian64(data));
+            lane2 = xxhRound(lane2, loadLittleEndian64(data + 8u));
+            lane3 = xxhRound(lane3, loadLittleEndian64(data + 16u));
+            lane4 = xxhRound(lane4, loadLittleEndian64(data + 24u));
+            data += 32u;
+        } while (data <= lastStripe);
+
+        hash = rotateLeft(lane1, 1u) + rotateLeft(lane2, 7u) + rotateLeft(lane3, 12u) + rotateLeft(lane4, 18u);
+        hash = xxhMergeRound(hash, lane1);
+        hash = xxhMergeRound(hash, lane2);
+        hash = xxhMergeRound(hash, lane3);
+        hash = xxhMergeRound(hash, lane4);
+    }
+    else
+    {
+        hash = seed + XXH_PRIME_5;
+    }
+
+    hash += static_cast<uint64_t>(size);
+
+    for (; data + 8u <= end; data += 8u)
+    {
+        hash ^= xxhRound(0u, loadLittleEndian64(data));
+        hash = rotateLeft(hash, 27u) * XXH_PRIME_1 + XXH_PRIME_4;
+    }
+    if (data + 4u <= end)
+    {
+        hash ^= static_cast<uint64_t>(loadLittleEndian32(data)) * XXH_PRIME_1;
+        hash = rotateLeft(hash, 23u) * XXH_PRIME_2 + XXH_PRIME_3;
+        data += 4u;
+    }
+    for (; data < end; ++data)
+    {
+        hash ^= *data * XXH_PRIME_5;
+        hash = rotateLeft(hash, 11u) * XXH_PRIME_1;
+    }
+
+    hash ^= hash >> 33u;
+    hash *= XXH_PRIME_2;
+    hash ^= hash >> 29u;
+    hash *= XXH_PRIME_3;
+    hash ^= hash >> 32u;
+
+    return hash;
+}
+
+void Pgs::parallelFor(size_t begin, size_t end, unsigned numThreads, const std::function<void(size_t)> &task)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+
+    if (numThreads == 0u)
+    {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    numThreads = static_cast<unsigned>(std::min<size_t>(numThreads, end - begin));
+
+    std::atomic<size_t> nextIndex(begin);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto runTasks = [&] {
+        try
+        {
+            for (size_t i = nextIndex++; i < end; i = nextIndex++)
+            {
+                task(i);
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+            nextIndex = end;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 1u; i < numThreads; ++i)
+    {
+        threads.emplace_back(runTasks);
+    }
+    runTasks();
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
 }
@@ -20,10 +20,66 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 
 namespace Pgs
 {
     uint32_t read4Bytes(const uint8_t *data, uint16_t &readPos);
     uint16_t read2Bytes(const uint8_t *data, uint16_t &readPos);
+
+    /**
+     * \brief Finds the first occurrence of the "PG" segment magic number in the provided data.
+     *
+     * \details
+     * The search compares 16 (SSE2) or 32 (AVX2) candidate positions per step when the library is built for an
+     * architecture supporting them and falls back to memchr otherwise.
+     *
+     * \param data pointer to raw data array
+     * \param size number of bytes in the data array
+     * \return pointer to the 'P' of the first match, or nullptr if there is none.
+     */
+    const uint8_t *findMagicNumber(const uint8_t *data, size_t size) noexcept;
+
+    /**
+     * \brief Counts how many bytes at the start of the provided data are equal to the first byte.
+     *
+     * \details
+     * Like findMagicNumber, this compares 16 (SSE2) or 32 (AVX2) bytes per step when available.
+     *
+     * \param data pointer to raw data array
+     * \param size number of bytes in the data array
+     * \return length of the leading run, or 0 if there is no data.
+     */
+    size_t findRunLength(const uint8_t *data, size_t size) noexcept;
+
+    /**
+     * \brief Computes the 64-bit xxHash (XXH64) of the provided data.
+     *
+     * \details
+     * Data is consumed 32 bytes per iteration in four independent lanes, so hashing runs at several bytes per cycle.
+     * The result matches the reference XXH64 implementation for the same seed.
+     *
+     * \param data pointer to raw data array
+     * \param size number of bytes in the data array
+     * \param seed seed of the hash
+     * \return hash of the data
+     */
+    uint64_t hashBytes(const uint8_t *data, size_t size, uint64_t seed = 0u) noexcept;
+
+    /**
+     * \brief Runs a task once for every index in [begin, end), spread over several threads.
+     *
+     * \details
+     * Threads take the next index as soon as they're done with one, so tasks of uneven cost are balanced. The calling
+     * thread takes part in the work. If a task throws, no further indices are started and the first exception is
+     * rethrown once all threads are done.
+     *
+     * \param begin first index
+     * \param end index past the last one
+     * \param numThreads number of threads to use, or 0 to use one per hardware thread
+     * \param task task to run for each index
+     */
+    void parallelFor(size_t begin, size_t end, unsigned numThreads, const std::function<void(size_t)> &task);
 }
@@ -18,7 +18,8 @@
  *  USA
 */
 
-#include "PgsUtil.hpp"
+#include "ByteReader.hpp"
+#include "ByteWriter.hpp"
 
 #include "PresentationComposition.hpp"
 
@@ -37,6 +38,7 @@ CompositionObject::CompositionObject()
     this->objectID = 0;
     this->windowID = 0;
     this->croppedFlag = false;
+    this->forcedFlag = false;
     this->hPos = 0;
     this->vPos = 0u;
     this->cropHPos = 0u;
@@ -45,30 +47,43 @@ CompositionObject::CompositionObject()
     this->cropHeight = 0;
 }
 
-shared_ptr<CompositionObject> CompositionObject::create(const char *data, const uint16_t &size, uint16_t &readPos)
+shared_ptr<CompositionObject> CompositionObject::tryCreate(const char *data, const uint16_t &size, uint16_t &readPos,
+                                                           ParseError &error)
 {
+    if(!data)
+    {
+        error = ParseError::NoData;
+        return nullptr;
+    }
+
     if(size < CompositionObject::MIN_DATA_SIZE)
     {
-        throw ImportException("CompositionObject: Not enough data to create basic structure.");
+        error = ParseError::InsufficientData;
+        return nullptr;
     }
 
     auto composition = std::make_shared<CompositionObject>();
 
-    const auto *byteData = reinterpret_cast<const uint8_t *>(data);
-    composition->objectID = read2Bytes(byteData, readPos);
-    composition->windowID = byteData[readPos];
-    ++readPos;
-    composition->croppedFlag = (byteData[readPos] == 0x40);
-    ++readPos;
-    composition->hPos = read2Bytes(byteData, readPos);
-    composition->vPos = read2Bytes(byteData, readPos);
+    ByteReader reader(data + readPos, size);
+    composition->objectID = reader.read16();
+    composition->windowID = reader.read8();
+    const uint8_t flags = reader.read8();
+    composition->croppedFlag = (flags & CompositionObject::CROPPED_FLAG) != 0u;
+    composition->forcedFlag = (flags & CompositionObject::FORCED_FLAG) != 0u;
+    composition->hPos = reader.read16();
+    composition->vPos = reader.read16();
 
     if (composition->croppedFlag)
     {
-        composition->cropHPos = read2Bytes(byteData, readPos);
-        composition->cropVPos = read2Bytes(byteData, readPos);
-        composition->cropWidth = read2Bytes(byteData, readPos);
-        composition->cropHeight = read2Bytes(byteData, readPos);
+        if (!reader.canRead(8u))
+        {
+            error = ParseError::InsufficientData;
+            return nullptr;
+        }
+        composition->cropHPos = reader.read16();
+        composition->cropVPos = reader.read16();
+        composition->cropWidth = reader.read16();
+        composition->cropHeight = reader.read16();
     }
     else
     {
@@ -78,9 +93,49 @@ shared_ptr<CompositionObject> CompositionObject::create(const char *data, const
         composition->cropHeight = 0u;
     }
 
+    readPos += reader.getPosition();
+    error = ParseError::None;
+    return composition;
+}
+
+shared_ptr<CompositionObject> CompositionObject::create(const char *data, const uint16_t &size, uint16_t &readPos)
+{
+    ParseError error;
+    auto composition = CompositionObject::tryCreate(data, size, readPos, error);
+    if (!composition)
+    {
+        throw ImportException(getParseErrorMessage(error));
+    }
+
     return composition;
 }
 
+void CompositionObject::serialize(ByteWriter &writer) const
+{
+    writer.write16(this->objectID);
+    writer.write8(this->windowID);
+    uint8_t flags = 0x00u;
+    if (this->croppedFlag)
+    {
+        flags |= CompositionObject::CROPPED_FLAG;
+    }
+    if (this->forcedFlag)
+    {
+        flags |= CompositionObject::FORCED_FLAG;
+    }
+    writer.write8(flags);
+    writer.write16(this->hPos);
+    writer.write16(this->vPos);
+
+    if (this->croppedFlag)
+    {
+        writer.write16(this->cropHPos);
+        writer.write16(this->cropVPos);
+        writer.write16(this->cropWidth);
+        writer.write16(this->cropHeight);
+    }
+}
+
 // =========================
 // CompositionObject Getters
 // =========================
@@ -100,6 +155,11 @@ const bool & CompositionObject::getCroppedFlag() const
     return this->croppedFlag;
 }
 
+const bool & CompositionObject::getForcedFlag() const
+{
+    return this->forcedFlag;
+}
+
 const uint16_t & CompositionObject::getHPos() const
 {
     return this->hPos;
@@ -148,46 +208,69 @@ PresentationComposition::PresentationComposition() : SegmentData()
     this->compositionObjects = vector<shared_ptr<CompositionObject>>();
 }
 
-uint16_t PresentationComposition::import(const char *data, const uint16_t &size)
+ParseError PresentationComposition::tryImport(const char *data, const uint16_t &size, uint16_t &readSize)
 {
-    if (size < PresentationComposition::MIN_DATA_SIZE)
+    if (!data)
     {
-        throw ImportException("PresentationComposition: Not enough data to import basic structure.");
+        return ParseError::NoData;
     }
 
-    const auto *byteData = reinterpret_cast<const uint8_t *>(data);
+    if (size < PresentationComposition::MIN_DATA_SIZE)
+    {
+        return ParseError::InsufficientData;
+    }
 
     this->compositionObjects.clear();
 
-    uint16_t readPos = 0u;
-    this->width = read2Bytes(byteData, readPos);
-    this->height = read2Bytes(byteData, readPos);
-    this->frameRate = byteData[readPos];
-    ++readPos;
-    this->compositionNumber = read2Bytes(byteData, readPos);
-    this->compositionState = CompositionState(byteData[readPos]);
-    ++readPos;
-    this->paletteUpdateFlag = (byteData[readPos] == 0x80);
-    ++readPos;
-    this->paletteID = byteData[readPos];
-    ++readPos;
-    this->compositionObjectCount = byteData[readPos];
-    ++readPos;
-
+    ByteReader reader(data, size);
+    this->width = reader.read16();
+    this->height = reader.read16();
+    this->frameRate = reader.read8();
+    this->compositionNumber = reader.read16();
+    this->compositionState = CompositionState(reader.read8());
+    this->paletteUpdateFlag = (reader.read8() == 0x80);
+    this->paletteID = reader.read8();
+    this->compositionObjectCount = reader.read8();
+
+    uint16_t readPos = reader.getPosition();
     uint16_t remainingSize = size - readPos;
     if(remainingSize < CompositionObject::MIN_DATA_SIZE * this->compositionObjectCount)
     {
-        throw ImportException("PresentationComposition: Not enough data to import all CompositionObjects.");
+        return ParseError::InsufficientData;
     }
 
+    ParseError error = ParseError::None;
     this->compositionObjects.reserve(this->compositionObjectCount);
     for (uint8_t i = 0u; i < this->compositionObjectCount; ++i)
     {
-        this->compositionObjects.push_back(CompositionObject::create(data, remainingSize, readPos));
+        auto compositionObject = CompositionObject::tryCreate(data, remainingSize, readPos, error);
+        if (!compositionObject)
+        {
+            return error;
+        }
+        this->compositionObjects.push_back(compositionObject);
         remainingSize = size - readPos;
     }
 
-    return readPos;
+    readSize = readPos;
+    return ParseError::None;
+}
+
+void PresentationComposition::serialize(ByteWriter &writer) const
+{
+    writer.write16(this->width);
+    writer.write16(this->height);
+    writer.write8(this->frameRate);
+    writer.write16(this->compositionNumber);
+    writer.write8(static_cast<uint8_t>(this->compositionState));
+    writer.write8(this->paletteUpdateFlag ? 0x80u : 0x00u);
+    writer.write8(this->paletteID);
+    writer.write8(static_cast<uint8_t>(this->compositionObjects.size()));
+
+    for (const auto &compositionObject : this->compositionObjects)
+    {
+        compositionObject->serialize(writer);
+    }
 }
 
 // ===============================
@@ -43,7 +43,8 @@ namespace Pgs
     protected:
         uint16_t objectID; /**< ID of the associated Object Definition Segment. */
         uint8_t windowID; /**< ID of the associated Window Definition Segment. Up to 2 images can use 1 window. */
-        bool croppedFlag; /**< Set to true to force display of the cropped image object; false, otherwise. */
+        bool croppedFlag; /**< True if only the cropped area of the image object is displayed; false, otherwise. */
+        bool forcedFlag; /**< True if the object is displayed even when subtitles are turned off; false, otherwise. */
         uint16_t hPos; /**< Horizontal (x) offset from the top-left pixel of the video frame. */
         uint16_t vPos; /**< Vertical (y) offset from the top-left pixel of the video frame. */
         uint16_t cropHPos; /**< Horizontal (x) crop offset from the top-left pixel of the video frame. */
@@ -57,6 +58,16 @@ namespace Pgs
          */
         static constexpr uint16_t MIN_DATA_SIZE = 8u;
 
+        /**
+         * \brief Bit of the object flags set when the object is cropped.
+         */
+        static constexpr uint8_t CROPPED_FLAG = 0x80u;
+
+        /**
+         * \brief Bit of the object flags set when the object is forced on.
+         */
+        static constexpr uint8_t FORCED_FLAG = 0x40u;
+
         /**
          *  \brief Constructs a new CompositionObject instance.
          *
@@ -65,16 +76,34 @@ namespace Pgs
          */
         CompositionObject();
 
+        /**
+         *  \brief Imports the provided data and creates a shared pointer to a new CompositionObject instance without
+         *  throwing on malformed data.
+         *  \param data pointer to raw data array
+         *  \param size number of bytes remaining in the raw data array
+         *  \param readPos point in array to read from. Updated on success.
+         *  \param error set to the reason creation failed, or ParseError::None
+         *  \return shared pointer to the new CompositionObject, or nullptr on failure.
+         */
+        static std::shared_ptr<CompositionObject> tryCreate(const char *data, const uint16_t &size, uint16_t &readPos,
+                                                            ParseError &error);
+
         /**
          *  \brief Imports the provided data and creates a shared pointer to a new CompositionObject instance.
          *  \param data pointer to raw data array
-         *  \param size size of the raw data array
+         *  \param size number of bytes remaining in the raw data array
          *  \param readPos point in array to read from.
          *
          *  \throws ImportException
          */
         static std::shared_ptr<CompositionObject> create(const char *data, const uint16_t &size, uint16_t &readPos);
 
+        /**
+         * \brief Writes the composition object in the same format it's imported from.
+         * \param writer writer to append the data to
+         */
+        void serialize(ByteWriter &writer) const;
+
         // =======
         // Getters
         // =======
@@ -85,6 +114,8 @@ namespace Pgs
 
         [[nodiscard]] const bool &getCroppedFlag() const;
 
+        [[nodiscard]] const bool &getForcedFlag() const;
+
         [[nodiscard]] const uint16_t &getHPos() const;
 
         [[nodiscard]] const uint16_t &getVPos() const;
@@ -128,7 +159,9 @@ namespace Pgs
          */
         PresentationComposition();
 
-        uint16_t import(const char *data, const uint16_t &size) override;
+        ParseError tryImport(const char *data, const uint16_t &size, uint16_t &readSize) override;
+
+        void serialize(ByteWriter &writer) const override;
 
         // =======
         // Getters
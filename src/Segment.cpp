@@ -24,8 +24,7 @@
 #include "PaletteDefinition.hpp"
 #include "ObjectDefinition.hpp"
 #include "PgsUtil.hpp"
-
-#include <cstring>
+#include "ByteReader.hpp"
 
 using std::vector;
 using std::unique_ptr;
@@ -33,6 +32,8 @@ using std::shared_ptr;
 
 using namespace Pgs;
 
+constexpr uint16_t Segment::MIN_BYTE_SIZE;
+
 Segment::Segment()
 {
     this->presentationTimestamp = 0u;
@@ -44,7 +45,7 @@ Segment::Segment()
 
 Segment::~Segment() = default;
 
-uint16_t Segment::getSegmentSize(const char *data, const uint16_t &size) noexcept
+uint16_t Segment::getSegmentSize(const char *data, const uint64_t &size) noexcept
 {
     if (size < Segment::MIN_BYTE_SIZE)
     {
@@ -52,35 +53,125 @@ uint16_t Segment::getSegmentSize(const char *data, const uint16_t &size) noexcep
     }
 
     const uint8_t sizeOffset = 11u;
-    uint16_t readPos = 0u; /* This just makes read2Bytes happy */
-    const auto segSize = Pgs::read2Bytes(reinterpret_cast<const uint8_t *>(data + sizeOffset), readPos);
-    return segSize;
+    return loadBigEndian16(reinterpret_cast<const uint8_t *>(data + sizeOffset));
+}
+
+bool Segment::isPlausibleHeader(const char *data, const uint64_t &size) noexcept
+{
+    if (!data || size < Segment::MIN_BYTE_SIZE || data[0] != 'P' || data[1] != 'G')
+    {
+        return false;
+    }
+
+    const uint8_t typeOffset = 10u;
+    const uint16_t segmentSize = Segment::getSegmentSize(data, Segment::MIN_BYTE_SIZE);
+    bool sizeMatchesType;
+    switch (SegmentType(static_cast<uint8_t>(data[typeOffset])))
+    {
+        case SegmentType::PaletteDefinition:
+            sizeMatchesType = segmentSize >= 2u && (segmentSize - 2u) % PaletteEntry::MIN_BYTE_SIZE == 0;
+            break;
+        case SegmentType::ObjectDefinition:
+            sizeMatchesType = segmentSize >= 4u;
+            break;
+        case SegmentType::PresentationComposition:
+            sizeMatchesType = segmentSize >= PresentationComposition::MIN_DATA_SIZE;
+            break;
+        case SegmentType::WindowDefinition:
+            sizeMatchesType = segmentSize >= WindowDefinition::MIN_BYTE_SIZE &&
+                              (segmentSize - 1) % WindowObject::MIN_BYTE_SIZE == 0;
+            break;
+        case SegmentType::EndOfDisplaySet:
+            sizeMatchesType = segmentSize == 0u;
+            break;
+        default:
+            return false;
+    }
+
+    const uint32_t segmentEnd = Segment::MIN_BYTE_SIZE + segmentSize;
+    if (!sizeMatchesType || segmentEnd > size)
+    {
+        return false;
+    }
+
+    return segmentEnd + 1 >= size || (data[segmentEnd] == 'P' && data[segmentEnd + 1] == 'G');
 }
 
-uint16_t Segment::import(const char *inData, const uint32_t &size)
+uint64_t Segment::findNext(const char *data, const uint64_t &size, const uint64_t &startPos) noexcept
 {
-    const auto byteData = reinterpret_cast<const uint8_t *>(inData);
+    const auto byteData = reinterpret_cast<const uint8_t *>(data);
+    uint64_t pos = startPos;
+    while (pos + Segment::MIN_BYTE_SIZE <= size)
+    {
+        const auto found = findMagicNumber(byteData + pos, size - pos);
+        if (!found)
+        {
+            break;
+        }
+
+        pos = static_cast<uint64_t>(found - byteData);
+        if (Segment::isPlausibleHeader(data + pos, size - pos))
+        {
+            return pos;
+        }
+        ++pos;
+    }
+
+    return size;
+}
 
-    if (!byteData)
+ParseError Segment::tryImportHeader(const char *inData, const uint64_t &size, uint16_t &readSize) noexcept
+{
+    if (!inData)
     {
-        throw ImportException("Segment: no import data provided.");
+        return ParseError::NoData;
     }
 
     if (size < Segment::MIN_BYTE_SIZE)
     {
-        throw ImportException("Segment: Not enough data to fill basic Segment.");
+        return ParseError::InsufficientData;
+    }
+
+    ByteReader reader(inData, Segment::MIN_BYTE_SIZE);
+    this->magicNumber[0] = static_cast<char>(reader.read8());
+    this->magicNumber[1] = static_cast<char>(reader.read8());
+    this->presentationTimestamp = reader.read32();
+    this->decodingTimestamp = reader.read32();
+    this->segmentType = SegmentType(reader.read8());
+    this->segmentSize = reader.read16();
+    this->data = nullptr;
+
+    readSize = reader.getPosition();
+    return ParseError::None;
+}
+
+uint16_t Segment::importHeader(const char *inData, const uint64_t &size)
+{
+    uint16_t readSize = 0u;
+    const auto error = this->tryImportHeader(inData, size, readSize);
+    if (error != ParseError::None)
+    {
+        throw ImportException(getParseErrorMessage(error));
+    }
+
+    return readSize;
+}
+
+ParseError Segment::tryImport(const char *inData, const uint64_t &size, uint32_t &readSize)
+{
+    uint16_t headerSize = 0u;
+    auto error = this->tryImportHeader(inData, size, headerSize);
+    if (error != ParseError::None)
+    {
+        return error;
     }
 
-    uint16_t readPos = 0u;
-    strncpy(this->magicNumber, reinterpret_cast<const char*>(byteData + readPos), 2);
-    readPos += 2;
-    this->presentationTimestamp = read4Bytes(byteData, readPos);
-    this->decodingTimestamp = read4Bytes(byteData, readPos);
-    this->segmentType = SegmentType(byteData[readPos]);
-    ++readPos;
-    this->segmentSize = read2Bytes(byteData, readPos);
+    if (size - headerSize < this->segmentSize)
+    {
+        return ParseError::TruncatedSegment;
+    }
 
-    const uint16_t remainingSize = size - readPos;
+    uint32_t readPos = headerSize;
     switch (this->segmentType)
     {
         case SegmentType::PaletteDefinition:
@@ -99,25 +190,38 @@ uint16_t Segment::import(const char *inData, const uint32_t &size)
             this->data = nullptr;
             break;
         default:
-            throw ImportException("Segment: Unexpected SegmentType encountered");
+            return ParseError::UnknownSegmentType;
     }
 
     if(this->segmentType != SegmentType::EndOfDisplaySet)
     {
-        try
-        {
-            readPos += this->data->import(inData + readPos, remainingSize);
-        }
-        catch (const ImportException &exception)
+        uint16_t dataSize = 0u;
+        error = this->data->tryImport(inData + readPos, this->segmentSize, dataSize);
+        if (error != ParseError::None)
         {
-            throw ImportException("Segment: Attempted to import non-existent data.");
+            this->data = nullptr;
+            return error;
         }
+        readPos += dataSize;
+    }
+
+    readSize = readPos;
+    return ParseError::None;
+}
+
+uint32_t Segment::import(const char *inData, const uint64_t &size)
+{
+    uint32_t readSize = 0u;
+    const auto error = this->tryImport(inData, size, readSize);
+    if (error != ParseError::None)
+    {
+        throw ImportException(getParseErrorMessage(error));
     }
 
-    return readPos;
+    return readSize;
 }
 
-uint16_t Segment::import(const vector<char> &inData)
+uint32_t Segment::import(const vector<char> &inData)
 {
     return this->import(inData.data(), inData.size());
 }
@@ -67,11 +67,84 @@ namespace Pgs
          * \param size size of provided array
          * \return size of first detected segment.
          */
-        static uint16_t getSegmentSize(const char *data, const uint16_t &size) noexcept;
+        static uint16_t getSegmentSize(const char *data, const uint64_t &size) noexcept;
 
-        uint16_t import(const char *inData, const uint32_t &size);
+        /**
+         * \brief Checks whether the provided data starts with something that looks like a valid segment.
+         *
+         * \details
+         * Besides the magic number, the segment type must be known, the segment size must be consistent with the type,
+         * and the segment must fit in the provided data. If more data follows the segment, it must start with another
+         * magic number. This weeds out "PG" byte pairs that happen to appear inside of object or palette data.
+         *
+         * \param data raw data array to check
+         * \param size number of bytes in the data array
+         * \return true if a plausible segment starts at the beginning of the data.
+         */
+        static bool isPlausibleHeader(const char *data, const uint64_t &size) noexcept;
+
+        /**
+         * \brief Finds the start of the next plausible segment.
+         *
+         * \details
+         * This is used both to step over padding between segments and to resynchronize after a damaged region.
+         *
+         * \param data raw data array to search
+         * \param size number of bytes in the data array
+         * \param startPos position to start searching from
+         * \return position of the next segment, or size if none was found.
+         */
+        static uint64_t findNext(const char *data, const uint64_t &size, const uint64_t &startPos) noexcept;
+
+        /**
+         * \brief Imports only the 13-byte segment header, leaving the segment data untouched.
+         *
+         * \details
+         * After this call, getData() returns a null pointer. This is used by callers that only need the segment
+         * type, size, and timing to walk a stream.
+         *
+         * \param inData pointer to raw data array
+         * \param size number of bytes in the data array
+         * \param readSize set to the number of bytes read from the data array on success
+         * \return ParseError::None on success, or the reason the import failed.
+         */
+        ParseError tryImportHeader(const char *inData, const uint64_t &size, uint16_t &readSize) noexcept;
+
+        /**
+         * \brief Imports only the 13-byte segment header, leaving the segment data untouched.
+         * \param inData pointer to raw data array
+         * \param size number of bytes in the data array
+         * \return number of bytes read from the data array
+         *
+         * \throws ImportException
+         */
+        uint16_t importHeader(const char *inData, const uint64_t &size);
+
+        /**
+         * \brief Imports the segment header and its data without throwing on malformed data.
+         *
+         * \details
+         * The data array may extend past the end of the segment. Only the header and the number of bytes given by
+         * the segment size are read.
+         *
+         * \param inData pointer to raw data array
+         * \param size number of bytes in the data array
+         * \param readSize set to the number of bytes read from the data array on success
+         * \return ParseError::None on success, or the reason the import failed.
+         */
+        ParseError tryImport(const char *inData, const uint64_t &size, uint32_t &readSize);
+
+        /**
+         * \brief Imports the segment header and its data.
+         * \param inData pointer to raw data array
+         * \param size number of bytes in the data array
+         * \return number of bytes read from the data array
+         *
+         * \throws ImportException
+         */
+        uint32_t import(const char *inData, const uint64_t &size);
 
-        uint16_t import(const std::vector<char> &inData);
+        uint32_t import(const std::vector<char> &inData);
 
         // =======
         // Getters
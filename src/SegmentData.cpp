@@ -25,3 +25,35 @@ using namespace Pgs;
 Pgs::ImportException::ImportException(const char *msg) : std::runtime_error(msg)
 {
 }
+
+const char *Pgs::getParseErrorMessage(const ParseError &error) noexcept
+{
+    switch (error)
+    {
+        case ParseError::None:
+            return "No error.";
+        case ParseError::NoData:
+            return "No data provided.";
+        case ParseError::InsufficientData:
+            return "Not enough data to import the structure.";
+        case ParseError::TruncatedSegment:
+            return "Segment size larger than remaining data.";
+        case ParseError::UnknownSegmentType:
+            return "Unexpected SegmentType encountered.";
+        case ParseError::IncompleteDisplaySet:
+            return "Data ended before the End segment of the display set.";
+    }
+    return "Unknown error.";
+}
+
+uint16_t SegmentData::import(const char *data, const uint16_t &size)
+{
+    uint16_t readSize = 0u;
+    const auto error = this->tryImport(data, size, readSize);
+    if (error != ParseError::None)
+    {
+        throw ImportException(getParseErrorMessage(error));
+    }
+
+    return readSize;
+}
@@ -25,6 +25,28 @@
 
 namespace Pgs
 {
+    class ByteWriter;
+
+    /**
+     * \brief Reasons a segment, or a display set made of segments, could not be imported.
+     */
+    enum class ParseError : uint8_t
+    {
+        None = 0,               /**< Import succeeded. */
+        NoData,                 /**< A null pointer or empty array was provided. */
+        InsufficientData,       /**< The data is too short for the structure being imported. */
+        TruncatedSegment,       /**< A segment header claims more bytes than are available. */
+        UnknownSegmentType,     /**< The segment type byte doesn't match any SegmentType. */
+        IncompleteDisplaySet    /**< The data ended before an End segment was found. */
+    };
+
+    /**
+     * \brief Gets a short, human-readable description of a ParseError.
+     * \param error error to describe
+     * \return static string describing the error
+     */
+    const char *getParseErrorMessage(const ParseError &error) noexcept;
+
     /**
      * \brief Abstract base class for classes used for storing segment data.
      */
@@ -38,14 +60,34 @@ namespace Pgs
 
         virtual ~SegmentData() noexcept = default;
 
+        /**
+         * \brief Imports the provided data into this SegmentData object without throwing on malformed data.
+         * \param data pointer to raw data array
+         * \param size number of bytes in data array
+         * \param readSize set to the number of bytes read from the data array on success
+         * \return ParseError::None on success, or the reason the import failed.
+         */
+        virtual ParseError tryImport(const char *data, const uint16_t &size, uint16_t &readSize) = 0;
+
         /**
          * \brief Imports the provided data into this SegmentData object.
          * \param data pointer to raw data array
          * \param size number of bytes in data array
+         * \return number of bytes read from the data array
          *
          * \throws ImportException
          */
-        virtual uint16_t import(const char *data, const uint16_t &size) = 0;
+        uint16_t import(const char *data, const uint16_t &size);
+
+        /**
+         * \brief Writes the data of this SegmentData object in the same format it's imported from.
+         *
+         * \details
+         * Only the segment data is written. The 13-byte segment header is written by the caller.
+         *
+         * \param writer writer to append the data to
+         */
+        virtual void serialize(ByteWriter &writer) const = 0;
     };
 
     /**
@@ -0,0 +1,104 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#include "StreamCursor.hpp"
+#include "Segment.hpp"
+
+using namespace Pgs;
+
+StreamCursor::StreamCursor(const char *data, const uint64_t &size, const uint64_t &position) noexcept
+{
+    this->data = data;
+    this->size = data ? size : 0u;
+    this->position = position < this->size ? position : this->size;
+}
+
+bool StreamCursor::canRead(const uint64_t &count) const noexcept
+{
+    return count <= this->size - this->position;
+}
+
+bool StreamCursor::advance(const uint64_t &count) noexcept
+{
+    if (!this->canRead(count))
+    {
+        return false;
+    }
+
+    this->position += count;
+    return true;
+}
+
+bool StreamCursor::seek(const uint64_t &newPosition) noexcept
+{
+    if (newPosition > this->size)
+    {
+        return false;
+    }
+
+    this->position = newPosition;
+    return true;
+}
+
+bool StreamCursor::seekNextSegment() noexcept
+{
+    this->position = Segment::findNext(this->data, this->size, this->position);
+    return !this->atEnd();
+}
+
+StreamCursor StreamCursor::limit(const uint64_t &count) const noexcept
+{
+    const uint64_t end = this->canRead(count) ? this->position + count : this->size;
+    return StreamCursor(this->data, end, this->position);
+}
+
+// =======
+// Getters
+// =======
+
+const char *StreamCursor::getData() const noexcept
+{
+    return this->data;
+}
+
+const char *StreamCursor::getCurrent() const noexcept
+{
+    return this->data + this->position;
+}
+
+const uint64_t &StreamCursor::getSize() const noexcept
+{
+    return this->size;
+}
+
+const uint64_t &StreamCursor::getPosition() const noexcept
+{
+    return this->position;
+}
+
+uint64_t StreamCursor::getRemaining() const noexcept
+{
+    return this->size - this->position;
+}
+
+bool StreamCursor::atEnd() const noexcept
+{
+    return this->position >= this->size;
+}
@@ -0,0 +1,126 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace Pgs
+{
+    /**
+     * \brief Read position within a bounded PGS data stream.
+     *
+     * \details
+     * All stream-level offsets are 64-bit so that concatenated or very long streams larger than 4GB can be parsed
+     * without being split first. The cursor never moves outside of [0, size], so callers only need to check the
+     * return values of advance() and seek() instead of re-validating positions themselves.
+     */
+    class StreamCursor
+    {
+    protected:
+        const char *data; /**< Pointer to the start of the stream. */
+        uint64_t size; /**< Number of bytes in the stream. */
+        uint64_t position; /**< Current read position, relative to the start of the stream. */
+    public:
+        /**
+         * \brief Creates a cursor over the provided data.
+         * \param data pointer to the start of the stream
+         * \param size number of bytes in the stream
+         * \param position initial read position. Clamped to size.
+         */
+        StreamCursor(const char *data, const uint64_t &size, const uint64_t &position = 0u) noexcept;
+
+        /**
+         * \brief Checks whether at least the requested number of bytes remain after the current position.
+         * \param count number of bytes
+         * \return true if count bytes can be read.
+         */
+        [[nodiscard]] bool canRead(const uint64_t &count) const noexcept;
+
+        /**
+         * \brief Moves the read position forward.
+         * \param count number of bytes to move forward by
+         * \return true on success. If fewer than count bytes remain, the position is left unchanged.
+         */
+        bool advance(const uint64_t &count) noexcept;
+
+        /**
+         * \brief Moves the read position to the provided offset.
+         * \param newPosition offset relative to the start of the stream
+         * \return true on success. If newPosition is past the end of the stream, the position is left unchanged.
+         */
+        bool seek(const uint64_t &newPosition) noexcept;
+
+        /**
+         * \brief Moves the read position to the start of the next plausible segment.
+         *
+         * \details
+         * If the cursor already points at a segment, it isn't moved. If no segment is found, the cursor is moved to
+         * the end of the stream.
+         *
+         * \return true if a segment was found.
+         */
+        bool seekNextSegment() noexcept;
+
+        /**
+         * \brief Creates a cursor over the same stream whose end is limited to count bytes past the current position.
+         *
+         * \details
+         * Positions of the new cursor are still relative to the start of the stream, so offsets reported while
+         * reading through it are stream offsets.
+         *
+         * \param count maximum number of bytes readable through the new cursor. Clamped to the remaining bytes.
+         * \return new bounded cursor starting at the current position.
+         */
+        [[nodiscard]] StreamCursor limit(const uint64_t &count) const noexcept;
+
+        // =======
+        // Getters
+        // =======
+
+        /**
+         * \brief Gets a pointer to the start of the stream.
+         * \return pointer to the first byte of the stream
+         */
+        [[nodiscard]] const char *getData() const noexcept;
+
+        /**
+         * \brief Gets a pointer to the byte at the current position.
+         * \return pointer to the current byte
+         */
+        [[nodiscard]] const char *getCurrent() const noexcept;
+
+        [[nodiscard]] const uint64_t &getSize() const noexcept;
+
+        [[nodiscard]] const uint64_t &getPosition() const noexcept;
+
+        /**
+         * \brief Gets the number of bytes from the current position to the end of the stream.
+         * \return number of remaining bytes
+         */
+        [[nodiscard]] uint64_t getRemaining() const noexcept;
+
+        /**
+         * \brief Checks whether the current position is at the end of the stream.
+         * \return true if no bytes remain.
+         */
+        [[nodiscard]] bool atEnd() const noexcept;
+    };
+}
@@ -0,0 +1,519 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#include "StreamEditor.hpp"
+#include "ByteReader.hpp"
+#include "ByteWriter.hpp"
+
+#include <algorithm>
+
+using std::vector;
+
+using namespace Pgs;
+
+namespace
+{
+    // Offsets of the PCS fields patched while copying, relative to the start of the PCS segment.
+    constexpr uint8_t COMPOSITION_NUMBER_OFFSET = Segment::MIN_BYTE_SIZE + 5u;
+    constexpr uint8_t COMPOSITION_STATE_OFFSET = Segment::MIN_BYTE_SIZE + 7u;
+    constexpr uint8_t PALETTE_UPDATE_FLAG_OFFSET = Segment::MIN_BYTE_SIZE + 8u;
+
+    // Offsets of the fields read while completing display sets, relative to the start of a segment.
+    constexpr uint8_t TIMESTAMPS_OFFSET = 2u;
+    constexpr uint8_t SEGMENT_TYPE_OFFSET = 10u;
+    constexpr uint8_t DEFINITION_ID_OFFSET = Segment::MIN_BYTE_SIZE; /**< ID of a PDS or an ODS. */
+    constexpr uint8_t SEQUENCE_FLAG_OFFSET = Segment::MIN_BYTE_SIZE + 3u;
+
+    /**
+     * \brief Bytes of a single segment, header included.
+     */
+    struct SegmentRange
+    {
+        const char *data; /**< First byte of the segment header. */
+        uint32_t size; /**< Number of bytes including the header. */
+
+        [[nodiscard]] SegmentType getType() const noexcept
+        {
+            return SegmentType(static_cast<uint8_t>(this->data[SEGMENT_TYPE_OFFSET]));
+        }
+
+        [[nodiscard]] uint8_t getPaletteId() const noexcept
+        {
+            return static_cast<uint8_t>(this->data[DEFINITION_ID_OFFSET]);
+        }
+
+        [[nodiscard]] uint16_t getObjectId() const noexcept
+        {
+            return loadBigEndian16(reinterpret_cast<const uint8_t *>(this->data + DEFINITION_ID_OFFSET));
+        }
+
+        [[nodiscard]] bool isFirstFragment() const noexcept
+        {
+            return (static_cast<uint8_t>(this->data[SEQUENCE_FLAG_OFFSET]) &
+                    static_cast<uint8_t>(SequenceFlag::First)) != 0u;
+        }
+    };
+
+    /**
+     * \brief Splits a display set into its segments, reading only the segment headers.
+     */
+    vector<SegmentRange> splitSegments(const char *data, const DisplaySetInfo &displaySet)
+    {
+        vector<SegmentRange> segments;
+        const char *source = data + displaySet.getOffset();
+        uint64_t readPos = 0u;
+        while (readPos + Segment::MIN_BYTE_SIZE <= displaySet.getSize())
+        {
+            const uint64_t remaining = displaySet.getSize() - readPos;
+            const uint64_t size = Segment::MIN_BYTE_SIZE + Segment::getSegmentSize(source + readPos, remaining);
+            segments.push_back({source + readPos, static_cast<uint32_t>(std::min(size, remaining))});
+            readPos += size;
+        }
+
+        return segments;
+    }
+}
+
+StreamEditor::StreamEditor()
+{
+    this->compositionNumber = 0u;
+    this->numDisplaySets = 0u;
+    this->numSkippedDisplaySets = 0u;
+}
+
+bool StreamEditor::completeDisplaySet(const char *data, const vector<DisplaySetInfo> &displaySets, const size_t &index,
+                                      const bool &epochStart, const bool &forcedOnly, vector<char> &complete) const
+{
+    complete.clear();
+    const auto &displaySet = displaySets[index];
+    const auto &pcs = displaySet.getPcs();
+    if (pcs->getCompositionState() == CompositionState::EpochStart)
+    {
+        // Nothing from before an EpochStart can be used, so it's copied as it is.
+        return true;
+    }
+    const auto segments = splitSegments(data, displaySet);
+
+    // Find out what the display set uses without defining it.
+    vector<uint16_t> missingObjects;
+    for (const auto &compositionObject : pcs->getCompositionObjects())
+    {
+        const auto &objectID = compositionObject->getObjectID();
+        if ((forcedOnly && !compositionObject->getForcedFlag()) ||
+            (!epochStart && this->heldObjects.count(objectID) > 0u) ||
+            std::find(missingObjects.begin(), missingObjects.end(), objectID) != missingObjects.end())
+        {
+            continue;
+        }
+
+        const bool defined = std::any_of(segments.begin(), segments.end(), [&](const SegmentRange &segment) {
+            return segment.getType() == SegmentType::ObjectDefinition && segment.getObjectId() == objectID &&
+                   segment.isFirstFragment();
+        });
+        if (!defined)
+        {
+            missingObjects.push_back(objectID);
+        }
+    }
+
+    bool missingWindows = !displaySet.getWds() && (epochStart || !this->heldWindows);
+    bool missingPalette = pcs->getCompositionObjectCount() > 0u &&
+                          (epochStart || this->heldPalettes.count(pcs->getPaletteID()) == 0u) &&
+                          std::none_of(segments.begin(), segments.end(), [&](const SegmentRange &segment) {
+                              return segment.getType() == SegmentType::PaletteDefinition &&
+                                     segment.getPaletteId() == pcs->getPaletteID();
+                          });
+
+    vector<SegmentRange> copied;
+    for (size_t i = index; i-- > 0u && (missingWindows || missingPalette || !missingObjects.empty());)
+    {
+        const auto earlierSegments = splitSegments(data, displaySets[i]);
+        for (const auto &segment : earlierSegments)
+        {
+            if (missingWindows && segment.getType() == SegmentType::WindowDefinition)
+            {
+                copied.push_back(segment);
+                missingWindows = false;
+            }
+            else if (missingPalette && segment.getType() == SegmentType::PaletteDefinition &&
+                     segment.getPaletteId() == pcs->getPaletteID())
+            {
+                copied.push_back(segment);
+                missingPalette = false;
+            }
+        }
+
+        // Copy every fragment of the latest definition of each missing object.
+        for (auto objectID = missingObjects.begin(); objectID != missingObjects.end();)
+        {
+            vector<SegmentRange> fragments;
+            for (const auto &segment : earlierSegments)
+            {
+                if (segment.getType() != SegmentType::ObjectDefinition || segment.getObjectId() != *objectID)
+                {
+                    continue;
+                }
+
+                if (segment.isFirstFragment())
+                {
+                    fragments.clear();
+                    fragments.push_back(segment);
+                }
+                else if (!fragments.empty())
+                {
+                    fragments.push_back(segment);
+                }
+            }
+
+            if (fragments.empty())
+            {
+                ++objectID;
+                continue;
+            }
+            copied.insert(copied.end(), fragments.begin(), fragments.end());
+            objectID = missingObjects.erase(objectID);
+        }
+
+        if (displaySets[i].getPcs()->getCompositionState() == CompositionState::EpochStart)
+        {
+            break;
+        }
+    }
+
+    if (missingWindows || missingPalette || !missingObjects.empty())
+    {
+        return false;
+    }
+    if (copied.empty())
+    {
+        return true;
+    }
+
+    // Rebuild the display set in segment order, copied definitions first within each type.
+    const char *timestamps = segments.front().data + TIMESTAMPS_OFFSET;
+    for (const auto &type : {SegmentType::PresentationComposition, SegmentType::WindowDefinition,
+                             SegmentType::PaletteDefinition, SegmentType::ObjectDefinition,
+                             SegmentType::EndOfDisplaySet})
+    {
+        for (const auto &segment : copied)
+        {
+            if (segment.getType() == type)
+            {
+                const size_t position = complete.size();
+                complete.insert(complete.end(), segment.data, segment.data + segment.size);
+                std::copy(timestamps, timestamps + 8u, complete.begin() + position + TIMESTAMPS_OFFSET);
+            }
+        }
+        for (const auto &segment : segments)
+        {
+            if (segment.getType() == type)
+            {
+                complete.insert(complete.end(), segment.data, segment.data + segment.size);
+            }
+        }
+    }
+
+    // A palette update can't bring new objects along.
+    if (std::any_of(copied.begin(), copied.end(), [](const SegmentRange &segment) {
+        return segment.getType() == SegmentType::ObjectDefinition;
+    }))
+    {
+        complete[PALETTE_UPDATE_FLAG_OFFSET] = 0;
+    }
+
+    return true;
+}
+
+void StreamEditor::appendClear(const DisplaySetInfo &previous, const uint32_t &time)
+{
+    const auto &pcs = previous.getPcs();
+
+    vector<uint8_t> displaySet;
+    ByteWriter writer(displaySet);
+
+    // PCS without any composition objects
+    writer.write8('P');
+    writer.write8('G');
+    writer.write32(time);
+    writer.write32(time);
+    writer.write8(static_cast<uint8_t>(SegmentType::PresentationComposition));
+    writer.write16(static_cast<uint16_t>(PresentationComposition::MIN_DATA_SIZE));
+    writer.write16(pcs->getWidth());
+    writer.write16(pcs->getHeight());
+    writer.write8(pcs->getFrameRate());
+    writer.write16(this->compositionNumber);
+    writer.write8(static_cast<uint8_t>(CompositionState::Normal));
+    writer.write8(0u);
+    writer.write8(pcs->getPaletteID());
+    writer.write8(0u);
+
+    // WDS of the windows being cleared
+    if (this->heldWindows)
+    {
+        const size_t windowsStart = writer.getPosition();
+        writer.write8('P');
+        writer.write8('G');
+        writer.write32(time);
+        writer.write32(time);
+        writer.write8(static_cast<uint8_t>(SegmentType::WindowDefinition));
+        writer.write16(0u);
+        this->heldWindows->serialize(writer);
+        writer.patch16(windowsStart + Segment::MIN_BYTE_SIZE - 2u,
+                       static_cast<uint16_t>(writer.getPosition() - windowsStart - Segment::MIN_BYTE_SIZE));
+    }
+
+    // END
+    writer.write8('P');
+    writer.write8('G');
+    writer.write32(time);
+    writer.write32(time);
+    writer.write8(static_cast<uint8_t>(SegmentType::EndOfDisplaySet));
+    writer.write16(0u);
+
+    this->output.insert(this->output.end(), displaySet.begin(), displaySet.end());
+    ++this->compositionNumber;
+    ++this->numDisplaySets;
+}
+
+void StreamEditor::appendDisplaySet(const char *data, const DisplaySetInfo &displaySet, const bool &epochStart,
+                                    const TimeTransform &transform, const bool &forcedOnly)
+{
+    const size_t outputPos = this->output.size();
+    const char *source = data + displaySet.getOffset();
+    const auto &pcs = displaySet.getPcs();
+
+    // Keep track of what the decoder holds once the display set is decoded.
+    if (epochStart || pcs->getCompositionState() == CompositionState::EpochStart)
+    {
+        this->heldWindows.reset();
+        this->heldPalettes.clear();
+        this->heldObjects.clear();
+    }
+    this->heldWindows = displaySet.getWds() ? displaySet.getWds() : this->heldWindows;
+    for (const auto &segment : splitSegments(data, displaySet))
+    {
+        if (segment.getType() == SegmentType::PaletteDefinition)
+        {
+            this->heldPalettes.insert(segment.getPaletteId());
+        }
+        else if (segment.getType() == SegmentType::ObjectDefinition && segment.isFirstFragment())
+        {
+            this->heldObjects.insert(segment.getObjectId());
+        }
+    }
+
+    uint32_t copyStart = 0u;
+    if (forcedOnly && pcs->getCompositionObjectCount() > 0u)
+    {
+        std::vector<std::shared_ptr<CompositionObject>> forcedObjects;
+        for (const auto &compositionObject : pcs->getCompositionObjects())
+        {
+            if (compositionObject->getForcedFlag())
+            {
+                forcedObjects.push_back(compositionObject);
+            }
+        }
+
+        // Rebuild the PCS without the objects that aren't forced; everything after it is still copied as is.
+        if (forcedObjects.size() != pcs->getCompositionObjectCount())
+        {
+            vector<uint8_t> composition;
+            ByteWriter writer(composition);
+            writer.writeBytes(reinterpret_cast<const uint8_t *>(source), Segment::MIN_BYTE_SIZE - 2u);
+            writer.write16(0u);
+            writer.writeBytes(reinterpret_cast<const uint8_t *>(source) + Segment::MIN_BYTE_SIZE,
+                              PresentationComposition::MIN_DATA_SIZE - 1u);
+            writer.write8(static_cast<uint8_t>(forcedObjects.size()));
+            for (const auto &compositionObject : forcedObjects)
+            {
+                compositionObject->serialize(writer);
+            }
+            writer.patch16(Segment::MIN_BYTE_SIZE - 2u,
+                           static_cast<uint16_t>(composition.size() - Segment::MIN_BYTE_SIZE));
+
+            this->output.insert(this->output.end(), composition.begin(), composition.end());
+            copyStart = Segment::MIN_BYTE_SIZE + Segment::getSegmentSize(source, displaySet.getSize());
+        }
+    }
+
+    // Copy the display set as is, then patch the few fields that change.
+    this->output.insert(this->output.end(), source + copyStart, source + displaySet.getSize());
+    char *copy = this->output.data() + outputPos;
+    const uint64_t copySize = this->output.size() - outputPos;
+
+    auto pcsData = reinterpret_cast<uint8_t *>(copy);
+    storeBigEndian16(pcsData + COMPOSITION_NUMBER_OFFSET, this->compositionNumber);
+    if (epochStart)
+    {
+        pcsData[COMPOSITION_STATE_OFFSET] = static_cast<uint8_t>(CompositionState::EpochStart);
+        pcsData[PALETTE_UPDATE_FLAG_OFFSET] = 0u;
+    }
+    transform.applyInPlace(copy, copySize);
+
+    ++this->compositionNumber;
+    ++this->numDisplaySets;
+}
+
+bool StreamEditor::appendCompleted(const char *data, const vector<DisplaySetInfo> &displaySets, const size_t &index,
+                                   const bool &epochStart, const TimeTransform &transform, const bool &forcedOnly)
+{
+    vector<char> complete;
+    if (!this->completeDisplaySet(data, displaySets, index, epochStart, forcedOnly, complete))
+    {
+        ++this->numSkippedDisplaySets;
+        return false;
+    }
+
+    if (complete.empty())
+    {
+        this->appendDisplaySet(data, displaySets[index], epochStart, transform, forcedOnly);
+        return true;
+    }
+
+    const auto completeInfo = DisplaySetInfo::scanAll(complete.data(), complete.size());
+    if (completeInfo.size() != 1u)
+    {
+        ++this->numSkippedDisplaySets;
+        return false;
+    }
+    this->appendDisplaySet(complete.data(), completeInfo.front(), epochStart, transform, forcedOnly);
+    return true;
+}
+
+uint64_t StreamEditor::append(const char *data, const uint64_t &size, const uint32_t &startTime,
+                              const uint32_t &endTime, const uint32_t &outputTime)
+{
+    const auto displaySets = DisplaySetInfo::scanAll(data, size);
+    const TimeTransform transform(static_cast<int64_t>(outputTime) - startTime);
+    const auto first = static_cast<size_t>(
+            std::find_if(displaySets.begin(), displaySets.end(), [&](const DisplaySetInfo &displaySet) {
+                return displaySet.getPresentationTime() >= startTime;
+            }) - displaySets.begin());
+
+    uint64_t numAppended = 0u;
+    const DisplaySetInfo *lastAppended = nullptr;
+
+    // Show whatever is on screen at startTime from outputTime on.
+    if (first > 0u && (first == displaySets.size() || displaySets[first].getPresentationTime() > startTime) &&
+        displaySets[first - 1u].containsImage())
+    {
+        const auto &shown = displaySets[first - 1u];
+        const TimeTransform shownTransform(static_cast<int64_t>(outputTime) - shown.getPresentationTime());
+        if (this->appendCompleted(data, displaySets, first - 1u, true, shownTransform, false))
+        {
+            ++numAppended;
+            lastAppended = &shown;
+        }
+    }
+
+    for (size_t i = first; i < displaySets.size() && displaySets[i].getPresentationTime() < endTime; ++i)
+    {
+        if (!this->appendCompleted(data, displaySets, i, lastAppended == nullptr, transform, false))
+        {
+            continue;
+        }
+        ++numAppended;
+        lastAppended = &displaySets[i];
+    }
+
+    // Don't leave the last object of the range on screen past the end of the range.
+    if (lastAppended && endTime != UINT32_MAX && lastAppended->getPcs()->getCompositionObjectCount() > 0u)
+    {
+        this->appendClear(*lastAppended, transform.apply(endTime));
+        ++numAppended;
+    }
+
+    return numAppended;
+}
+
+uint64_t StreamEditor::append(const char *data, const uint64_t &size, const uint32_t &outputTime)
+{
+    return this->append(data, size, 0u, UINT32_MAX, outputTime);
+}
+
+uint64_t StreamEditor::appendForced(const char *data, const uint64_t &size, const uint32_t &outputTime)
+{
+    const auto displaySets = DisplaySetInfo::scanAll(data, size);
+    const TimeTransform transform(outputTime);
+
+    uint64_t numAppended = 0u;
+    const DisplaySetInfo *lastAppended = nullptr;
+    bool showing = false;
+    for (size_t i = 0; i < displaySets.size(); ++i)
+    {
+        const auto &displaySet = displaySets[i];
+        if (!displaySet.containsForcedImage())
+        {
+            // Whatever replaces the forced objects isn't copied, so they have to be removed explicitly.
+            if (showing)
+            {
+                this->appendClear(*lastAppended, transform.apply(displaySet.getPresentationTime()));
+                ++numAppended;
+                showing = false;
+            }
+            continue;
+        }
+
+        // Forced objects may have been defined by display sets that weren't copied, so bring their definitions along.
+        if (!this->appendCompleted(data, displaySets, i, !showing, transform, true))
+        {
+            continue;
+        }
+        ++numAppended;
+        lastAppended = &displaySet;
+        showing = true;
+    }
+
+    return numAppended;
+}
+
+vector<char> StreamEditor::cut(const char *data, const uint64_t &size, const uint32_t &startTime,
+                               const uint32_t &endTime)
+{
+    StreamEditor editor;
+    editor.append(data, size, startTime, endTime, startTime);
+    return editor.output;
+}
+
+vector<char> StreamEditor::extractForced(const char *data, const uint64_t &size)
+{
+    StreamEditor editor;
+    editor.appendForced(data, size);
+    return editor.output;
+}
+
+// =======
+// Getters
+// =======
+
+const vector<char> &StreamEditor::getOutput() const noexcept
+{
+    return this->output;
+}
+
+const uint64_t &StreamEditor::getNumDisplaySets() const noexcept
+{
+    return this->numDisplaySets;
+}
+
+const uint64_t &StreamEditor::getNumSkippedDisplaySets() const noexcept
+{
+    return this->numSkippedDisplaySets;
+}
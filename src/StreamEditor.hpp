@@ -0,0 +1,188 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#pragma once
+
+#include "DisplaySetInfo.hpp"
+#include "TimeTransform.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <vector>
+
+namespace Pgs
+{
+    /**
+     * \brief Builds a new stream out of time ranges of existing streams without decoding or re-encoding any objects.
+     *
+     * \details
+     * Every append() call adds one piece to the output. The display sets of a piece are copied byte for byte, and
+     * only their timestamps, composition numbers, and (for the first one) composition state are patched. Each piece
+     * starts at an EpochStart so that it can be decoded on its own, and composition numbers keep counting up across
+     * pieces. Windows, palettes and objects a piece uses from before its start are copied in from the source stream,
+     * so the editor keeps track of what the output defines in its current epoch.
+     */
+    class StreamEditor
+    {
+    protected:
+        std::vector<char> output; /**< Stream built so far. */
+        uint16_t compositionNumber; /**< Composition number given to the next display set written. */
+        uint64_t numDisplaySets; /**< Number of display sets written so far. */
+        uint64_t numSkippedDisplaySets; /**< Number of display sets left out because they couldn't be shown. */
+        std::shared_ptr<WindowDefinition> heldWindows; /**< Windows defined in the output since its last EpochStart. */
+        std::set<uint8_t> heldPalettes; /**< IDs of the palettes defined in the output since its last EpochStart. */
+        std::set<uint16_t> heldObjects; /**< IDs of the objects defined in the output since its last EpochStart. */
+
+        /**
+         * \brief Rebuilds a display set together with the definitions it uses that the output doesn't hold.
+         *
+         * \details
+         * Windows, the palette and objects that the display set uses, but that neither it nor the output defines, are
+         * copied from the latest display sets defining them, back to the last EpochStart. Copied segments get the
+         * timestamps of the PCS. If objects are copied, the palette update flag is cleared.
+         *
+         * \param data pointer to the raw PGS data the display sets were scanned from
+         * \param displaySets display sets of the stream, in stream order
+         * \param index index of the display set to rebuild
+         * \param epochStart set to true if the display set will start a new epoch, so the output holds nothing for it
+         * \param forcedOnly set to true to only look for the objects that are forced
+         * \param complete set to the rebuilt display set, or left empty if nothing had to be copied
+         * \return false if anything the display set uses isn't defined within its epoch.
+         */
+        bool completeDisplaySet(const char *data, const std::vector<DisplaySetInfo> &displaySets, const size_t &index,
+                                const bool &epochStart, const bool &forcedOnly, std::vector<char> &complete) const;
+
+        /**
+         * \brief Appends a display set removing every object from the screen.
+         *
+         * \details
+         * The display set holds a PCS, the WDS of the windows the output holds, and an END segment. Every segment is
+         * decoded and presented at the provided time.
+         *
+         * \param previous display set whose video size, frame rate and palette are reused
+         * \param time presentation time of the new display set with 90kHz accuracy
+         */
+        void appendClear(const DisplaySetInfo &previous, const uint32_t &time);
+
+        /**
+         * \brief Copies a display set to the output, patching its composition number and timestamps.
+         * \param data pointer to the raw PGS data the display set was scanned from
+         * \param displaySet display set to copy
+         * \param epochStart set to true to turn the display set into an EpochStart, clearing its palette update flag
+         * \param transform transformation applied to the segment timestamps
+         * \param forcedOnly set to true to drop composition objects that aren't forced
+         */
+        void appendDisplaySet(const char *data, const DisplaySetInfo &displaySet, const bool &epochStart,
+                              const TimeTransform &transform, const bool &forcedOnly);
+
+        /**
+         * \brief Copies a display set to the output along with the definitions it uses that the output doesn't hold.
+         * \param data pointer to the raw PGS data the display sets were scanned from
+         * \param displaySets display sets of the stream, in stream order
+         * \param index index of the display set to copy
+         * \param epochStart set to true to turn the display set into an EpochStart
+         * \param transform transformation applied to the segment timestamps
+         * \param forcedOnly set to true to drop composition objects that aren't forced
+         * \return false if the display set was skipped, since something it uses isn't defined within its epoch.
+         */
+        bool appendCompleted(const char *data, const std::vector<DisplaySetInfo> &displaySets, const size_t &index,
+                             const bool &epochStart, const TimeTransform &transform, const bool &forcedOnly);
+    public:
+        StreamEditor();
+
+        /**
+         * \brief Appends the display sets of a stream presented within [startTime, endTime).
+         *
+         * \details
+         * Timestamps are shifted so that startTime lands on outputTime. The composition on screen at startTime, if
+         * any, is shown again at outputTime, and the first display set written is turned into an EpochStart. Display
+         * sets using windows, palettes or objects defined before startTime are copied along with those definitions.
+         * Display sets whose definitions can't be found since the last EpochStart are skipped and counted by
+         * getNumSkippedDisplaySets(). If an object is still shown at endTime, a clearing display set is added at
+         * endTime.
+         *
+         * \param data pointer to raw PGS data
+         * \param size number of bytes in the data array
+         * \param startTime start of the range to copy with 90kHz accuracy
+         * \param endTime end of the range to copy with 90kHz accuracy, exclusive
+         * \param outputTime time in the output stream that startTime is moved to
+         * \return number of display sets appended
+         */
+        uint64_t append(const char *data, const uint64_t &size, const uint32_t &startTime, const uint32_t &endTime,
+                        const uint32_t &outputTime);
+
+        /**
+         * \brief Appends a whole stream, shifting its timestamps by the provided offset.
+         * \param data pointer to raw PGS data
+         * \param size number of bytes in the data array
+         * \param outputTime time in the output stream that time 0 of the appended stream is moved to
+         * \return number of display sets appended
+         */
+        uint64_t append(const char *data, const uint64_t &size, const uint32_t &outputTime = 0u);
+
+        /**
+         * \brief Appends only the display sets of a stream that show forced objects.
+         *
+         * \details
+         * Object data is never decoded; display sets are picked using the composition object flags alone. Objects
+         * that aren't forced are removed from the copied compositions, and a clearing display set is added wherever
+         * the original stream replaces forced objects with regular ones or removes them.
+         * <br/><br/>A display set showing forced objects defined earlier in its epoch, e.g. a Normal update setting
+         * the forced flag, is copied along with the windows, palette and objects it uses that weren't copied yet. It's
+         * only skipped, and counted by getNumSkippedDisplaySets(), if those aren't defined since the last EpochStart.
+         *
+         * \param data pointer to raw PGS data
+         * \param size number of bytes in the data array
+         * \param outputTime time in the output stream that time 0 of the appended stream is moved to
+         * \return number of display sets appended
+         */
+        uint64_t appendForced(const char *data, const uint64_t &size, const uint32_t &outputTime = 0u);
+
+        /**
+         * \brief Copies the display sets of a stream presented within [startTime, endTime), keeping their timing.
+         * \param data pointer to raw PGS data
+         * \param size number of bytes in the data array
+         * \param startTime start of the range to copy with 90kHz accuracy
+         * \param endTime end of the range to copy with 90kHz accuracy, exclusive
+         * \return new stream holding the selected range
+         */
+        static std::vector<char> cut(const char *data, const uint64_t &size, const uint32_t &startTime,
+                                     const uint32_t &endTime);
+
+        /**
+         * \brief Copies the display sets of a stream that show forced objects, keeping their timing.
+         * \param data pointer to raw PGS data
+         * \param size number of bytes in the data array
+         * \return new stream holding the forced subtitles only
+         */
+        static std::vector<char> extractForced(const char *data, const uint64_t &size);
+
+        // =======
+        // Getters
+        // =======
+
+        [[nodiscard]] const std::vector<char> &getOutput() const noexcept;
+
+        [[nodiscard]] const uint64_t &getNumDisplaySets() const noexcept;
+
+        [[nodiscard]] const uint64_t &getNumSkippedDisplaySets() const noexcept;
+    };
+}
@@ -0,0 +1,299 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#include "StreamOptimizer.hpp"
+#include "PgsUtil.hpp"
+#include "ByteWriter.hpp"
+
+#include <cstring>
+
+using std::shared_ptr;
+using std::vector;
+
+using namespace Pgs;
+
+namespace
+{
+    constexpr uint8_t COMPOSITION_STATE_OFFSET = Segment::MIN_BYTE_SIZE + 7u; /**< Relative to the PCS start. */
+    constexpr uint8_t PALETTE_ENTRIES_OFFSET = Segment::MIN_BYTE_SIZE + 2u; /**< Relative to the PDS start. */
+    constexpr uint8_t SEGMENT_TYPE_OFFSET = 10u; /**< Relative to the segment start. */
+
+    /**
+     * \brief Segment of a display set waiting to be written.
+     */
+    struct PendingSegment
+    {
+        const char *data; /**< Original bytes of the segment, written when there are no fragments. */
+        uint32_t size; /**< Number of original bytes. */
+        vector<shared_ptr<ObjectDefinition>> fragments; /**< Re-encoded object written in place of the original. */
+        uint32_t presentationTimestamp; /**< PTS of the original first fragment of the re-encoded object. */
+        uint32_t decodingTimestamp; /**< DTS of the original first fragment of the re-encoded object. */
+        bool redundant = false; /**< True for a palette or object the decoder already holds. */
+    };
+}
+
+StreamOptimizer::StreamOptimizer()
+{
+    this->numDroppedPalettes = 0u;
+    this->numDroppedObjects = 0u;
+    this->numReencodedObjects = 0u;
+    this->numConvertedDisplaySets = 0u;
+}
+
+bool StreamOptimizer::decodeObject(const ObjectDefinition &object, vector<uint8_t> &pixels)
+{
+    const auto &width = object.getWidth();
+    const auto &height = object.getHeight();
+    const auto lines = object.getDecodedObjectData();
+
+    pixels.assign(static_cast<size_t>(width) * height + 4u, 0u);
+    storeBigEndian16(pixels.data(), width);
+    storeBigEndian16(pixels.data() + 2u, height);
+    for (size_t y = 0; y < lines.size(); ++y)
+    {
+        // Lines cut short by truncated data come back short or empty rather than missing.
+        if (lines[y].size() != width)
+        {
+            return false;
+        }
+        std::memcpy(pixels.data() + 4u + y * width, lines[y].data(), width);
+    }
+
+    return true;
+}
+
+vector<shared_ptr<ObjectDefinition>> StreamOptimizer::reencodeObject(const ObjectDefinition &object,
+                                                                     const vector<uint8_t> &pixels)
+{
+    const auto &width = object.getWidth();
+    const auto &height = object.getHeight();
+    auto encoded = ObjectDefinition::encodeObjectData(pixels.data() + 4u, width, height, width);
+    if (encoded.size() >= object.getEncodedObjectData().size())
+    {
+        return {};
+    }
+
+    return ObjectDefinition::createFragments(object.getId(), object.getVersion(), width, height, std::move(encoded));
+}
+
+void StreamOptimizer::optimizeDisplaySet(const char *data, const DisplaySetInfo &displaySet, SupWriter &writer)
+{
+    const auto &pcs = displaySet.getPcs();
+    const auto &state = pcs->getCompositionState();
+    const bool epochStart = state == CompositionState::EpochStart;
+    if (epochStart)
+    {
+        this->paletteHashes.clear();
+        this->objectHashes.clear();
+    }
+
+    vector<PendingSegment> pending;
+    bool redefines = false;
+
+    // Fragments of the object currently being joined, in case it has to be written as it was.
+    shared_ptr<ObjectDefinition> object;
+    const char *objectStart = nullptr;
+    const char *objectEnd = nullptr;
+    uint32_t objectPts = 0u;
+    uint32_t objectDts = 0u;
+
+    const char *setStart = data + displaySet.getOffset();
+    uint64_t readPos = 0u;
+    while (readPos < displaySet.getSize())
+    {
+        const char *segmentStart = setStart + readPos;
+        Segment segment;
+        uint32_t segmentSize = 0u;
+        if (segment.tryImport(segmentStart, displaySet.getSize() - readPos, segmentSize) != ParseError::None)
+        {
+            // Shouldn't happen after a successful scan; keep whatever is left as it is.
+            pending.push_back({segmentStart, static_cast<uint32_t>(displaySet.getSize() - readPos), {}, 0u, 0u});
+            redefines = true;
+            break;
+        }
+        readPos += segmentSize;
+
+        // An object missing its Last fragment can't be compared, so it's kept as it is.
+        const auto fragment = std::dynamic_pointer_cast<ObjectDefinition>(segment.getData());
+        if (object && (!fragment || fragment->isFirstFragment()))
+        {
+            pending.push_back({objectStart, static_cast<uint32_t>(objectEnd - objectStart), {}, 0u, 0u});
+            redefines = true;
+            object.reset();
+        }
+
+        if (segment.getSegmentType() == SegmentType::PaletteDefinition)
+        {
+            const auto pds = std::dynamic_pointer_cast<PaletteDefinition>(segment.getData());
+            const auto hash = hashBytes(reinterpret_cast<const uint8_t *>(segmentStart) + PALETTE_ENTRIES_OFFSET,
+                                        segmentSize - PALETTE_ENTRIES_OFFSET);
+            const auto cached = this->paletteHashes.find(pds->getId());
+            if (!epochStart && !pcs->getPaletteUpdateFlag() && cached != this->paletteHashes.end() &&
+                cached->second == hash)
+            {
+                pending.push_back({segmentStart, segmentSize, {}, 0u, 0u, true});
+                continue;
+            }
+
+            this->paletteHashes[pds->getId()] = hash;
+            pending.push_back({segmentStart, segmentSize, {}, 0u, 0u});
+            redefines = true;
+        }
+        else if (segment.getSegmentType() == SegmentType::ObjectDefinition)
+        {
+            if (!object)
+            {
+                object = std::make_shared<ObjectDefinition>(*fragment);
+                objectStart = segmentStart;
+                objectPts = segment.getPresentationTimestamp();
+                objectDts = segment.getDecodingTimestamp();
+            }
+            else
+            {
+                object->appendFragment(*fragment);
+            }
+            objectEnd = segmentStart + segmentSize;
+
+            if ((static_cast<uint8_t>(fragment->getSequenceFlag()) & static_cast<uint8_t>(SequenceFlag::Last)) == 0u)
+            {
+                continue;
+            }
+
+            // Only objects starting in this display set and decoding completely can be compared or re-encoded.
+            vector<uint8_t> pixels;
+            const bool comparable = object->isFirstFragment() && StreamOptimizer::decodeObject(*object, pixels);
+            const uint64_t hash = comparable ? hashBytes(pixels.data(), pixels.size()) : 0u;
+            const auto cached = this->objectHashes.find(object->getId());
+            if (!epochStart && comparable && cached != this->objectHashes.end() && cached->second == hash)
+            {
+                pending.push_back({objectStart, static_cast<uint32_t>(objectEnd - objectStart), {}, 0u, 0u, true});
+            }
+            else
+            {
+                if (comparable)
+                {
+                    this->objectHashes[object->getId()] = hash;
+                }
+                else
+                {
+                    this->objectHashes.erase(object->getId());
+                }
+
+                auto fragments = comparable ? StreamOptimizer::reencodeObject(*object, pixels)
+                                            : vector<shared_ptr<ObjectDefinition>>();
+                if (!fragments.empty())
+                {
+                    pending.push_back({nullptr, 0u, std::move(fragments), objectPts, objectDts});
+                    ++this->numReencodedObjects;
+                }
+                else
+                {
+                    pending.push_back({objectStart, static_cast<uint32_t>(objectEnd - objectStart), {}, 0u, 0u});
+                }
+                redefines = true;
+            }
+
+            object.reset();
+        }
+        else
+        {
+            pending.push_back({segmentStart, segmentSize, {}, 0u, 0u});
+        }
+    }
+
+    // An AcquisitionPoint has to define everything it shows, unless it can be turned into a Normal update.
+    const bool keepRedundant = state == CompositionState::AcquisitionPoint && redefines;
+    for (const auto &segment : pending)
+    {
+        if (segment.redundant && !keepRedundant)
+        {
+            if (SegmentType(static_cast<uint8_t>(segment.data[SEGMENT_TYPE_OFFSET])) == SegmentType::PaletteDefinition)
+            {
+                ++this->numDroppedPalettes;
+            }
+            else
+            {
+                ++this->numDroppedObjects;
+            }
+        }
+        else if (!segment.fragments.empty())
+        {
+            for (const auto &fragment : segment.fragments)
+            {
+                writer.write(*fragment, segment.presentationTimestamp, segment.decodingTimestamp);
+            }
+        }
+        else if (segment.data == setStart && state == CompositionState::AcquisitionPoint && !redefines)
+        {
+            // Everything the display set would redefine is already there, so it can be a plain update.
+            vector<char> composition(segment.data, segment.data + segment.size);
+            composition[COMPOSITION_STATE_OFFSET] = static_cast<char>(CompositionState::Normal);
+            writer.write(composition.data(), composition.size());
+            ++this->numConvertedDisplaySets;
+        }
+        else
+        {
+            writer.write(segment.data, segment.size);
+        }
+    }
+}
+
+uint64_t StreamOptimizer::optimize(const char *data, const uint64_t &size, SupWriter &writer)
+{
+    const auto displaySets = DisplaySetInfo::scanAll(data, size);
+    for (const auto &displaySet : displaySets)
+    {
+        this->optimizeDisplaySet(data, displaySet, writer);
+    }
+
+    return displaySets.size();
+}
+
+vector<uint8_t> StreamOptimizer::optimize(const char *data, const uint64_t &size)
+{
+    StreamOptimizer optimizer;
+    SupWriter writer;
+    optimizer.optimize(data, size, writer);
+    return writer.getBuffer();
+}
+
+// =======
+// Getters
+// =======
+
+const uint64_t &StreamOptimizer::getNumDroppedPalettes() const noexcept
+{
+    return this->numDroppedPalettes;
+}
+
+const uint64_t &StreamOptimizer::getNumDroppedObjects() const noexcept
+{
+    return this->numDroppedObjects;
+}
+
+const uint64_t &StreamOptimizer::getNumReencodedObjects() const noexcept
+{
+    return this->numReencodedObjects;
+}
+
+const uint64_t &StreamOptimizer::getNumConvertedDisplaySets() const noexcept
+{
+    return this->numConvertedDisplaySets;
+}
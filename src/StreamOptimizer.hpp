@@ -0,0 +1,125 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#pragma once
+
+#include "DisplaySetInfo.hpp"
+#include "SupWriter.hpp"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace Pgs
+{
+    /**
+     * \brief Rewrites PGS streams into a smaller, equivalent form.
+     *
+     * \details
+     * A decoder keeps every palette and object it receives until the next EpochStart, so palettes and objects that
+     * are sent again unchanged within an epoch can be left out. The optimizer:
+     * - drops PaletteDefinition and ObjectDefinition segments whose content matches what the decoder already holds
+     *   for the same ID in the current epoch,
+     * - turns AcquisitionPoint display sets into Normal ones once nothing is left for them to redefine. An
+     *   AcquisitionPoint that still defines something new stays one and keeps every palette and object it sends, so
+     *   that decoding can start there,
+     * - re-encodes every object it keeps with the shortest RLE codes, whenever that makes it smaller.
+     *
+     * Content is compared by hashing the decoded pixels (plus dimensions) of objects and the entries of palettes,
+     * so a re-sent object is recognized even if it was encoded differently or given a new version. EpochStart
+     * display sets are never stripped, and palettes of palette-only updates are always kept. Objects that can't be
+     * decoded completely are written as they are and never compared. Every segment keeps its original timestamps.
+     */
+    class StreamOptimizer
+    {
+    protected:
+        std::map<uint8_t, uint64_t> paletteHashes; /**< Content hash of each palette held in the current epoch. */
+        std::map<uint16_t, uint64_t> objectHashes; /**< Content hash of each object held in the current epoch. */
+        uint64_t numDroppedPalettes; /**< Number of palette segments left out. */
+        uint64_t numDroppedObjects; /**< Number of objects left out, counting split objects once. */
+        uint64_t numReencodedObjects; /**< Number of objects written with new RLE data. */
+        uint64_t numConvertedDisplaySets; /**< Number of AcquisitionPoint display sets turned into Normal ones. */
+
+        /**
+         * \brief Writes a single display set, leaving out what the decoder already holds.
+         * \param data pointer to the raw PGS data the display set was scanned from
+         * \param displaySet display set to write
+         * \param writer writer receiving the optimized display set
+         */
+        void optimizeDisplaySet(const char *data, const DisplaySetInfo &displaySet, SupWriter &writer);
+
+        /**
+         * \brief Expands a complete object into its dimensions followed by its palette indices.
+         * \param object complete (joined) object to expand
+         * \param pixels set to the big-endian width and height, then one palette index per pixel
+         * \return false if any line of the object is short or missing.
+         */
+        static bool decodeObject(const ObjectDefinition &object, std::vector<uint8_t> &pixels);
+
+        /**
+         * \brief Re-encodes an object with the shortest RLE codes.
+         * \param object complete (joined) object to re-encode
+         * \param pixels expanded object, as set by decodeObject()
+         * \return fragments of the re-encoded object, or none if it isn't smaller than the original.
+         */
+        static std::vector<std::shared_ptr<ObjectDefinition>> reencodeObject(const ObjectDefinition &object,
+                                                                             const std::vector<uint8_t> &pixels);
+    public:
+        StreamOptimizer();
+
+        /**
+         * \brief Optimizes a PGS stream.
+         *
+         * \details
+         * Data that isn't part of a complete display set is left out. The optimizer keeps the palettes and objects
+         * seen so far, so a stream split into several buffers can be optimized by calling this once per buffer,
+         * as long as each buffer holds whole display sets.
+         *
+         * \param data pointer to raw PGS data
+         * \param size number of bytes in the data array
+         * \param writer writer receiving the optimized stream
+         * \return number of display sets written
+         *
+         * \throws WriteError
+         */
+        uint64_t optimize(const char *data, const uint64_t &size, SupWriter &writer);
+
+        /**
+         * \brief Optimizes a PGS stream held in memory.
+         * \param data pointer to raw PGS data
+         * \param size number of bytes in the data array
+         * \return optimized stream
+         */
+        static std::vector<uint8_t> optimize(const char *data, const uint64_t &size);
+
+        // =======
+        // Getters
+        // =======
+
+        [[nodiscard]] const uint64_t &getNumDroppedPalettes() const noexcept;
+
+        [[nodiscard]] const uint64_t &getNumDroppedObjects() const noexcept;
+
+        [[nodiscard]] const uint64_t &getNumReencodedObjects() const noexcept;
+
+        [[nodiscard]] const uint64_t &getNumConvertedDisplaySets() const noexcept;
+    };
+}
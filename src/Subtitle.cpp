@@ -22,7 +22,6 @@
 #include "Subtitle.hpp"
 #include "PgsUtil.hpp"
 
-#include <iostream>
 #include <algorithm>
 
 using namespace Pgs;
@@ -45,8 +44,42 @@ Subtitle::Subtitle()
 
 Subtitle::~Subtitle() = default;
 
-shared_ptr<Subtitle> Subtitle::create(const char *data, const uint32_t &size, uint32_t &readPos)
+shared_ptr<Subtitle> Subtitle::create(const char *data, const uint64_t &size, uint64_t &readPos)
 {
+    ParseReport report;
+    auto subtitle = Subtitle::create(data, size, readPos, report);
+    if (!subtitle)
+    {
+        throw CreateError(report.getDiagnostics().back().getMessage());
+    }
+
+    return subtitle;
+}
+
+shared_ptr<Subtitle> Subtitle::create(const char *data, const uint64_t &size, uint64_t &readPos, ParseReport &report)
+{
+    if (!data)
+    {
+        report.add(ParseDiagnostic(readPos, readPos, SegmentType::PresentationComposition, ParseError::NoData));
+        return nullptr;
+    }
+
+    StreamCursor cursor(data, size, readPos);
+    auto subtitle = Subtitle::create(cursor, report);
+    readPos = cursor.getPosition();
+    return subtitle;
+}
+
+shared_ptr<Subtitle> Subtitle::create(StreamCursor &cursor, ParseReport &report)
+{
+    const uint64_t displaySetOffset = cursor.getPosition();
+    if (!cursor.getData())
+    {
+        report.add(ParseDiagnostic(displaySetOffset, displaySetOffset, SegmentType::PresentationComposition,
+                                   ParseError::NoData));
+        return nullptr;
+    }
+
     /*
      * Continuously read through the data until either an End Segment is imported or the end of the data is reached.
      *
@@ -55,29 +88,17 @@ shared_ptr<Subtitle> Subtitle::create(const char *data, const uint32_t &size, ui
      */
     auto subtitle = std::make_shared<Subtitle>(Subtitle());
     bool endReached = false;
-    uint32_t segmentEnd;
-    char buff[2];
-    while(readPos < size && !endReached)
-    {
-        // Locate start of segment
-        buff[0] = data[readPos];
-        buff[1] = data[readPos+1];
-        // The buffer must be used to make sure the readPos doesn't get messed up.
-        if (buff[0] != 'P' && buff[1] != 'G')
-        {
-            readPos += 1;
-            continue;
-        }
-
-        // Locate end of segment.
-        segmentEnd = readPos + Segment::MIN_BYTE_SIZE + Segment::getSegmentSize(data+readPos, size-readPos);
-        if (segmentEnd > size)
+    while(!endReached && cursor.seekNextSegment())
+    {
+        Segment segment;
+        uint32_t readSize = 0u;
+        const auto error = segment.tryImport(cursor.getCurrent(), cursor.getRemaining(), readSize);
+        if (error != ParseError::None)
         {
-            throw CreateError("Subtitle::create: Segment size larger than remaining data.");
+            report.add(ParseDiagnostic(displaySetOffset, cursor.getPosition(), segment.getSegmentType(), error));
+            return nullptr;
         }
-
-        Segment segment;
-        readPos += segment.import(data + readPos, segmentEnd - readPos);
+        cursor.advance(readSize);
 
         const auto segType = subtitle->import(segment);
         endReached = segType == SegmentType::EndOfDisplaySet;
@@ -85,42 +106,56 @@ shared_ptr<Subtitle> Subtitle::create(const char *data, const uint32_t &size, ui
 
     if (!endReached)
     {
-        throw CreateError("Subtitle::create: Failed to create complete Subtitle.");
+        report.add(ParseDiagnostic(displaySetOffset, cursor.getPosition(), SegmentType::EndOfDisplaySet,
+                                   ParseError::IncompleteDisplaySet));
+        return nullptr;
     }
 
     return subtitle;
 }
 
-shared_ptr<Subtitle> Subtitle::create(const vector<char> &data, uint32_t &readPos)
+shared_ptr<Subtitle> Subtitle::create(const vector<char> &data, uint64_t &readPos)
 {
     return Subtitle::create(data.data(), data.size(), readPos);
 }
 
-vector<shared_ptr<Subtitle>> Subtitle::createAll(const char *data, const uint32_t &size)
+vector<shared_ptr<Subtitle>> Subtitle::createAll(const char *data, const uint64_t &size)
 {
     if (data == nullptr || size == 0)
     {
         throw CreateError("Subtitle::createSubtitles: no data provided.");
     }
 
-    uint32_t readPos = 0u;
+    ParseReport report;
+    return Subtitle::createAll(data, size, report);
+}
+
+vector<shared_ptr<Subtitle>> Subtitle::createAll(const char *data, const uint64_t &size, ParseReport &report)
+{
     auto subtitles = vector<shared_ptr<Subtitle>>();
-    uint32_t subtitleSize, readSize;
-    uint16_t itr = 0;
-    while(readPos < size-1)
+    if (data == nullptr || size == 0)
+    {
+        report.add(ParseDiagnostic(0u, 0u, SegmentType::PresentationComposition, ParseError::NoData));
+        return subtitles;
+    }
+
+    StreamCursor cursor(data, size);
+    while(cursor.canRead(2u))
     {
-        subtitleSize = Subtitle::getSubtitleSize(data+readPos, size - readPos);
-        try
+        const uint64_t subtitleSize = Subtitle::getSubtitleSize(cursor.getCurrent(), cursor.getRemaining());
+        if (subtitleSize == 0)
         {
-            readSize = 0;
-            subtitles.push_back(Subtitle::create(data+readPos, subtitleSize, readSize));
-            readPos += readSize;
+            break;
         }
-        catch (const std::runtime_error& err)
+
+        // Damaged display sets are skipped. The next call to getSubtitleSize resynchronizes on a valid segment.
+        auto displaySet = cursor.limit(subtitleSize);
+        auto subtitle = Subtitle::create(displaySet, report);
+        if (subtitle)
         {
-            std::cerr << err.what() << " " << std::to_string(itr) << "\n";
+            subtitles.push_back(subtitle);
         }
-        ++itr;
+        cursor.advance(subtitleSize);
     }
 
     return subtitles;
@@ -178,17 +213,29 @@ void Subtitle::importOds(const shared_ptr<SegmentData> &segmentData)
     const auto ods = std::dynamic_pointer_cast<ObjectDefinition>(segmentData);
     switch (ods->getSequenceFlag())
     {
+        case SequenceFlag::Middle:
         case SequenceFlag::Last:
+            // Everything after the first fragment is collected in the second slot.
             this->numObjectDefinitions = 2u;
-            this->objectDefinitions[1] = ods;
+            if (this->objectDefinitions[1] && this->objectDefinitions[1]->getId() == ods->getId() &&
+                this->objectDefinitions[1]->getSequenceFlag() == SequenceFlag::Middle)
+            {
+                this->objectDefinitions[1]->appendFragment(*ods);
+            }
+            else
+            {
+                this->objectDefinitions[1] = ods;
+            }
             break;
         case SequenceFlag::First:
             this->numObjectDefinitions = 2u;
             this->objectDefinitions[0] = ods;
+            this->objectDefinitions[1] = nullptr;
             break;
         case SequenceFlag::Only:
             this->numObjectDefinitions = 1u;
             this->objectDefinitions[0] = ods;
+            this->objectDefinitions[1] = nullptr;
             break;
         default:
             this->numObjectDefinitions = 0u;
@@ -205,33 +252,22 @@ void Subtitle::importEnd(const Segment &segment)
 // Getters
 // =======
 
-uint32_t Subtitle::getSubtitleSize(const char *data, const uint32_t &size)
+uint64_t Subtitle::getSubtitleSize(const char *data, const uint64_t &size)
 {
-    const auto *byteData = reinterpret_cast<const uint8_t *>(data);
-
-    uint32_t readPos = 0u;
+    uint64_t readPos = 0u;
     SegmentType segmentType = SegmentType::PresentationComposition;
-    char buff[2];
     while (readPos < size && segmentType != SegmentType::EndOfDisplaySet)
     {
         // Find start of segment
-        buff[0] = byteData[readPos];
-        buff[1] = byteData[readPos+1];
-        if (buff[0] != 'P' && buff[1] != 'G')
+        readPos = Segment::findNext(data, size, readPos);
+        if (readPos >= size)
         {
-            ++readPos;
-            continue;
+            break;
         }
 
-        // Get segment type
-        readPos += 10;
-        segmentType = SegmentType(byteData[readPos]);
-        ++readPos;
-
-        // Get segment size and skip to end of segment.
-        const uint16_t segmentSize = read2Bytes(reinterpret_cast<const uint8_t *>(byteData),
-                                                reinterpret_cast<uint16_t &>(readPos));
-        readPos += segmentSize;
+        // Get segment type and skip to end of segment. findNext only returns segments that fit in the data.
+        segmentType = SegmentType(static_cast<uint8_t>(data[readPos + 10]));
+        readPos += Segment::MIN_BYTE_SIZE + Segment::getSegmentSize(data + readPos, size - readPos);
         // Repeat until the end segment is found or out of data.
     }
 
@@ -293,52 +329,332 @@ bool Subtitle::containsImage() const noexcept
     return this->numObjectDefinitions > 0;
 }
 
-vector<vector<array<uint8_t, 4>>> Subtitle::getImage(const ColorSpace &colorSpace) const
+vector<vector<uint8_t>> Subtitle::decodeImage() const
 {
-    if (this->numObjectDefinitions == 0)
+    if (this->numObjectDefinitions == 0 || !this->objectDefinitions[0])
     {
         throw std::runtime_error("Subtitle object does not contain any image data.");
     }
 
-    // Load decompressed data into vector.
-    auto rawData = vector<vector<uint8_t>>();
-    auto tmp = this->objectDefinitions[0]->getDecodedObjectData();
-    std::move(tmp.begin(), tmp.end(), std::back_inserter(rawData));
+    /*
+     * Fragments after the first one continue the same RLE data and don't have dimensions of their own, so the data is
+     * joined before decoding.
+     */
+    const auto &firstFragment = this->objectDefinitions[0];
+    if (this->objectDefinitions[1] != nullptr)
+    {
+        return ObjectDefinition::decodeObjectData(this->getEncodedImageData(), firstFragment->getWidth(),
+                                                  firstFragment->getHeight());
+    }
+
+    return firstFragment->getDecodedObjectData();
+}
+
+uint64_t Subtitle::getContentHash() const
+{
+    if (this->numObjectDefinitions == 0 || !this->objectDefinitions[0])
+    {
+        return 0u;
+    }
+
+    const auto &firstFragment = this->objectDefinitions[0];
+    if (this->objectDefinitions[1] == nullptr)
+    {
+        return firstFragment->getContentHash();
+    }
+
+    const auto encodedData = this->getEncodedImageData();
+    return hashBytes(encodedData.data(), encodedData.size(),
+                     static_cast<uint64_t>(firstFragment->getWidth()) << 16u | firstFragment->getHeight());
+}
+
+BoundingBox Subtitle::getBoundingBox() const
+{
+    if (this->numObjectDefinitions == 0 || !this->objectDefinitions[0])
+    {
+        return {0u, 0u, 0u, 0u};
+    }
+
+    array<bool, 256> transparent{};
+    transparent.fill(true);
+    if (this->paletteDefinition)
+    {
+        for (const auto &entry : this->paletteDefinition->getEntries())
+        {
+            transparent[entry.first] = entry.second->getAlpha() == 0u;
+        }
+    }
+
+    const auto &firstFragment = this->objectDefinitions[0];
+    if (this->objectDefinitions[1] == nullptr)
+    {
+        return firstFragment->getBoundingBox(transparent);
+    }
+    return ObjectDefinition::findBoundingBox(this->getEncodedImageData(), firstFragment->getWidth(),
+                                             firstFragment->getHeight(), transparent);
+}
+
+vector<Span> Subtitle::getTextSpans() const
+{
+    if (this->numObjectDefinitions == 0 || !this->objectDefinitions[0])
+    {
+        return {};
+    }
+
+    const auto &firstFragment = this->objectDefinitions[0];
+    const auto encodedData = this->getEncodedImageData();
+    const auto &width = firstFragment->getWidth();
+    const auto &height = firstFragment->getHeight();
+
+    array<uint64_t, 256> indexCounts{};
+    ObjectDefinition::forEachRun(encodedData, width, height, [&](const uint16_t &, const uint16_t &,
+                                                                 const uint16_t &length, const uint8_t &color) {
+        indexCounts[color] += length;
+    });
+
+    const auto maskTable = this->getMaskTable(indexCounts, MaskFormat::Binary1);
+    array<bool, 256> ink{};
+    for (size_t i = 0; i < ink.size(); ++i)
+    {
+        ink[i] = maskTable[i] != 0u;
+    }
+    return ObjectDefinition::findSpans(encodedData, width, height, ink);
+}
+
+vector<uint8_t> Subtitle::getEncodedImageData() const
+{
+    if (this->numObjectDefinitions == 0 || !this->objectDefinitions[0])
+    {
+        return {};
+    }
+
+    auto encodedData = this->objectDefinitions[0]->getEncodedObjectData();
     if (this->objectDefinitions[1] != nullptr)
     {
-        tmp = this->objectDefinitions[1]->getDecodedObjectData();
-        std::move(tmp.begin(), tmp.end(), std::back_inserter(rawData));
+        const auto &remainingData = this->objectDefinitions[1]->getEncodedObjectData();
+        encodedData.insert(encodedData.end(), remainingData.begin(), remainingData.end());
+    }
+    return encodedData;
+}
+
+array<array<uint8_t, 4>, 256> Subtitle::getColorTable(const ColorSpace &colorSpace) const
+{
+    array<array<uint8_t, 4>, 256> colorTable{};
+    if (!this->paletteDefinition)
+    {
+        return colorTable;
+    }
+
+    for (const auto &entry : this->paletteDefinition->getEntries())
+    {
+        switch (colorSpace)
+        {
+            case ColorSpace::RGBA:
+                colorTable[entry.first] = entry.second->getRGBA();
+                break;
+            case ColorSpace::YCrCb:
+                colorTable[entry.first] = entry.second->getYCrCbA();
+                break;
+        }
     }
 
+    return colorTable;
+}
+
+vector<vector<array<uint8_t, 4>>> Subtitle::getImage(const ColorSpace &colorSpace) const
+{
+    const auto rawData = this->decodeImage();
+    const auto colorTable = this->getColorTable(colorSpace);
+
     auto imageData = vector<vector<array<uint8_t, 4>>>();
     imageData.reserve(rawData.size());
 
     // convert the values line by line.
-    const auto &paletteEntries = this->paletteDefinition->getEntries();
     for (const auto &rawLine : rawData)
     {
         vector<array<uint8_t, 4>> colorLine;
         colorLine.reserve(rawLine.size());
         for (const uint8_t &pixel : rawLine)
         {
-            // Check if the palette exists
-            array<uint8_t, 4> color = {0, 0, 0, 0};
-            if (paletteEntries.find(pixel) != paletteEntries.end())
+            colorLine.push_back(colorTable[pixel]);
+        }
+        imageData.push_back(colorLine);
+    }
+
+    return imageData;
+}
+
+array<uint8_t, 256> Subtitle::getMaskTable(const array<uint64_t, 256> &indexCounts, const MaskFormat &format) const
+{
+    array<uint8_t, 256> inks{};
+    array<bool, 256> visible{};
+    if (this->paletteDefinition)
+    {
+        for (const auto &entry : this->paletteDefinition->getEntries())
+        {
+            inks[entry.first] = static_cast<uint8_t>(entry.second->getY() * entry.second->getAlpha() / 255u);
+            visible[entry.first] = entry.second->getAlpha() > 0u;
+        }
+    }
+
+    array<uint64_t, 256> histogram{};
+    uint8_t minInk = UINT8_MAX, maxInk = 0u;
+    uint64_t numPixels = 0u;
+    for (size_t i = 0; i < 256u; ++i)
+    {
+        if (visible[i] && indexCounts[i] > 0u)
+        {
+            histogram[inks[i]] += indexCounts[i];
+            numPixels += indexCounts[i];
+            minInk = std::min(minInk, inks[i]);
+            maxInk = std::max(maxInk, inks[i]);
+        }
+    }
+
+    array<uint8_t, 256> table{};
+    const uint8_t background = format == MaskFormat::Binary1 ? 0u : 255u;
+    const uint8_t text = format == MaskFormat::Binary1 ? 1u : 0u;
+    table.fill(background);
+    if (numPixels == 0u)
+    {
+        return table;
+    }
+
+    if (format == MaskFormat::Gray8)
+    {
+        for (size_t i = 0; i < 256u; ++i)
+        {
+            if (!visible[i] || inks[i] <= minInk)
             {
-                // Color in palette
-                switch (colorSpace)
-                {
-                    case ColorSpace::RGBA:
-                        color = paletteEntries.at(pixel)->getRGBA();
-                        break;
-                    case ColorSpace::YCrCb:
-                        color = paletteEntries.at(pixel)->getYCrCbA();
-                        break;
-                }
+                continue;
             }
-            colorLine.push_back(color);
+            table[i] = static_cast<uint8_t>(255u - (inks[i] >= maxInk ? 255u :
+                                                    (inks[i] - minInk) * 255u / (maxInk - minInk)));
+        }
+        // Images drawn in a single shade have no outline to drop.
+        if (minInk == maxInk)
+        {
+            for (size_t i = 0; i < 256u; ++i)
+            {
+                table[i] = visible[i] && inks[i] == minInk ? 0u : table[i];
+            }
+        }
+        return table;
+    }
+
+    // Otsu's method: the threshold maximizing the variance between the outline (<= threshold) and fill classes.
+    uint8_t threshold = 0u;
+    if (maxInk - minInk < 32)
+    {
+        threshold = static_cast<uint8_t>(minInk / 2u);
+    }
+    else
+    {
+        uint64_t inkSum = 0u;
+        for (size_t i = 0; i < 256u; ++i)
+        {
+            inkSum += i * histogram[i];
+        }
+
+        uint64_t lowCount = 0u, lowSum = 0u;
+        double bestVariance = -1.0;
+        for (size_t t = minInk; t < maxInk; ++t)
+        {
+            lowCount += histogram[t];
+            lowSum += t * histogram[t];
+            const uint64_t highCount = numPixels - lowCount;
+            if (lowCount == 0u || highCount == 0u)
+            {
+                continue;
+            }
+
+            const double meanDifference = static_cast<double>(lowSum) / lowCount -
+                                          static_cast<double>(inkSum - lowSum) / highCount;
+            const double variance = static_cast<double>(lowCount) * highCount * meanDifference * meanDifference;
+            if (variance > bestVariance)
+            {
+                bestVariance = variance;
+                threshold = static_cast<uint8_t>(t);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < 256u; ++i)
+    {
+        if (visible[i] && inks[i] > threshold)
+        {
+            table[i] = text;
+        }
+    }
+    return table;
+}
+
+vector<uint8_t> Subtitle::getMask(const MaskFormat &format, uint16_t &width, uint16_t &height) const
+{
+    const auto rawData = this->decodeImage();
+    array<uint64_t, 256> indexCounts{};
+    for (const auto &line : rawData)
+    {
+        for (const auto &index : line)
+        {
+            ++indexCounts[index];
+        }
+    }
+    const auto maskTable = this->getMaskTable(indexCounts, format);
+
+    width = this->objectDefinitions[0]->getWidth();
+    height = this->objectDefinitions[0]->getHeight();
+    const size_t numLines = std::min<size_t>(rawData.size(), height);
+
+    if (format == MaskFormat::Binary1)
+    {
+        const size_t stride = (width + 7u) / 8u;
+        vector<uint8_t> mask(stride * height, 0u);
+        for (size_t y = 0; y < numLines; ++y)
+        {
+            uint8_t *out = mask.data() + y * stride;
+            const size_t lineWidth = std::min<size_t>(rawData[y].size(), width);
+            for (size_t x = 0; x < lineWidth; ++x)
+            {
+                out[x / 8u] |= static_cast<uint8_t>(maskTable[rawData[y][x]] << (7u - x % 8u));
+            }
+        }
+        return mask;
+    }
+
+    // Lines that decoded short are left as background, like in getImageData.
+    vector<uint8_t> mask(static_cast<size_t>(width) * height, 255u);
+    for (size_t y = 0; y < numLines; ++y)
+    {
+        uint8_t *out = mask.data() + y * width;
+        const size_t lineWidth = std::min<size_t>(rawData[y].size(), width);
+        for (size_t x = 0; x < lineWidth; ++x)
+        {
+            out[x] = maskTable[rawData[y][x]];
+        }
+    }
+    return mask;
+}
+
+vector<uint8_t> Subtitle::getImageData(const ColorSpace &colorSpace, uint16_t &width, uint16_t &height) const
+{
+    const auto rawData = this->decodeImage();
+    const auto colorTable = this->getColorTable(colorSpace);
+
+    width = this->objectDefinitions[0]->getWidth();
+    height = this->objectDefinitions[0]->getHeight();
+
+    // Lines that decoded short are left transparent rather than shifting the rest of the image.
+    vector<uint8_t> imageData(static_cast<size_t>(width) * height * 4u, 0u);
+    const size_t numLines = std::min<size_t>(rawData.size(), height);
+    for (size_t y = 0; y < numLines; ++y)
+    {
+        uint8_t *out = imageData.data() + y * width * 4u;
+        const size_t lineWidth = std::min<size_t>(rawData[y].size(), width);
+        for (size_t x = 0; x < lineWidth; ++x)
+        {
+            std::copy(colorTable[rawData[y][x]].begin(), colorTable[rawData[y][x]].end(), out + x * 4u);
         }
-        imageData.push_back(colorLine);
     }
 
     return imageData;
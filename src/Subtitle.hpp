@@ -26,6 +26,8 @@
 #include "WindowDefinition.hpp"
 #include "PaletteDefinition.hpp"
 #include "ObjectDefinition.hpp"
+#include "ParseReport.hpp"
+#include "StreamCursor.hpp"
 
 #include <cstdint>
 #include <array>
@@ -53,6 +55,16 @@ namespace Pgs
         YCrCb
     };
 
+    /**
+     * \brief Single channel image formats produced by Subtitle::getMask.
+     */
+    enum class MaskFormat
+    {
+        Gray8, /**< 8 bits per pixel with the text fill dark on a white background. */
+        Binary8, /**< 8 bits per pixel, 0 for text fill pixels and 255 for everything else. */
+        Binary1 /**< 1 bit per pixel, most significant bit first and lines padded to whole bytes. Set bits are text. */
+    };
+
     /**
      * \brief The Subtitle class takes the data from imported PGS segments, copies relevant data to its own instance,
      * and retains pointers to the imported segments so that a user may access less commonly-used data.
@@ -151,7 +163,29 @@ namespace Pgs
          * \param size number of bytes in provided array
          * \return size of subtitle in bytes.
          */
-        static uint32_t getSubtitleSize(const char *data, const uint32_t &size);
+        static uint64_t getSubtitleSize(const char *data, const uint64_t &size);
+
+        /**
+         * \brief Builds a lookup table holding the color of every palette index.
+         * \param colorSpace ColorSpace to use when converting from PaletteEntry.
+         * \return table with one color per palette index. Indices missing from the palette are fully transparent.
+         */
+        [[nodiscard]] array<array<uint8_t, 4>, 256> getColorTable(const ColorSpace &colorSpace) const;
+
+        /**
+         * \brief Builds a lookup table holding the mask value of every palette index.
+         *
+         * \details
+         * Every palette entry gets an ink value of its luma scaled by its alpha. The fill/outline threshold is found
+         * with Otsu's method over the ink histogram of the visible pixels, and the brighter class is taken as the
+         * fill. For Gray8, the ink of the used entries is stretched over the full range instead.
+         *
+         * \param indexCounts number of pixels of every palette index in the image
+         * \param format mask format. Binary1 tables hold 1 for text and 0 for everything else.
+         * \return table with one mask value per palette index
+         */
+        [[nodiscard]] array<uint8_t, 256> getMaskTable(const array<uint64_t, 256> &indexCounts,
+                                                      const MaskFormat &format) const;
     public:
         /**
          * \brief Creates a new instance of Subtitle.
@@ -169,7 +203,38 @@ namespace Pgs
          *
          * \throws CreateError
          */
-        static shared_ptr<Subtitle> create(const char *data, const uint32_t &size, uint32_t &readPos);
+        static shared_ptr<Subtitle> create(const char *data, const uint64_t &size, uint64_t &readPos);
+
+        /**
+         * \brief Generates a shared pointer to a new Subtitle instance without throwing on malformed data.
+         *
+         * \details
+         * If the display set can't be imported, a diagnostic is added to the report and a null pointer is returned.
+         * Offsets in the diagnostic are relative to data, so passing the start of the whole stream along with a
+         * readPos inside of it gives stream offsets.
+         *
+         * \param data pointer to raw data array
+         * \param size size of the data array
+         * \param readPos reference to position to start reading the data array from
+         * \param report report receiving a diagnostic on failure
+         * \return shared pointer to new Subtitle instance, or nullptr on failure.
+         */
+        static shared_ptr<Subtitle> create(const char *data, const uint64_t &size, uint64_t &readPos,
+                                           ParseReport &report);
+
+        /**
+         * \brief Generates a shared pointer to a new Subtitle instance from the display set at the cursor without
+         * throwing on malformed data.
+         *
+         * \details
+         * On success, the cursor is moved past the End segment of the display set. On failure, a diagnostic is added
+         * to the report, a null pointer is returned, and the cursor is left at the segment that failed to import.
+         *
+         * \param cursor cursor positioned at or before the start of the display set
+         * \param report report receiving a diagnostic on failure
+         * \return shared pointer to new Subtitle instance, or nullptr on failure.
+         */
+        static shared_ptr<Subtitle> create(StreamCursor &cursor, ParseReport &report);
 
         /**
          * \brief Generates a shared pointer to a new Subtitle instance and imports the provided data.
@@ -179,7 +244,7 @@ namespace Pgs
          *
          * \throws CreateError
          */
-        [[maybe_unused]] static shared_ptr<Subtitle> create(const std::vector<char> &data, uint32_t &readPos);
+        [[maybe_unused]] static shared_ptr<Subtitle> create(const std::vector<char> &data, uint64_t &readPos);
 
         /**
          * \brief Creates a vector of shared pointer to the Subtitle instance created from the provided data.
@@ -187,7 +252,21 @@ namespace Pgs
          * \param size number of bytes in raw data array
          * \return vector of shared pointers to newly created Subtitle instances
          */
-        static vector<shared_ptr<Subtitle>> createAll(const char *data, const uint32_t &size);
+        static vector<shared_ptr<Subtitle>> createAll(const char *data, const uint64_t &size);
+
+        /**
+         * \brief Creates a vector of shared pointer to the Subtitle instance created from the provided data without
+         * throwing on malformed data.
+         *
+         * \details
+         * Display sets that fail to import are skipped and described in the report.
+         *
+         * \param data pointer to raw data array.
+         * \param size number of bytes in raw data array
+         * \param report report receiving one diagnostic per skipped display set
+         * \return vector of shared pointers to newly created Subtitle instances
+         */
+        static vector<shared_ptr<Subtitle>> createAll(const char *data, const uint64_t &size, ParseReport &report);
 
         /**
          * \brief Imports any provided Segment into the Subtitle instance.
@@ -282,6 +361,88 @@ namespace Pgs
          */
         [[nodiscard]] vector<vector<array<uint8_t, 4>>> getImage(const ColorSpace &colorSpace) const;
 
+        /**
+         * \brief Decodes the palette indices of the image, joining split objects first.
+         *
+         * \details
+         * Useful when the colors are going to be remapped anyway, e.g. when reducing the palette.
+         *
+         * \return 2D vector of palette indices
+         *
+         * \throws std::runtime_error if the Subtitle doesn't contain an image.
+         */
+        [[nodiscard]] vector<vector<uint8_t>> decodeImage() const;
+
+        /**
+         * \brief Computes a hash identifying the image of the Subtitle without decoding it.
+         *
+         * \details
+         * Same as ObjectDefinition::getContentHash, with split objects joined first. Only the palette indices are
+         * covered, so the same image shown with different palettes gets the same hash.
+         *
+         * \return content hash, or 0 if the Subtitle doesn't contain an image.
+         */
+        [[nodiscard]] uint64_t getContentHash() const;
+
+        /**
+         * \brief Finds the tight bounding box of the visible pixels of the image without decoding it.
+         *
+         * \details
+         * Palette indices that are fully transparent or missing from the palette count as transparent. The box is
+         * relative to the image; add the position of its composition object (see getPcs()) to place it on screen.
+         *
+         * \return bounding box, empty if the Subtitle doesn't contain an image or it's fully transparent.
+         */
+        [[nodiscard]] BoundingBox getBoundingBox() const;
+
+        /**
+         * \brief Collects the runs of text fill pixels of the image without decoding it.
+         *
+         * \details
+         * Text fill pixels are the ones set in the MaskFormat::Binary1 mask, so outlines and the background are left
+         * out. The spans are the input of TextSegmenter.
+         *
+         * \return spans sorted by line, then by column, or an empty vector if the Subtitle doesn't contain an image.
+         */
+        [[nodiscard]] vector<Span> getTextSpans() const;
+
+        /**
+         * \brief Retrieves the compressed image data, joining split objects.
+         * \return compressed image data, or an empty vector if the Subtitle doesn't contain an image.
+         */
+        [[nodiscard]] vector<uint8_t> getEncodedImageData() const;
+
+        /**
+         * \brief Generates raw, decompressed image data in a single interleaved buffer.
+         *
+         * \details
+         * Same as getImage, but the colorspace values are stored row by row in one buffer holding 4 bytes per pixel,
+         * which is what most image encoders expect.
+         *
+         * \param colorSpace ColorSpace to use when converting from PaletteEntry.
+         * \param width set to the image width in pixels
+         * \param height set to the image height in pixels
+         * \return buffer of width * height * 4 bytes
+         */
+        [[nodiscard]] vector<uint8_t> getImageData(const ColorSpace &colorSpace, uint16_t &width,
+                                                   uint16_t &height) const;
+
+        /**
+         * \brief Generates a single channel mask of the image, for OCR.
+         *
+         * \details
+         * Mask values are looked up straight from the palette indices, so no color image is built. The text fill is
+         * told apart from its outline by a threshold computed from the palette entries the image uses.
+         *
+         * \param format mask format
+         * \param width set to the image width in pixels
+         * \param height set to the image height in pixels
+         * \return buffer of width * height bytes, or (width + 7) / 8 * height bytes for MaskFormat::Binary1
+         *
+         * \throws std::runtime_error if the Subtitle doesn't contain an image.
+         */
+        [[nodiscard]] vector<uint8_t> getMask(const MaskFormat &format, uint16_t &width, uint16_t &height) const;
+
         // ==================
         // Operator Overloads
         // ==================
@@ -0,0 +1,328 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#include "SubtitleEvent.hpp"
+
+#include <map>
+
+using std::shared_ptr;
+using std::vector;
+
+namespace Pgs
+{
+    /**
+     * \brief Tracks which objects are on screen while walking the display sets of a stream.
+     *
+     * \details
+     * Only a couple of objects can be on screen at a time, so the open events are kept in a short vector that is
+     * searched linearly. Each display set is visited once, making the whole pass linear in the stream length.
+     */
+    class EventBuilder
+    {
+    protected:
+        struct ObjectState
+        {
+            uint8_t version;
+            uint16_t width;
+            uint16_t height;
+        };
+
+        vector<SubtitleEvent> events;
+        vector<size_t> openEvents;
+        std::map<uint16_t, ObjectState> objects;
+
+        void close(const size_t &eventIndex, const uint32_t &time, const uint32_t &index)
+        {
+            this->events[eventIndex].endTime = time;
+            this->events[eventIndex].endIndex = index;
+        }
+
+    public:
+        /**
+         * \brief Records an object definition carried by the display set that is about to be added.
+         */
+        void defineObject(const ObjectDefinition &ods)
+        {
+            auto &state = this->objects[ods.getId()];
+            state.version = ods.getVersion();
+            if (ods.isFirstFragment())
+            {
+                state.width = ods.getWidth();
+                state.height = ods.getHeight();
+            }
+        }
+
+        /**
+         * \brief Advances the on-screen state to the provided display set.
+         * \param index index of the display set in the stream
+         * \param time presentation time of the display set
+         * \param pcs composition of the display set
+         */
+        void addDisplaySet(const uint32_t &index, const uint32_t &time, const PresentationComposition &pcs)
+        {
+            const auto &compositionObjects = pcs.getCompositionObjects();
+
+            // A new epoch wipes the screen and the object buffer.
+            if (pcs.getCompositionState() == CompositionState::EpochStart)
+            {
+                for (const auto &eventIndex : this->openEvents)
+                {
+                    this->close(eventIndex, time, index);
+                }
+                this->openEvents.clear();
+            }
+
+            // Close anything that was removed, moved, or redefined.
+            auto stillOpen = vector<size_t>();
+            for (const auto &eventIndex : this->openEvents)
+            {
+                const auto &event = this->events[eventIndex];
+                bool kept = false;
+                for (const auto &object : compositionObjects)
+                {
+                    if (object->getObjectID() == event.objectID && object->getWindowID() == event.windowID &&
+                        object->getHPos() == event.hPos && object->getVPos() == event.vPos)
+                    {
+                        const auto state = this->objects.find(event.objectID);
+                        kept = state == this->objects.end() || state->second.version == event.objectVersion;
+                        break;
+                    }
+                }
+
+                if (kept)
+                {
+                    stillOpen.push_back(eventIndex);
+                }
+                else
+                {
+                    this->close(eventIndex, time, index);
+                }
+            }
+            this->openEvents = stillOpen;
+
+            // Open events for anything new.
+            for (const auto &object : compositionObjects)
+            {
+                bool alreadyOpen = false;
+                for (const auto &eventIndex : this->openEvents)
+                {
+                    const auto &event = this->events[eventIndex];
+                    if (event.objectID == object->getObjectID() && event.windowID == object->getWindowID())
+                    {
+                        alreadyOpen = true;
+                        break;
+                    }
+                }
+                if (alreadyOpen)
+                {
+                    continue;
+                }
+
+                SubtitleEvent event;
+                event.startTime = time;
+                event.startIndex = index;
+                event.compositionNumber = pcs.getCompositionNumber();
+                event.objectID = object->getObjectID();
+                event.windowID = object->getWindowID();
+                event.forcedFlag = object->getForcedFlag();
+                event.hPos = object->getHPos();
+                event.vPos = object->getVPos();
+                const auto state = this->objects.find(event.objectID);
+                if (state != this->objects.end())
+                {
+                    event.objectVersion = state->second.version;
+                    event.width = state->second.width;
+                    event.height = state->second.height;
+                }
+
+                this->openEvents.push_back(this->events.size());
+                this->events.push_back(event);
+            }
+        }
+
+        vector<SubtitleEvent> &getEvents()
+        {
+            return this->events;
+        }
+    };
+}
+
+using namespace Pgs;
+
+SubtitleEvent::SubtitleEvent()
+{
+    this->startTime = 0u;
+    this->endTime = SubtitleEvent::OPEN_END;
+    this->startIndex = 0u;
+    this->endIndex = SubtitleEvent::NO_INDEX;
+    this->compositionNumber = 0u;
+    this->objectID = 0u;
+    this->objectVersion = 0u;
+    this->windowID = 0u;
+    this->forcedFlag = false;
+    this->hPos = 0u;
+    this->vPos = 0u;
+    this->width = 0u;
+    this->height = 0u;
+}
+
+vector<SubtitleEvent> SubtitleEvent::deriveAll(const vector<DisplaySetInfo> &displaySets)
+{
+    EventBuilder builder;
+    for (uint32_t i = 0u; i < displaySets.size(); ++i)
+    {
+        const auto &displaySet = displaySets[i];
+        if (!displaySet.getPcs())
+        {
+            continue;
+        }
+
+        for (const auto &ods : displaySet.getObjectDefinitions())
+        {
+            builder.defineObject(*ods);
+        }
+        builder.addDisplaySet(i, displaySet.getPresentationTime(), *displaySet.getPcs());
+    }
+
+    return std::move(builder.getEvents());
+}
+
+vector<SubtitleEvent> SubtitleEvent::deriveAll(const vector<shared_ptr<Subtitle>> &subtitles)
+{
+    EventBuilder builder;
+    for (uint32_t i = 0u; i < subtitles.size(); ++i)
+    {
+        const auto &subtitle = subtitles[i];
+        if (!subtitle || !subtitle->getPcs())
+        {
+            continue;
+        }
+
+        for (uint8_t j = 0u; j < 2; ++j)
+        {
+            const auto ods = subtitle->getOds(j);
+            if (ods)
+            {
+                builder.defineObject(*ods);
+            }
+        }
+        builder.addDisplaySet(i, subtitle->getPresentationTime(), *subtitle->getPcs());
+    }
+
+    return std::move(builder.getEvents());
+}
+
+// =======
+// Getters
+// =======
+
+const uint32_t &SubtitleEvent::getStartTime() const noexcept
+{
+    return this->startTime;
+}
+
+uint32_t SubtitleEvent::getStartTimeMs() const noexcept
+{
+    return this->startTime / 90;
+}
+
+const uint32_t &SubtitleEvent::getEndTime() const noexcept
+{
+    return this->endTime;
+}
+
+uint32_t SubtitleEvent::getEndTimeMs() const noexcept
+{
+    return this->endTime / 90;
+}
+
+uint32_t SubtitleEvent::getDuration() const noexcept
+{
+    if (this->isOpen())
+    {
+        return 0u;
+    }
+    return this->endTime - this->startTime;
+}
+
+uint32_t SubtitleEvent::getDurationMs() const noexcept
+{
+    return this->getDuration() / 90;
+}
+
+bool SubtitleEvent::isOpen() const noexcept
+{
+    return this->endIndex == SubtitleEvent::NO_INDEX;
+}
+
+const uint32_t &SubtitleEvent::getStartIndex() const noexcept
+{
+    return this->startIndex;
+}
+
+const uint32_t &SubtitleEvent::getEndIndex() const noexcept
+{
+    return this->endIndex;
+}
+
+const uint16_t &SubtitleEvent::getCompositionNumber() const noexcept
+{
+    return this->compositionNumber;
+}
+
+const uint16_t &SubtitleEvent::getObjectID() const noexcept
+{
+    return this->objectID;
+}
+
+const uint8_t &SubtitleEvent::getObjectVersion() const noexcept
+{
+    return this->objectVersion;
+}
+
+const uint8_t &SubtitleEvent::getWindowID() const noexcept
+{
+    return this->windowID;
+}
+
+const bool &SubtitleEvent::getForcedFlag() const noexcept
+{
+    return this->forcedFlag;
+}
+
+const uint16_t &SubtitleEvent::getHPos() const noexcept
+{
+    return this->hPos;
+}
+
+const uint16_t &SubtitleEvent::getVPos() const noexcept
+{
+    return this->vPos;
+}
+
+const uint16_t &SubtitleEvent::getWidth() const noexcept
+{
+    return this->width;
+}
+
+const uint16_t &SubtitleEvent::getHeight() const noexcept
+{
+    return this->height;
+}
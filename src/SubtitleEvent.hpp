@@ -0,0 +1,140 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#pragma once
+
+#include "DisplaySetInfo.hpp"
+#include "Subtitle.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Pgs
+{
+    /**
+     * \brief A single composition object's time on screen, from the display set that shows it to the display set
+     * that removes or replaces it.
+     *
+     * \details
+     * PGS data never stores an end time. An object stays on screen until a later display set no longer references
+     * it (e.g. a "clear" set with zero composition objects), starts a new epoch, redefines the object with a new
+     * version, or moves it. SubtitleEvent::deriveAll pairs those display sets up in a single pass over the stream.
+     * <br/><br/>When two objects are shown at once (two windows, or two objects sharing a window), each gets its own
+     * event so their lifetimes may overlap.
+     */
+    class SubtitleEvent
+    {
+    protected:
+        uint32_t startTime; /**< Presentation time of the display set showing the object, with 90kHz accuracy. */
+        uint32_t endTime; /**< Presentation time of the display set removing the object, or OPEN_END. */
+        uint32_t startIndex; /**< Index of the display set showing the object. */
+        uint32_t endIndex; /**< Index of the display set removing the object, or NO_INDEX. */
+        uint16_t compositionNumber; /**< Composition number of the display set showing the object. */
+        uint16_t objectID; /**< ID of the displayed object. */
+        uint8_t objectVersion; /**< Version of the displayed object. */
+        uint8_t windowID; /**< ID of the window the object is shown in. */
+        bool forcedFlag; /**< True if the object is shown even when subtitles are turned off. */
+        uint16_t hPos; /**< Horizontal (x) offset of the object from the top-left pixel of the video frame. */
+        uint16_t vPos; /**< Vertical (y) offset of the object from the top-left pixel of the video frame. */
+        uint16_t width; /**< Width of the object, or 0 if its definition wasn't found. */
+        uint16_t height; /**< Height of the object, or 0 if its definition wasn't found. */
+
+    public:
+        /**
+         * \brief End time given to events that are still on screen when the stream ends.
+         */
+        static constexpr uint32_t OPEN_END = UINT32_MAX;
+
+        /**
+         * \brief End index given to events that are still on screen when the stream ends.
+         */
+        static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+        /**
+         * \brief Creates a new, empty SubtitleEvent instance.
+         */
+        SubtitleEvent();
+
+        /**
+         * \brief Derives all events from the result of a header-only scan.
+         * \param displaySets display sets in stream order
+         * \return events in the order they start, i.e. sorted by start time for well-formed streams.
+         */
+        static std::vector<SubtitleEvent> deriveAll(const std::vector<DisplaySetInfo> &displaySets);
+
+        /**
+         * \brief Derives all events from fully imported Subtitles.
+         * \param subtitles Subtitles in stream order
+         * \return events in the order they start, i.e. sorted by start time for well-formed streams.
+         */
+        static std::vector<SubtitleEvent> deriveAll(const std::vector<std::shared_ptr<Subtitle>> &subtitles);
+
+        // =======
+        // Getters
+        // =======
+
+        [[nodiscard]] const uint32_t &getStartTime() const noexcept;
+
+        [[nodiscard]] uint32_t getStartTimeMs() const noexcept;
+
+        [[nodiscard]] const uint32_t &getEndTime() const noexcept;
+
+        [[nodiscard]] uint32_t getEndTimeMs() const noexcept;
+
+        /**
+         * \brief Retrieves the time the object stays on screen.
+         * \return duration with 90kHz accuracy, or 0 if the event has no end.
+         */
+        [[nodiscard]] uint32_t getDuration() const noexcept;
+
+        [[nodiscard]] uint32_t getDurationMs() const noexcept;
+
+        /**
+         * \brief Checks whether the event was still open when the stream ended.
+         * \return true if no display set removed the object
+         */
+        [[nodiscard]] bool isOpen() const noexcept;
+
+        [[nodiscard]] const uint32_t &getStartIndex() const noexcept;
+
+        [[nodiscard]] const uint32_t &getEndIndex() const noexcept;
+
+        [[nodiscard]] const uint16_t &getCompositionNumber() const noexcept;
+
+        [[nodiscard]] const uint16_t &getObjectID() const noexcept;
+
+        [[nodiscard]] const uint8_t &getObjectVersion() const noexcept;
+
+        [[nodiscard]] const uint8_t &getWindowID() const noexcept;
+
+        [[nodiscard]] const bool &getForcedFlag() const noexcept;
+
+        [[nodiscard]] const uint16_t &getHPos() const noexcept;
+
+        [[nodiscard]] const uint16_t &getVPos() const noexcept;
+
+        [[nodiscard]] const uint16_t &getWidth() const noexcept;
+
+        [[nodiscard]] const uint16_t &getHeight() const noexcept;
+
+        friend class EventBuilder;
+    };
+}
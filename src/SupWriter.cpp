@@ -0,0 +1,212 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#include "SupWriter.hpp"
+#include "ByteWriter.hpp"
+
+using std::shared_ptr;
+using std::vector;
+
+using namespace Pgs;
+
+constexpr size_t SupWriter::DEFAULT_FLUSH_THRESHOLD;
+
+WriteError::WriteError(const char *msg) : std::runtime_error(msg)
+{}
+
+SupWriter::SupWriter()
+{
+    this->stream = nullptr;
+    this->flushThreshold = 0u;
+    this->bytesWritten = 0u;
+}
+
+SupWriter::SupWriter(std::ostream &stream, const size_t &flushThreshold)
+{
+    this->stream = &stream;
+    this->flushThreshold = flushThreshold;
+    this->bytesWritten = 0u;
+    this->buffer.reserve(flushThreshold + ObjectDefinition::MAX_SEGMENT_DATA_SIZE + Segment::MIN_BYTE_SIZE);
+}
+
+SupWriter::~SupWriter()
+{
+    try
+    {
+        this->flush();
+    }
+    catch (const WriteError &)
+    {}
+}
+
+void SupWriter::writeSegment(const SegmentType &segmentType, const uint32_t &presentationTimestamp,
+                             const uint32_t &decodingTimestamp, const SegmentData *data)
+{
+    const size_t segmentStart = this->buffer.size();
+
+    ByteWriter writer(this->buffer);
+    writer.write8('P');
+    writer.write8('G');
+    writer.write32(presentationTimestamp);
+    writer.write32(decodingTimestamp);
+    writer.write8(static_cast<uint8_t>(segmentType));
+    const size_t sizePos = writer.getPosition();
+    writer.write16(0u);
+
+    if (data)
+    {
+        data->serialize(writer);
+    }
+
+    // The size field is only known once the data has been written.
+    const size_t dataSize = writer.getPosition() - sizePos - 2u;
+    if (dataSize > UINT16_MAX)
+    {
+        this->buffer.resize(segmentStart);
+        throw WriteError("SupWriter::writeSegment: segment data is larger than 64kb.");
+    }
+    writer.patch16(sizePos, static_cast<uint16_t>(dataSize));
+
+    this->bytesWritten += this->buffer.size() - segmentStart;
+}
+
+void SupWriter::writeObject(const ObjectDefinition &object, const uint32_t &presentationTimestamp,
+                            const uint32_t &decodingTimestamp)
+{
+    for (const auto &fragment : object.splitFragments())
+    {
+        this->writeSegment(SegmentType::ObjectDefinition, presentationTimestamp, decodingTimestamp, fragment.get());
+    }
+}
+
+void SupWriter::flushIfFull()
+{
+    if (this->stream && this->buffer.size() >= this->flushThreshold)
+    {
+        this->flush();
+    }
+}
+
+void SupWriter::write(const Subtitle &subtitle)
+{
+    const auto &pts = subtitle.getPresentationTime();
+    const auto &dts = subtitle.getDecodingTime();
+
+    if (subtitle.getPcs())
+    {
+        this->writeSegment(SegmentType::PresentationComposition, pts, dts, subtitle.getPcs().get());
+    }
+    if (subtitle.getWds())
+    {
+        this->writeSegment(SegmentType::WindowDefinition, pts, dts, subtitle.getWds().get());
+    }
+    if (subtitle.getPds())
+    {
+        this->writeSegment(SegmentType::PaletteDefinition, pts, dts, subtitle.getPds().get());
+    }
+
+    /*
+     * The second slot holds everything after the first fragment of a split object. Joining them first lets the
+     * object be re-split at segment boundaries, no matter how it was split before.
+     */
+    const auto firstFragment = subtitle.getOds(0);
+    const auto remainingFragments = subtitle.getOds(1);
+    if (firstFragment && remainingFragments && firstFragment->getSequenceFlag() == SequenceFlag::First)
+    {
+        ObjectDefinition object = *firstFragment;
+        object.appendFragment(*remainingFragments);
+        this->writeObject(object, pts, dts);
+    }
+    else
+    {
+        for (const auto &fragment : {firstFragment, remainingFragments})
+        {
+            if (fragment)
+            {
+                this->writeObject(*fragment, pts, dts);
+            }
+        }
+    }
+
+    this->writeSegment(SegmentType::EndOfDisplaySet, pts, dts, nullptr);
+    this->flushIfFull();
+}
+
+void SupWriter::write(const vector<shared_ptr<Subtitle>> &subtitles)
+{
+    for (const auto &subtitle : subtitles)
+    {
+        if (subtitle)
+        {
+            this->write(*subtitle);
+        }
+    }
+}
+
+void SupWriter::write(const Segment &segment)
+{
+    this->writeSegment(segment.getSegmentType(), segment.getPresentationTimestamp(), segment.getDecodingTimestamp(),
+                       segment.getData().get());
+    this->flushIfFull();
+}
+
+void SupWriter::write(const ObjectDefinition &object, const uint32_t &presentationTimestamp,
+                      const uint32_t &decodingTimestamp)
+{
+    this->writeObject(object, presentationTimestamp, decodingTimestamp);
+    this->flushIfFull();
+}
+
+void SupWriter::write(const char *data, const uint64_t &size)
+{
+    this->buffer.insert(this->buffer.end(), data, data + size);
+    this->bytesWritten += size;
+    this->flushIfFull();
+}
+
+void SupWriter::flush()
+{
+    if (!this->stream || this->buffer.empty())
+    {
+        return;
+    }
+
+    this->stream->write(reinterpret_cast<const char *>(this->buffer.data()),
+                        static_cast<std::streamsize>(this->buffer.size()));
+    this->buffer.clear();
+    if (!*this->stream)
+    {
+        throw WriteError("SupWriter::flush: failed to write to the output stream.");
+    }
+}
+
+// =======
+// Getters
+// =======
+
+const vector<uint8_t> &SupWriter::getBuffer() const noexcept
+{
+    return this->buffer;
+}
+
+const uint64_t &SupWriter::getBytesWritten() const noexcept
+{
+    return this->bytesWritten;
+}
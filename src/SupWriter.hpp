@@ -0,0 +1,178 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#pragma once
+
+#include "Subtitle.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+namespace Pgs
+{
+    class WriteError : virtual public std::runtime_error
+    {
+    public:
+        explicit WriteError(const char *msg);
+
+        ~WriteError() noexcept override = default;
+    };
+
+    /**
+     * \brief Serializes Subtitles and Segments back into PGS (.sup) data.
+     *
+     * \details
+     * All segments are first collected in a single output buffer. When writing to a stream, the buffer is handed to
+     * the stream in one call once it holds at least the flush threshold, and again on flush() or destruction. Without
+     * a stream, the buffer keeps all of the written data and can be retrieved with getBuffer().
+     */
+    class SupWriter
+    {
+    protected:
+        std::ostream *stream; /**< Stream receiving the data, or nullptr to keep everything in the buffer. */
+        std::vector<uint8_t> buffer; /**< Output buffer holding data that hasn't been passed to the stream yet. */
+        size_t flushThreshold; /**< Buffer size at which the buffer is passed to the stream. */
+        uint64_t bytesWritten; /**< Total number of bytes written, including those already flushed. */
+
+        /**
+         * \brief Appends a complete segment to the output buffer.
+         * \param segmentType type of the segment
+         * \param presentationTimestamp presentation time of the segment with 90kHz accuracy
+         * \param decodingTimestamp decoding time of the segment with 90kHz accuracy
+         * \param data data of the segment, or nullptr for segments without data
+         *
+         * \throws WriteError if the segment data is larger than a segment can hold.
+         */
+        void writeSegment(const SegmentType &segmentType, const uint32_t &presentationTimestamp,
+                          const uint32_t &decodingTimestamp, const SegmentData *data);
+
+        /**
+         * \brief Appends one segment per fragment needed to hold the provided object.
+         * \param object object to write
+         * \param presentationTimestamp presentation time of the segments with 90kHz accuracy
+         * \param decodingTimestamp decoding time of the segments with 90kHz accuracy
+         */
+        void writeObject(const ObjectDefinition &object, const uint32_t &presentationTimestamp,
+                         const uint32_t &decodingTimestamp);
+
+        /**
+         * \brief Passes the output buffer to the stream if it has reached the flush threshold.
+         */
+        void flushIfFull();
+    public:
+        static constexpr size_t DEFAULT_FLUSH_THRESHOLD = 1u << 20u;
+
+        /**
+         * \brief Creates a writer that keeps all written data in its buffer.
+         */
+        SupWriter();
+
+        /**
+         * \brief Creates a writer streaming to the provided output stream.
+         * \param stream stream to write to. Must outlive the writer.
+         * \param flushThreshold number of buffered bytes after which the buffer is written to the stream
+         */
+        explicit SupWriter(std::ostream &stream, const size_t &flushThreshold = DEFAULT_FLUSH_THRESHOLD);
+
+        SupWriter(const SupWriter &) = delete;
+
+        SupWriter &operator=(const SupWriter &) = delete;
+
+        /**
+         * \brief Flushes any remaining data to the stream. Errors are ignored; call flush() first to see them.
+         */
+        ~SupWriter();
+
+        /**
+         * \brief Writes a complete display set for the provided Subtitle.
+         *
+         * \details
+         * The segments are written in the order PCS, WDS, PDS, ODS, END, skipping any the Subtitle doesn't have. A
+         * Subtitle only keeps the timestamps of its End segment, so every segment of the display set gets those.
+         * Objects that don't fit in one segment are split into fragments.
+         *
+         * \param subtitle Subtitle to write
+         *
+         * \throws WriteError
+         */
+        void write(const Subtitle &subtitle);
+
+        /**
+         * \brief Writes a complete display set for each of the provided Subtitles.
+         * \param subtitles Subtitles to write, in stream order
+         *
+         * \throws WriteError
+         */
+        void write(const std::vector<std::shared_ptr<Subtitle>> &subtitles);
+
+        /**
+         * \brief Writes a single segment exactly as it was imported.
+         * \param segment Segment to write
+         *
+         * \throws WriteError
+         */
+        void write(const Segment &segment);
+
+        /**
+         * \brief Writes one segment per fragment needed to hold the provided object.
+         * \param object object to write
+         * \param presentationTimestamp presentation time of the segments with 90kHz accuracy
+         * \param decodingTimestamp decoding time of the segments with 90kHz accuracy
+         *
+         * \throws WriteError
+         */
+        void write(const ObjectDefinition &object, const uint32_t &presentationTimestamp,
+                   const uint32_t &decodingTimestamp);
+
+        /**
+         * \brief Writes already serialized PGS data without looking at it.
+         * \param data pointer to the data
+         * \param size number of bytes to write
+         *
+         * \throws WriteError
+         */
+        void write(const char *data, const uint64_t &size);
+
+        /**
+         * \brief Writes the output buffer to the stream.
+         *
+         * \details
+         * Does nothing when the writer doesn't have a stream.
+         *
+         * \throws WriteError if the stream reports a failure.
+         */
+        void flush();
+
+        // =======
+        // Getters
+        // =======
+
+        /**
+         * \brief Gets the data that hasn't been written to the stream yet, or all written data without a stream.
+         * \return output buffer
+         */
+        [[nodiscard]] const std::vector<uint8_t> &getBuffer() const noexcept;
+
+        [[nodiscard]] const uint64_t &getBytesWritten() const noexcept;
+    };
+}
@@ -0,0 +1,283 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#include "TextSegmenter.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+using std::vector;
+
+using namespace Pgs;
+
+constexpr uint32_t TextSegmenter::NO_LINE;
+
+namespace
+{
+    /**
+     * \brief Bands lower than the tallest band divided by this are merged into a neighbour.
+     */
+    constexpr uint16_t MINOR_BAND_RATIO = 4u;
+
+    struct Band
+    {
+        uint16_t start;
+        uint16_t end;
+    };
+
+    uint32_t findRoot(vector<uint32_t> &parents, uint32_t index)
+    {
+        while (parents[index] != index)
+        {
+            parents[index] = parents[parents[index]];
+            index = parents[index];
+        }
+        return index;
+    }
+
+    void extend(BoundingBox &box, const BoundingBox &other)
+    {
+        const auto right = std::max(box.x + box.width, other.x + other.width);
+        const auto bottom = std::max(box.y + box.height, other.y + other.height);
+        box.x = std::min(box.x, other.x);
+        box.y = std::min(box.y, other.y);
+        box.width = static_cast<uint16_t>(right - box.x);
+        box.height = static_cast<uint16_t>(bottom - box.y);
+    }
+}
+
+TextSegmenter::TextSegmenter(const vector<Span> &spans)
+{
+    const auto rowLines = this->findLines(spans);
+    this->findGlyphs(spans, rowLines);
+}
+
+TextSegmenter::TextSegmenter(const Subtitle &subtitle) : TextSegmenter(subtitle.getTextSpans())
+{}
+
+vector<uint32_t> TextSegmenter::findLines(const vector<Span> &spans)
+{
+    if (spans.empty())
+    {
+        return {};
+    }
+
+    // Spans are sorted by line, so the last one is on the lowest line.
+    vector<uint32_t> profile(spans.back().y + 1u, 0u);
+    for (const auto &span : spans)
+    {
+        profile[span.y] += span.width;
+    }
+
+    vector<Band> bands;
+    for (uint16_t y = 0u; y < profile.size(); ++y)
+    {
+        if (profile[y] == 0u)
+        {
+            continue;
+        }
+        if (!bands.empty() && bands.back().end == y)
+        {
+            ++bands.back().end;
+        }
+        else
+        {
+            bands.push_back({y, static_cast<uint16_t>(y + 1u)});
+        }
+    }
+
+    // Merge the lowest minor band into its closest neighbour until only full text lines are left.
+    while (bands.size() > 1u)
+    {
+        uint16_t tallest = 0u;
+        size_t lowest = 0u;
+        for (size_t i = 0; i < bands.size(); ++i)
+        {
+            tallest = std::max<uint16_t>(tallest, bands[i].end - bands[i].start);
+            if (bands[i].end - bands[i].start < bands[lowest].end - bands[lowest].start)
+            {
+                lowest = i;
+            }
+        }
+        if ((bands[lowest].end - bands[lowest].start) * MINOR_BAND_RATIO >= tallest)
+        {
+            break;
+        }
+
+        const bool hasPrevious = lowest > 0u;
+        const bool hasNext = lowest + 1u < bands.size();
+        const size_t target = !hasNext || (hasPrevious && bands[lowest].start - bands[lowest - 1u].end <=
+                                                          bands[lowest + 1u].start - bands[lowest].end) ?
+                              lowest - 1u : lowest + 1u;
+        bands[target].start = std::min(bands[target].start, bands[lowest].start);
+        bands[target].end = std::max(bands[target].end, bands[lowest].end);
+        bands.erase(bands.begin() + static_cast<std::ptrdiff_t>(lowest));
+    }
+
+    vector<uint32_t> rowLines(profile.size(), NO_LINE);
+    for (uint32_t i = 0; i < bands.size(); ++i)
+    {
+        std::fill(rowLines.begin() + bands[i].start, rowLines.begin() + bands[i].end, i);
+    }
+
+    // Merged bands cover the empty lines between their parts, which still hold no ink.
+    this->lines.assign(bands.size(), {UINT16_MAX, 0u, 0u, 0u});
+    vector<bool> hasInk(bands.size(), false);
+    for (const auto &span : spans)
+    {
+        auto &line = this->lines[rowLines[span.y]];
+        const BoundingBox spanBox = {span.x, span.y, span.width, 1u};
+        if (!hasInk[rowLines[span.y]])
+        {
+            line = spanBox;
+            hasInk[rowLines[span.y]] = true;
+        }
+        else
+        {
+            extend(line, spanBox);
+        }
+    }
+
+    return rowLines;
+}
+
+void TextSegmenter::findGlyphs(const vector<Span> &spans, const vector<uint32_t> &rowLines)
+{
+    if (spans.empty())
+    {
+        return;
+    }
+    if (spans.size() >= UINT32_MAX)
+    {
+        throw std::length_error("TextSegmenter: too many spans.");
+    }
+
+    vector<uint32_t> parents(spans.size());
+    std::iota(parents.begin(), parents.end(), 0u);
+
+    // Compare every line of spans with the line above. Both are sorted by column, so one merge-like pass finds all
+    // pairs that touch, including diagonally.
+    size_t previousStart = 0u, previousEnd = 0u, currentStart = 0u;
+    while (currentStart < spans.size())
+    {
+        size_t currentEnd = currentStart;
+        while (currentEnd < spans.size() && spans[currentEnd].y == spans[currentStart].y)
+        {
+            ++currentEnd;
+        }
+
+        if (previousEnd > previousStart && spans[previousStart].y + 1u == spans[currentStart].y)
+        {
+            size_t above = previousStart, below = currentStart;
+            while (above < previousEnd && below < currentEnd)
+            {
+                const auto &upper = spans[above];
+                const auto &lower = spans[below];
+                const uint32_t upperEnd = upper.x + upper.width;
+                const uint32_t lowerEnd = lower.x + lower.width;
+                if (upper.x <= lowerEnd && lower.x <= upperEnd)
+                {
+                    const auto upperRoot = findRoot(parents, static_cast<uint32_t>(above));
+                    const auto lowerRoot = findRoot(parents, static_cast<uint32_t>(below));
+                    parents[std::max(upperRoot, lowerRoot)] = std::min(upperRoot, lowerRoot);
+                }
+
+                if (upperEnd < lowerEnd)
+                {
+                    ++above;
+                }
+                else
+                {
+                    ++below;
+                }
+            }
+        }
+
+        previousStart = currentStart;
+        previousEnd = currentEnd;
+        currentStart = currentEnd;
+    }
+
+    // Bounding box of every component, keyed by the root, which is its first span.
+    vector<uint32_t> componentIndices(spans.size(), UINT32_MAX);
+    vector<BoundingBox> components;
+    vector<uint32_t> componentLines;
+    for (uint32_t i = 0; i < spans.size(); ++i)
+    {
+        const auto root = findRoot(parents, i);
+        const BoundingBox spanBox = {spans[i].x, spans[i].y, spans[i].width, 1u};
+        if (componentIndices[root] == UINT32_MAX)
+        {
+            componentIndices[root] = static_cast<uint32_t>(components.size());
+            components.push_back(spanBox);
+            componentLines.push_back(rowLines[spans[root].y]);
+        }
+        else
+        {
+            extend(components[componentIndices[root]], spanBox);
+        }
+    }
+
+    vector<uint32_t> order(components.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&](const uint32_t &lhs, const uint32_t &rhs) {
+        return componentLines[lhs] != componentLines[rhs] ? componentLines[lhs] < componentLines[rhs] :
+               components[lhs].x < components[rhs].x;
+    });
+
+    // Merge components of the same line overlapping at least half of the narrower one.
+    for (const auto &index : order)
+    {
+        const auto &component = components[index];
+        if (!this->glyphs.empty() && this->glyphLines.back() == componentLines[index])
+        {
+            auto &glyph = this->glyphs.back();
+            const int overlap = std::min(glyph.x + glyph.width, component.x + component.width) -
+                                std::max(glyph.x, component.x);
+            if (overlap * 2 >= std::min(glyph.width, component.width))
+            {
+                extend(glyph, component);
+                continue;
+            }
+        }
+        this->glyphs.push_back(component);
+        this->glyphLines.push_back(componentLines[index]);
+    }
+}
+
+// =======
+// Getters
+// =======
+
+const vector<BoundingBox> &TextSegmenter::getLines() const noexcept
+{
+    return this->lines;
+}
+
+const vector<BoundingBox> &TextSegmenter::getGlyphs() const noexcept
+{
+    return this->glyphs;
+}
+
+const vector<uint32_t> &TextSegmenter::getGlyphLines() const noexcept
+{
+    return this->glyphLines;
+}
@@ -0,0 +1,90 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#pragma once
+
+#include "ObjectDefinition.hpp"
+#include "Subtitle.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace Pgs
+{
+    /**
+     * \brief Splits the text of a subtitle image into lines and glyphs, as a first step of OCR.
+     *
+     * \details
+     * Everything works on spans of ink, e.g. from Subtitle::getTextSpans, so the cost grows with the amount of text
+     * rather than the image area.
+     * <br/><br/>Lines are found from the row projection profile: every band of lines holding ink is a text line.
+     * Bands much lower than the tallest one, like accents or underscores separated from their line by an empty
+     * line, are merged into their closest neighbouring band.
+     * <br/><br/>Glyphs are the 8-connected components of the spans, found by joining the spans that touch a span of
+     * the line above with a union-find. Components of the same text line that mostly overlap horizontally, like the
+     * dot and stem of an "i", are then merged into a single glyph.
+     */
+    class TextSegmenter
+    {
+    protected:
+        std::vector<BoundingBox> lines; /**< Text lines from top to bottom. */
+        std::vector<BoundingBox> glyphs; /**< Glyphs sorted by text line, then from left to right. */
+        std::vector<uint32_t> glyphLines; /**< Index of the text line of every glyph. */
+
+        /**
+         * \brief Finds the text lines from the row projection profile of the spans.
+         * \return index of the text line of every image line, or NO_LINE for image lines without ink
+         */
+        std::vector<uint32_t> findLines(const std::vector<Span> &spans);
+
+        /**
+         * \brief Finds the connected components of the spans and merges them into glyphs.
+         * \param rowLines index of the text line of every image line, from findLines
+         */
+        void findGlyphs(const std::vector<Span> &spans, const std::vector<uint32_t> &rowLines);
+    public:
+        /**
+         * \brief Value used for image lines without ink.
+         */
+        static constexpr uint32_t NO_LINE = UINT32_MAX;
+
+        /**
+         * \brief Segments the provided spans.
+         * \param spans spans of ink sorted by line, then by column, e.g. from ObjectDefinition::findSpans
+         */
+        explicit TextSegmenter(const std::vector<Span> &spans);
+
+        /**
+         * \brief Segments the text fill of the image of a Subtitle.
+         * \param subtitle subtitle to segment
+         */
+        explicit TextSegmenter(const Subtitle &subtitle);
+
+        // =======
+        // Getters
+        // =======
+
+        [[nodiscard]] const std::vector<BoundingBox> &getLines() const noexcept;
+
+        [[nodiscard]] const std::vector<BoundingBox> &getGlyphs() const noexcept;
+
+        [[nodiscard]] const std::vector<uint32_t> &getGlyphLines() const noexcept;
+    };
+}
@@ -0,0 +1,138 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#include "TimeTransform.hpp"
+#include "Segment.hpp"
+#include "ByteReader.hpp"
+#include "ByteWriter.hpp"
+
+using namespace Pgs;
+
+namespace
+{
+    uint64_t greatestCommonDivisor(uint64_t a, uint64_t b) noexcept
+    {
+        while (b != 0u)
+        {
+            const uint64_t remainder = a % b;
+            a = b;
+            b = remainder;
+        }
+        return a;
+    }
+}
+
+TimeTransform::TimeTransform(const int64_t &offset, const uint32_t &numerator, const uint32_t &denominator) noexcept
+{
+    this->offset = offset;
+    this->numerator = numerator;
+    this->denominator = denominator == 0u ? 1u : denominator;
+}
+
+TimeTransform TimeTransform::fromFrameRates(const uint32_t &sourceRateNum, const uint32_t &sourceRateDen,
+                                            const uint32_t &targetRateNum, const uint32_t &targetRateDen,
+                                            const int64_t &offset)
+{
+    // Times scale by sourceRate / targetRate = (sourceRateNum * targetRateDen) / (sourceRateDen * targetRateNum).
+    uint64_t numerator = static_cast<uint64_t>(sourceRateNum) * targetRateDen;
+    uint64_t denominator = static_cast<uint64_t>(sourceRateDen) * targetRateNum;
+    const uint64_t divisor = greatestCommonDivisor(numerator, denominator);
+    if (divisor > 1u)
+    {
+        numerator /= divisor;
+        denominator /= divisor;
+    }
+
+    // Keep the factor representable; the precision lost here is far below one 90kHz tick per hour.
+    while (numerator > UINT32_MAX || denominator > UINT32_MAX)
+    {
+        numerator >>= 1u;
+        denominator >>= 1u;
+    }
+
+    return TimeTransform(offset, static_cast<uint32_t>(numerator), static_cast<uint32_t>(denominator));
+}
+
+uint32_t TimeTransform::apply(const uint32_t &timestamp) const noexcept
+{
+    const uint64_t scaled = (static_cast<uint64_t>(timestamp) * this->numerator + this->denominator / 2u) /
+                            this->denominator;
+    const int64_t result = static_cast<int64_t>(scaled) + this->offset;
+    if (result < 0)
+    {
+        return 0u;
+    }
+
+    return result > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(result);
+}
+
+uint64_t TimeTransform::applyInPlace(char *data, const uint64_t &size) const noexcept
+{
+    const uint8_t ptsOffset = 2u;
+    const uint8_t dtsOffset = 6u;
+
+    uint64_t numSegments = 0u;
+    uint64_t readPos = 0u;
+    while (readPos < size)
+    {
+        readPos = Segment::findNext(data, size, readPos);
+        if (readPos >= size)
+        {
+            break;
+        }
+
+        auto header = reinterpret_cast<uint8_t *>(data + readPos);
+        storeBigEndian32(header + ptsOffset, this->apply(loadBigEndian32(header + ptsOffset)));
+        const uint32_t decodingTimestamp = loadBigEndian32(header + dtsOffset);
+        if (decodingTimestamp != 0u)
+        {
+            storeBigEndian32(header + dtsOffset, this->apply(decodingTimestamp));
+        }
+        ++numSegments;
+
+        readPos += Segment::MIN_BYTE_SIZE + Segment::getSegmentSize(data + readPos, size - readPos);
+    }
+
+    return numSegments;
+}
+
+uint64_t TimeTransform::applyInPlace(std::vector<char> &data) const noexcept
+{
+    return this->applyInPlace(data.data(), data.size());
+}
+
+// =======
+// Getters
+// =======
+
+const int64_t &TimeTransform::getOffset() const noexcept
+{
+    return this->offset;
+}
+
+const uint32_t &TimeTransform::getNumerator() const noexcept
+{
+    return this->numerator;
+}
+
+const uint32_t &TimeTransform::getDenominator() const noexcept
+{
+    return this->denominator;
+}
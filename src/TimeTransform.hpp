@@ -0,0 +1,105 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Pgs
+{
+    /**
+     * \brief Linear mapping of 90kHz timestamps, used to shift or stretch the timing of a stream.
+     *
+     * \details
+     * A timestamp t is mapped to t * numerator / denominator + offset, rounded to the nearest tick and clamped to the
+     * 32-bit timestamp range.
+     */
+    class TimeTransform
+    {
+    protected:
+        int64_t offset; /**< Number of 90kHz ticks added after scaling. */
+        uint32_t numerator; /**< Numerator of the scale factor. */
+        uint32_t denominator; /**< Denominator of the scale factor. */
+    public:
+        /**
+         * \brief Creates a transform scaling by numerator / denominator and then adding offset.
+         * \param offset number of 90kHz ticks to add
+         * \param numerator numerator of the scale factor
+         * \param denominator denominator of the scale factor. 0 is treated as 1.
+         */
+        explicit TimeTransform(const int64_t &offset = 0, const uint32_t &numerator = 1u,
+                               const uint32_t &denominator = 1u) noexcept;
+
+        /**
+         * \brief Creates a transform for a stream whose video is played back at a different frame rate.
+         *
+         * \details
+         * For example, going from 24000/1001 to 25 fps shortens every timestamp by a factor of 24000/25025.
+         *
+         * \param sourceRateNum numerator of the frame rate the stream was timed for
+         * \param sourceRateDen denominator of the frame rate the stream was timed for
+         * \param targetRateNum numerator of the new frame rate
+         * \param targetRateDen denominator of the new frame rate
+         * \param offset number of 90kHz ticks to add after scaling
+         * \return new TimeTransform
+         */
+        static TimeTransform fromFrameRates(const uint32_t &sourceRateNum, const uint32_t &sourceRateDen,
+                                            const uint32_t &targetRateNum, const uint32_t &targetRateDen,
+                                            const int64_t &offset = 0);
+
+        /**
+         * \brief Maps a single timestamp.
+         * \param timestamp timestamp with 90kHz accuracy
+         * \return mapped timestamp with 90kHz accuracy
+         */
+        [[nodiscard]] uint32_t apply(const uint32_t &timestamp) const noexcept;
+
+        /**
+         * \brief Rewrites the timestamps of every segment in the provided data in place.
+         *
+         * \details
+         * Only the 13-byte segment headers are visited; segment data is skipped using the size in each header. Bytes
+         * between segments are left untouched. Decoding timestamps of 0 mean "not used" and are kept as they are.
+         *
+         * \param data pointer to writable PGS data, such as a writable file mapping
+         * \param size number of bytes in the data array
+         * \return number of segments that were retimed
+         */
+        uint64_t applyInPlace(char *data, const uint64_t &size) const noexcept;
+
+        /**
+         * \brief Rewrites the timestamps of every segment in the provided buffer in place.
+         * \param data buffer holding PGS data
+         * \return number of segments that were retimed
+         */
+        uint64_t applyInPlace(std::vector<char> &data) const noexcept;
+
+        // =======
+        // Getters
+        // =======
+
+        [[nodiscard]] const int64_t &getOffset() const noexcept;
+
+        [[nodiscard]] const uint32_t &getNumerator() const noexcept;
+
+        [[nodiscard]] const uint32_t &getDenominator() const noexcept;
+    };
+}
@@ -0,0 +1,309 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#include "TransportStreamReader.hpp"
+#include "ByteWriter.hpp"
+
+#include <array>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+using std::vector;
+
+using namespace Pgs;
+
+constexpr uint16_t TransportStreamReader::FIRST_PGS_PID;
+constexpr uint16_t TransportStreamReader::LAST_PGS_PID;
+
+namespace
+{
+    constexpr uint8_t SYNC_BYTE = 0x47u;
+    constexpr uint8_t TS_PACKET_SIZE = 188u;
+    constexpr uint8_t BDAV_PACKET_SIZE = 192u;
+    constexpr size_t PACKETS_PER_READ = 4096u;
+    constexpr size_t NUM_PGS_PIDS = TransportStreamReader::LAST_PGS_PID - TransportStreamReader::FIRST_PGS_PID + 1u;
+
+    /**
+     * \brief Reassembly state of one PGS PID.
+     */
+    struct PesState
+    {
+        bool resolved = false; /**< True once the output of the PID has been requested. */
+        std::ostream *out = nullptr; /**< Output of the PID, nullptr if skipped. */
+        bool active = false; /**< True while a PES packet is being collected. */
+        uint8_t continuityCounter = 0u;
+        vector<uint8_t> pes;
+    };
+
+    uint32_t readTimestamp(const uint8_t *data)
+    {
+        // 33 bit timestamp spread over 5 bytes with marker bits. PGS timestamps keep the lower 32 bits.
+        const uint64_t timestamp = (static_cast<uint64_t>(data[0] & 0x0Eu) << 29u) |
+                                   (static_cast<uint64_t>(data[1]) << 22u) |
+                                   (static_cast<uint64_t>(data[2] & 0xFEu) << 14u) |
+                                   (static_cast<uint64_t>(data[3]) << 7u) | (data[4] >> 1u);
+        return static_cast<uint32_t>(timestamp);
+    }
+
+    /**
+     * \brief Gets the size of a PES packet from its header, or 0 if it's unbounded or the header is incomplete.
+     */
+    size_t getPesSize(const vector<uint8_t> &pes)
+    {
+        if (pes.size() < 6u)
+        {
+            return 0u;
+        }
+        const size_t length = static_cast<size_t>(pes[4]) << 8u | pes[5];
+        return length == 0u ? 0u : length + 6u;
+    }
+}
+
+TransportStreamReader::TransportStreamReader(std::istream &stream) : stream(stream)
+{
+    std::array<uint8_t, 3u * BDAV_PACKET_SIZE> start{};
+    this->stream.clear();
+    this->stream.seekg(0);
+    this->stream.read(reinterpret_cast<char *>(start.data()), start.size());
+    const auto available = static_cast<size_t>(this->stream.gcount());
+
+    auto hasSyncBytes = [&](const size_t &offset, const size_t &packetSize) {
+        bool found = false;
+        for (size_t pos = offset; pos < available; pos += packetSize)
+        {
+            if (start[pos] != SYNC_BYTE)
+            {
+                return false;
+            }
+            found = true;
+        }
+        return found;
+    };
+
+    if (hasSyncBytes(BDAV_PACKET_SIZE - TS_PACKET_SIZE, BDAV_PACKET_SIZE))
+    {
+        this->packetSize = BDAV_PACKET_SIZE;
+    }
+    else if (hasSyncBytes(0u, TS_PACKET_SIZE))
+    {
+        this->packetSize = TS_PACKET_SIZE;
+    }
+    else
+    {
+        throw ImportException("TransportStreamReader: stream doesn't start with transport stream packets.");
+    }
+}
+
+uint64_t TransportStreamReader::writePes(const vector<uint8_t> &pes, std::ostream &out)
+{
+    // Start code, stream ID, packet length, two flag bytes and the header data length.
+    if (pes.size() < 9u || pes[0] != 0u || pes[1] != 0u || pes[2] != 1u)
+    {
+        return 0u;
+    }
+
+    const uint8_t timestampFlags = pes[7] & 0xC0u;
+    const size_t headerSize = 9u + pes[8];
+    const size_t pesSize = getPesSize(pes);
+    const size_t end = pesSize == 0u || pesSize > pes.size() ? pes.size() : pesSize;
+    if (headerSize > end || (timestampFlags != 0u && headerSize < 14u) || (timestampFlags == 0xC0u && headerSize < 19u))
+    {
+        return 0u;
+    }
+
+    const uint32_t presentationTime = timestampFlags & 0x80u ? readTimestamp(pes.data() + 9u) : 0u;
+    const uint32_t decodingTime = timestampFlags == 0xC0u ? readTimestamp(pes.data() + 14u) : 0u;
+
+    vector<uint8_t> segments;
+    segments.reserve(end - headerSize + 16u);
+    ByteWriter writer(segments);
+    uint64_t numSegments = 0u;
+    size_t readPos = headerSize;
+    while (readPos + 3u <= end)
+    {
+        const size_t segmentSize = 3u + (static_cast<size_t>(pes[readPos + 1u]) << 8u | pes[readPos + 2u]);
+        if (readPos + segmentSize > end)
+        {
+            break;
+        }
+
+        writer.write8('P');
+        writer.write8('G');
+        writer.write32(presentationTime);
+        writer.write32(decodingTime);
+        writer.writeBytes(pes.data() + readPos, segmentSize);
+        readPos += segmentSize;
+        ++numSegments;
+    }
+
+    out.write(reinterpret_cast<const char *>(segments.data()), static_cast<std::streamsize>(segments.size()));
+    return numSegments;
+}
+
+uint64_t TransportStreamReader::demux(const std::function<std::ostream *(const uint16_t &pid)> &getOutput)
+{
+    std::unique_ptr<PesState[]> states(new PesState[NUM_PGS_PIDS]);
+    uint64_t numSegments = 0u;
+
+    auto flush = [&](PesState &state) {
+        if (state.active)
+        {
+            numSegments += TransportStreamReader::writePes(state.pes, *state.out);
+        }
+        state.active = false;
+        state.pes.clear();
+    };
+
+    const size_t syncOffset = this->packetSize - TS_PACKET_SIZE;
+    vector<uint8_t> buffer(PACKETS_PER_READ * this->packetSize);
+    size_t bufferSize = 0u;
+
+    this->stream.clear();
+    this->stream.seekg(0);
+    while (true)
+    {
+        this->stream.read(reinterpret_cast<char *>(buffer.data() + bufferSize),
+                          static_cast<std::streamsize>(buffer.size() - bufferSize));
+        bufferSize += static_cast<size_t>(this->stream.gcount());
+        if (bufferSize < this->packetSize)
+        {
+            break;
+        }
+
+        size_t readPos = 0u;
+        while (readPos + this->packetSize <= bufferSize)
+        {
+            const uint8_t *packet = buffer.data() + readPos + syncOffset;
+            if (packet[0] != SYNC_BYTE)
+            {
+                // Lost sync, look for the next sync byte.
+                ++readPos;
+                continue;
+            }
+            readPos += this->packetSize;
+
+            const uint16_t pid = static_cast<uint16_t>((packet[1] & 0x1Fu) << 8u | packet[2]);
+            if (pid < FIRST_PGS_PID || pid > LAST_PGS_PID)
+            {
+                continue;
+            }
+
+            PesState &state = states[pid - FIRST_PGS_PID];
+            if (!state.resolved)
+            {
+                state.out = getOutput(pid);
+                state.resolved = true;
+            }
+            const uint8_t adaptationFieldControl = (packet[3] >> 4u) & 0x03u;
+            if (state.out == nullptr || (packet[1] & 0x80u) || !(adaptationFieldControl & 0x01u))
+            {
+                // Skipped PID, transport error or no payload.
+                continue;
+            }
+
+            const bool unitStart = packet[1] & 0x40u;
+            const uint8_t continuityCounter = packet[3] & 0x0Fu;
+            if (unitStart)
+            {
+                flush(state);
+                state.active = true;
+            }
+            else if (state.active && continuityCounter != ((state.continuityCounter + 1u) & 0x0Fu))
+            {
+                // Part of the PES packet is missing.
+                state.active = false;
+                state.pes.clear();
+            }
+            state.continuityCounter = continuityCounter;
+            if (!state.active)
+            {
+                continue;
+            }
+
+            size_t payloadStart = 4u;
+            if (adaptationFieldControl & 0x02u)
+            {
+                payloadStart += 1u + packet[4];
+            }
+            if (payloadStart < TS_PACKET_SIZE)
+            {
+                state.pes.insert(state.pes.end(), packet + payloadStart, packet + TS_PACKET_SIZE);
+            }
+
+            const size_t pesSize = getPesSize(state.pes);
+            if (pesSize != 0u && state.pes.size() >= pesSize)
+            {
+                flush(state);
+            }
+        }
+
+        std::copy(buffer.begin() + readPos, buffer.begin() + bufferSize, buffer.begin());
+        bufferSize -= readPos;
+    }
+
+    for (size_t i = 0; i < NUM_PGS_PIDS; ++i)
+    {
+        flush(states[i]);
+    }
+
+    return numSegments;
+}
+
+uint64_t TransportStreamReader::extract(const uint16_t &pid, std::ostream &out)
+{
+    if (pid < FIRST_PGS_PID || pid > LAST_PGS_PID)
+    {
+        throw std::invalid_argument("TransportStreamReader::extract: PID isn't in the PGS PID range.");
+    }
+
+    return this->demux([&](const uint16_t &streamPid) { return streamPid == pid ? &out : nullptr; });
+}
+
+vector<char> TransportStreamReader::extract(const uint16_t &pid)
+{
+    std::ostringstream out;
+    this->extract(pid, out);
+    const auto data = out.str();
+    return vector<char>(data.begin(), data.end());
+}
+
+std::map<uint16_t, vector<char>> TransportStreamReader::extractAll()
+{
+    std::map<uint16_t, std::ostringstream> outputs;
+    this->demux([&](const uint16_t &pid) { return &outputs[pid]; });
+
+    std::map<uint16_t, vector<char>> streams;
+    for (const auto &output : outputs)
+    {
+        const auto data = output.second.str();
+        streams[output.first] = vector<char>(data.begin(), data.end());
+    }
+    return streams;
+}
+
+// =======
+// Getters
+// =======
+
+const uint8_t &TransportStreamReader::getPacketSize() const noexcept
+{
+    return this->packetSize;
+}
@@ -0,0 +1,109 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#pragma once
+
+#include "SegmentData.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <vector>
+
+namespace Pgs
+{
+    /**
+     * \brief Demuxes PGS subtitle streams from MPEG-2 transport streams (.m2ts/.mts/.ts).
+     *
+     * \details
+     * Blu-ray carries each PGS stream on its own PID in the 0x1200-0x12FF range, with every segment sent as the
+     * payload of a PES packet. The reader reassembles those PES packets and writes their segments back with the
+     * "PG" magic number and the PES timestamps, so the output is regular PGS data that Subtitle::createAll and
+     * DisplaySetInfo::scanAll accept as is.
+     * <br/><br/>The stream is read in one pass, in large blocks. Per packet, only the sync byte and PID are checked
+     * before packets of other PIDs are skipped. Both 192 byte BDAV packets (.m2ts) and 188 byte packets (.ts) are
+     * supported. A packet lost in transmission (detected through the continuity counter) drops the PES packet it
+     * belonged to instead of producing a corrupted segment.
+     */
+    class TransportStreamReader
+    {
+    protected:
+        std::istream &stream; /**< Stream holding the transport stream. */
+        uint8_t packetSize; /**< 192 for BDAV streams, 188 for plain transport streams. */
+
+        /**
+         * \brief Demuxes the PGS PIDs of the stream.
+         * \param getOutput called once for every PGS PID found, returning the stream receiving its PGS data, or
+         * nullptr to skip the PID.
+         * \return number of segments written
+         */
+        uint64_t demux(const std::function<std::ostream *(const uint16_t &pid)> &getOutput);
+
+        /**
+         * \brief Writes the segments carried by a PES packet.
+         * \return number of segments written
+         */
+        static uint64_t writePes(const std::vector<uint8_t> &pes, std::ostream &out);
+    public:
+        static constexpr uint16_t FIRST_PGS_PID = 0x1200u; /**< First PID Blu-ray assigns to PGS streams. */
+        static constexpr uint16_t LAST_PGS_PID = 0x12FFu; /**< Last PID Blu-ray assigns to PGS streams. */
+
+        /**
+         * \brief Detects the packet size of a transport stream.
+         * \param stream stream holding the transport stream. Must be seekable and outlive the reader.
+         *
+         * \throws ImportException if the stream doesn't start with transport stream packets.
+         */
+        explicit TransportStreamReader(std::istream &stream);
+
+        /**
+         * \brief Extracts one PGS stream.
+         * \param pid PID of the stream, within FIRST_PGS_PID and LAST_PGS_PID
+         * \param out stream receiving the PGS data
+         * \return number of segments extracted
+         *
+         * \throws std::invalid_argument if pid isn't a PGS PID.
+         */
+        uint64_t extract(const uint16_t &pid, std::ostream &out);
+
+        /**
+         * \brief Extracts one PGS stream into memory.
+         * \param pid PID of the stream, within FIRST_PGS_PID and LAST_PGS_PID
+         * \return PGS data of the stream
+         *
+         * \throws std::invalid_argument if pid isn't a PGS PID.
+         */
+        std::vector<char> extract(const uint16_t &pid);
+
+        /**
+         * \brief Extracts every PGS stream in a single pass.
+         * \return PGS data of each stream, by PID
+         */
+        std::map<uint16_t, std::vector<char>> extractAll();
+
+        // =======
+        // Getters
+        // =======
+
+        [[nodiscard]] const uint8_t &getPacketSize() const noexcept;
+    };
+}
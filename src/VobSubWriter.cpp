@@ -0,0 +1,596 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#include "VobSubWriter.hpp"
+#include "ByteWriter.hpp"
+#include "PgsUtil.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+using std::array;
+using std::string;
+using std::vector;
+
+using namespace Pgs;
+
+constexpr size_t VobSubWriter::PACK_SIZE;
+
+namespace
+{
+    constexpr uint8_t MIN_VISIBLE_ALPHA = 32u; /**< Palette entries below this alpha become the background. */
+    constexpr uint8_t NUM_CLUSTERS = 3u; /**< Pattern, emphasis 1 and emphasis 2. */
+    constexpr uint8_t MAX_KMEANS_ITERATIONS = 8u;
+
+    /**
+     * \brief Writes DVD RLE codes, which are made of 4-bit nibbles.
+     */
+    class NibbleWriter
+    {
+    protected:
+        vector<uint8_t> &out;
+        bool halfFull = false;
+    public:
+        explicit NibbleWriter(vector<uint8_t> &out) : out(out)
+        {}
+
+        void write(const uint8_t &nibble)
+        {
+            if (this->halfFull)
+            {
+                this->out.back() |= nibble & 0x0Fu;
+            }
+            else
+            {
+                this->out.push_back(static_cast<uint8_t>(nibble << 4u));
+            }
+            this->halfFull = !this->halfFull;
+        }
+
+        /**
+         * \brief Pads the current byte, since every line starts on a byte boundary.
+         */
+        void align()
+        {
+            this->halfFull = false;
+        }
+    };
+
+    void writeRun(NibbleWriter &writer, const uint32_t &length, const uint8_t &color)
+    {
+        const auto low = static_cast<uint8_t>(((length & 0x3u) << 2u) | color);
+        if (length < 4u)
+        {
+            writer.write(low);
+        }
+        else if (length < 16u)
+        {
+            writer.write(static_cast<uint8_t>(length >> 2u));
+            writer.write(low);
+        }
+        else if (length < 64u)
+        {
+            writer.write(0u);
+            writer.write(static_cast<uint8_t>(length >> 2u));
+            writer.write(low);
+        }
+        else
+        {
+            writer.write(0u);
+            writer.write(static_cast<uint8_t>(length >> 6u));
+            writer.write(static_cast<uint8_t>((length >> 2u) & 0x0Fu));
+            writer.write(low);
+        }
+    }
+
+    void writeTimestamp(std::ostream &stream, const uint32_t &time)
+    {
+        const uint32_t ms = time / 90u;
+        stream << std::setfill('0') << std::setw(2) << ms / 3600000u << ':' << std::setw(2) << (ms / 60000u) % 60u
+               << ':' << std::setw(2) << (ms / 1000u) % 60u << ':' << std::setw(3) << ms % 1000u;
+    }
+
+    uint32_t getDistance(const array<uint8_t, 3> &lhs, const array<uint8_t, 3> &rhs)
+    {
+        uint32_t distance = 0u;
+        for (size_t i = 0; i < lhs.size(); ++i)
+        {
+            const int32_t difference = static_cast<int32_t>(lhs[i]) - rhs[i];
+            distance += static_cast<uint32_t>(difference * difference);
+        }
+        return distance;
+    }
+}
+
+VobSubWriter::VobSubWriter(const string &languageCode, const unsigned &numThreads)
+{
+    this->languageCode = languageCode;
+    this->numThreads = numThreads;
+}
+
+void VobSubWriter::encodeImage(const Subtitle &subtitle, EncodedImage &image)
+{
+    const auto lines = subtitle.decodeImage();
+    const auto &ods = subtitle.getOds(0);
+    image.width = ods->getWidth();
+    image.height = ods->getHeight();
+
+    const auto &compositionObjects = subtitle.getPcs()->getCompositionObjects();
+    if (!compositionObjects.empty())
+    {
+        image.x = compositionObjects[0]->getHPos();
+        image.y = compositionObjects[0]->getVPos();
+        image.forced = compositionObjects[0]->getForcedFlag();
+    }
+
+    array<uint64_t, 256> histogram{};
+    for (const auto &line : lines)
+    {
+        for (const uint8_t &pixel : line)
+        {
+            ++histogram[pixel];
+        }
+    }
+
+    // Visible palette entries in use, to be clustered by luminance.
+    struct Entry
+    {
+        uint8_t index;
+        uint8_t luminance;
+        array<uint8_t, 4> rgba;
+        uint64_t count;
+        uint8_t cluster;
+    };
+    vector<Entry> entries;
+    if (subtitle.getPds())
+    {
+        for (const auto &paletteEntry : subtitle.getPds()->getEntries())
+        {
+            const auto &count = histogram[paletteEntry.first];
+            if (count > 0u && paletteEntry.second->getAlpha() >= MIN_VISIBLE_ALPHA)
+            {
+                entries.push_back({paletteEntry.first, paletteEntry.second->getY(), paletteEntry.second->getRGBA(),
+                                   count, 0u});
+            }
+        }
+    }
+
+    // Weighted 1D k-means over luminance, starting from the darkest, middle and brightest entries.
+    array<double, NUM_CLUSTERS> centers{};
+    if (!entries.empty())
+    {
+        const auto bounds = std::minmax_element(entries.begin(), entries.end(), [](const Entry &lhs, const Entry &rhs) {
+            return lhs.luminance < rhs.luminance;
+        });
+        const double low = bounds.first->luminance;
+        const double high = bounds.second->luminance;
+        for (size_t i = 0; i < NUM_CLUSTERS; ++i)
+        {
+            centers[i] = low + (high - low) * static_cast<double>(i) / (NUM_CLUSTERS - 1u);
+        }
+    }
+
+    for (uint8_t iteration = 0; iteration < MAX_KMEANS_ITERATIONS; ++iteration)
+    {
+        bool changed = false;
+        for (auto &entry : entries)
+        {
+            uint8_t nearest = 0u;
+            for (uint8_t i = 1u; i < NUM_CLUSTERS; ++i)
+            {
+                if (std::abs(entry.luminance - centers[i]) < std::abs(entry.luminance - centers[nearest]))
+                {
+                    nearest = i;
+                }
+            }
+            changed |= iteration == 0u || entry.cluster != nearest;
+            entry.cluster = nearest;
+        }
+        if (!changed)
+        {
+            break;
+        }
+
+        array<double, NUM_CLUSTERS> sums{};
+        array<uint64_t, NUM_CLUSTERS> counts{};
+        for (const auto &entry : entries)
+        {
+            sums[entry.cluster] += static_cast<double>(entry.luminance) * entry.count;
+            counts[entry.cluster] += entry.count;
+        }
+        for (size_t i = 0; i < NUM_CLUSTERS; ++i)
+        {
+            if (counts[i] > 0u)
+            {
+                centers[i] = sums[i] / counts[i];
+            }
+        }
+    }
+
+    // The most used cluster becomes the pattern color, the others the emphasis colors.
+    array<uint64_t, NUM_CLUSTERS> clusterCounts{};
+    array<array<uint64_t, 4>, NUM_CLUSTERS> clusterSums{};
+    for (const auto &entry : entries)
+    {
+        clusterCounts[entry.cluster] += entry.count;
+        for (size_t c = 0; c < 4u; ++c)
+        {
+            clusterSums[entry.cluster][c] += static_cast<uint64_t>(entry.rgba[c]) * entry.count;
+        }
+    }
+    array<uint8_t, NUM_CLUSTERS> order = {0u, 1u, 2u};
+    std::stable_sort(order.begin(), order.end(), [&](const uint8_t &lhs, const uint8_t &rhs) {
+        return clusterCounts[lhs] > clusterCounts[rhs];
+    });
+
+    array<uint8_t, NUM_CLUSTERS> clusterColors{};
+    for (uint8_t i = 0; i < NUM_CLUSTERS; ++i)
+    {
+        const auto &cluster = order[i];
+        const uint8_t color = i + 1u;
+        clusterColors[cluster] = color;
+        image.weights[color] = clusterCounts[cluster];
+        if (clusterCounts[cluster] > 0u)
+        {
+            for (size_t c = 0; c < 3u; ++c)
+            {
+                image.colors[color][c] = static_cast<uint8_t>(clusterSums[cluster][c] / clusterCounts[cluster]);
+            }
+            const auto alpha = clusterSums[cluster][3] / clusterCounts[cluster];
+            image.contrasts[color] = static_cast<uint8_t>((alpha * 15u + 127u) / 255u);
+        }
+    }
+
+    array<uint8_t, 256> colorTable{};
+    for (const auto &entry : entries)
+    {
+        colorTable[entry.index] = clusterColors[entry.cluster];
+    }
+
+    vector<uint8_t> pixels(static_cast<size_t>(image.width) * image.height, 0u);
+    for (size_t y = 0; y < std::min<size_t>(lines.size(), image.height); ++y)
+    {
+        const auto lineWidth = std::min<size_t>(lines[y].size(), image.width);
+        for (size_t x = 0; x < lineWidth; ++x)
+        {
+            pixels[y * image.width + x] = colorTable[lines[y][x]];
+        }
+    }
+    image.weights[0] = pixels.size() - image.weights[1] - image.weights[2] - image.weights[3];
+
+    VobSubWriter::encodeField(image.rle, pixels, image.width, image.height, 0u);
+    image.bottomFieldOffset = static_cast<uint32_t>(image.rle.size());
+    VobSubWriter::encodeField(image.rle, pixels, image.width, image.height, 1u);
+}
+
+void VobSubWriter::encodeField(vector<uint8_t> &out, const vector<uint8_t> &pixels, const uint16_t &width,
+                               const uint16_t &height, const uint16_t &firstLine)
+{
+    NibbleWriter writer(out);
+    for (size_t y = firstLine; y < height; y += 2u)
+    {
+        const uint8_t *line = pixels.data() + y * width;
+        size_t x = 0u;
+        while (x < width)
+        {
+            const uint8_t color = line[x];
+            size_t length = 1u;
+            while (x + length < width && line[x + length] == color)
+            {
+                ++length;
+            }
+
+            if (x + length == width && length > 255u)
+            {
+                // Run to the end of the line
+                writer.write(0u);
+                writer.write(0u);
+                writer.write(0u);
+                writer.write(color);
+            }
+            else
+            {
+                size_t remaining = length;
+                while (remaining > 0u)
+                {
+                    const auto count = static_cast<uint32_t>(std::min<size_t>(remaining, 255u));
+                    writeRun(writer, count, color);
+                    remaining -= count;
+                }
+            }
+            x += length;
+        }
+        writer.align();
+    }
+}
+
+array<array<uint8_t, 3>, 16> VobSubWriter::buildPalette(const vector<EncodedImage> &images)
+{
+    // Colors are grouped at 5 bits per channel, and the most used groups make up the palette.
+    struct Group
+    {
+        uint64_t weight = 0u;
+        array<uint64_t, 3> sums{};
+    };
+    std::map<uint32_t, Group> groups;
+    for (const auto &image : images)
+    {
+        for (size_t color = 1u; color < 4u; ++color)
+        {
+            const auto &weight = image.weights[color];
+            if (weight == 0u)
+            {
+                continue;
+            }
+
+            const auto &rgb = image.colors[color];
+            auto &group = groups[(rgb[0] >> 3u) << 10u | (rgb[1] >> 3u) << 5u | (rgb[2] >> 3u)];
+            group.weight += weight;
+            for (size_t c = 0; c < 3u; ++c)
+            {
+                group.sums[c] += static_cast<uint64_t>(rgb[c]) * weight;
+            }
+        }
+    }
+
+    vector<const Group *> sorted;
+    for (const auto &group : groups)
+    {
+        sorted.push_back(&group.second);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Group *lhs, const Group *rhs) {
+        return lhs->weight > rhs->weight;
+    });
+
+    array<array<uint8_t, 3>, 16> palette{};
+    for (size_t i = 0; i < std::min<size_t>(sorted.size(), palette.size() - 1u); ++i)
+    {
+        for (size_t c = 0; c < 3u; ++c)
+        {
+            palette[i + 1u][c] = static_cast<uint8_t>(sorted[i]->sums[c] / sorted[i]->weight);
+        }
+    }
+
+    return palette;
+}
+
+vector<uint8_t> VobSubWriter::buildSubpicture(const EncodedImage &image, const array<uint8_t, 4> &paletteIndices)
+{
+    constexpr uint32_t DISPLAY_CONTROL_SIZE = 24u;
+
+    const uint32_t firstControlOffset = 4u + static_cast<uint32_t>(image.rle.size());
+    const uint32_t secondControlOffset = firstControlOffset + DISPLAY_CONTROL_SIZE;
+    const uint32_t spuSize = secondControlOffset + 6u;
+    if (spuSize > UINT16_MAX)
+    {
+        throw WriteError("VobSubWriter::buildSubpicture: subpicture is larger than 64kb.");
+    }
+
+    vector<uint8_t> spu;
+    spu.reserve(spuSize);
+    ByteWriter writer(spu);
+    writer.write16(static_cast<uint16_t>(spuSize));
+    writer.write16(static_cast<uint16_t>(firstControlOffset));
+    writer.writeBytes(image.rle.data(), image.rle.size());
+
+    // Display control sequence, run as soon as the subpicture is decoded.
+    writer.write16(0u);
+    writer.write16(static_cast<uint16_t>(secondControlOffset));
+    writer.write8(image.forced ? 0x00u : 0x01u); // (forced) start display
+    writer.write8(0x03u); // colors
+    writer.write8(static_cast<uint8_t>(paletteIndices[3] << 4u | paletteIndices[2]));
+    writer.write8(static_cast<uint8_t>(paletteIndices[1] << 4u | paletteIndices[0]));
+    writer.write8(0x04u); // contrasts
+    writer.write8(static_cast<uint8_t>(image.contrasts[3] << 4u | image.contrasts[2]));
+    writer.write8(static_cast<uint8_t>(image.contrasts[1] << 4u | image.contrasts[0]));
+
+    const uint32_t left = image.x;
+    const uint32_t right = image.x + std::max<uint32_t>(image.width, 1u) - 1u;
+    const uint32_t top = image.y;
+    const uint32_t bottom = image.y + std::max<uint32_t>(image.height, 1u) - 1u;
+    writer.write8(0x05u); // display area
+    writer.write8(static_cast<uint8_t>(left >> 4u));
+    writer.write8(static_cast<uint8_t>((left & 0x0Fu) << 4u | right >> 8u));
+    writer.write8(static_cast<uint8_t>(right));
+    writer.write8(static_cast<uint8_t>(top >> 4u));
+    writer.write8(static_cast<uint8_t>((top & 0x0Fu) << 4u | bottom >> 8u));
+    writer.write8(static_cast<uint8_t>(bottom));
+
+    writer.write8(0x06u); // field offsets
+    writer.write16(4u);
+    writer.write16(static_cast<uint16_t>(4u + image.bottomFieldOffset));
+    writer.write8(0xFFu);
+
+    // Stop control sequence. The delay counts in units of 1024 90kHz ticks, and the last sequence points to itself.
+    const uint32_t delay = std::min<uint32_t>((image.endTime - image.startTime) / 1024u, UINT16_MAX);
+    writer.write16(static_cast<uint16_t>(delay));
+    writer.write16(static_cast<uint16_t>(secondControlOffset));
+    writer.write8(0x02u); // stop display
+    writer.write8(0xFFu);
+
+    return spu;
+}
+
+void VobSubWriter::writePacks(vector<uint8_t> &out, const vector<uint8_t> &spu, const uint32_t &presentationTime)
+{
+    constexpr size_t PACK_HEADER_SIZE = 14u;
+    constexpr size_t PES_HEADER_SIZE = 9u;
+    constexpr size_t PTS_SIZE = 5u;
+    constexpr size_t PADDING_HEADER_SIZE = 6u;
+
+    const uint64_t time = presentationTime;
+    ByteWriter writer(out);
+    size_t readPos = 0u;
+    do
+    {
+        const bool first = readPos == 0u;
+        const size_t headerDataSize = first ? PTS_SIZE : 0u;
+        const size_t capacity = PACK_SIZE - PACK_HEADER_SIZE - PES_HEADER_SIZE - headerDataSize - 1u;
+        const size_t count = std::min(capacity, spu.size() - readPos);
+
+        // Gaps too small for a padding packet are filled with stuffing bytes in the PES header instead.
+        const size_t gap = capacity - count;
+        const size_t stuffing = gap < PADDING_HEADER_SIZE ? gap : 0u;
+
+        // Pack header, with the system clock reference set to the presentation time.
+        writer.write32(0x000001BAu);
+        writer.write8(static_cast<uint8_t>(0x44u | ((time >> 27u) & 0x38u) | ((time >> 28u) & 0x03u)));
+        writer.write8(static_cast<uint8_t>(time >> 20u));
+        writer.write8(static_cast<uint8_t>(0x04u | ((time >> 12u) & 0xF8u) | ((time >> 13u) & 0x03u)));
+        writer.write8(static_cast<uint8_t>(time >> 5u));
+        writer.write8(static_cast<uint8_t>(0x04u | ((time << 3u) & 0xF8u)));
+        writer.write8(0x01u);
+        writer.write8(0x01u); // program mux rate
+        writer.write8(0x89u);
+        writer.write8(0xC3u);
+        writer.write8(0xF8u); // no pack stuffing
+
+        // Private stream 1 PES packet holding subpicture stream 0
+        writer.write32(0x000001BDu);
+        writer.write16(static_cast<uint16_t>(3u + headerDataSize + stuffing + 1u + count));
+        writer.write8(0x81u);
+        writer.write8(first ? 0x80u : 0x00u);
+        writer.write8(static_cast<uint8_t>(headerDataSize + stuffing));
+        if (first)
+        {
+            writer.write8(static_cast<uint8_t>(0x21u | ((time >> 29u) & 0x0Eu)));
+            writer.write8(static_cast<uint8_t>(time >> 22u));
+            writer.write8(static_cast<uint8_t>(0x01u | ((time >> 14u) & 0xFEu)));
+            writer.write8(static_cast<uint8_t>(time >> 7u));
+            writer.write8(static_cast<uint8_t>(0x01u | ((time << 1u) & 0xFEu)));
+        }
+        for (size_t i = 0; i < stuffing; ++i)
+        {
+            writer.write8(0xFFu);
+        }
+        writer.write8(0x20u);
+        writer.writeBytes(spu.data() + readPos, count);
+        readPos += count;
+
+        if (gap >= PADDING_HEADER_SIZE)
+        {
+            writer.write32(0x000001BEu);
+            writer.write16(static_cast<uint16_t>(gap - PADDING_HEADER_SIZE));
+            out.insert(out.end(), gap - PADDING_HEADER_SIZE, 0xFFu);
+        }
+    } while (readPos < spu.size());
+}
+
+uint64_t VobSubWriter::write(const vector<std::shared_ptr<Subtitle>> &subtitles, std::ostream &idx,
+                             std::ostream &sub) const
+{
+    vector<size_t> shown;
+    for (size_t i = 0; i + 1u < subtitles.size(); ++i)
+    {
+        if (subtitles[i] && subtitles[i]->containsImage() && subtitles[i]->getPcs() && subtitles[i + 1u])
+        {
+            shown.push_back(i);
+        }
+    }
+
+    vector<EncodedImage> images(shown.size());
+    parallelFor(0u, shown.size(), this->numThreads, [&](size_t i) {
+        const auto &index = shown[i];
+        VobSubWriter::encodeImage(*subtitles[index], images[i]);
+        images[i].startTime = subtitles[index]->getPresentationTime();
+        images[i].endTime = std::max(images[i].startTime, subtitles[index + 1u]->getPresentationTime());
+    });
+
+    const auto palette = VobSubWriter::buildPalette(images);
+
+    uint16_t videoWidth = 720u, videoHeight = 480u;
+    for (const auto &subtitle : subtitles)
+    {
+        if (subtitle && subtitle->getPcs())
+        {
+            videoWidth = subtitle->getPcs()->getWidth();
+            videoHeight = subtitle->getPcs()->getHeight();
+            break;
+        }
+    }
+
+    idx << "# VobSub index file, v7 (do not modify this line!)\n"
+        << "size: " << videoWidth << 'x' << videoHeight << "\n"
+        << "org: 0, 0\n"
+        << "scale: 100%, 100%\n"
+        << "alpha: 100%\n"
+        << "smooth: OFF\n"
+        << "fadein/out: 0, 0\n"
+        << "align: OFF at LEFT TOP\n"
+        << "time offset: 0\n"
+        << "forced subs: OFF\n"
+        << "palette: ";
+    for (size_t i = 0; i < palette.size(); ++i)
+    {
+        idx << (i > 0u ? ", " : "") << std::hex << std::setfill('0');
+        for (const auto &channel : palette[i])
+        {
+            idx << std::setw(2) << static_cast<unsigned>(channel);
+        }
+        idx << std::dec;
+    }
+    idx << "\ncustom colors: OFF, tridx: 0000, colors: 000000, 000000, 000000, 000000\n"
+        << "langidx: 0\n\n"
+        << "id: " << this->languageCode << ", index: 0\n";
+
+    uint64_t filePos = 0u;
+    vector<uint8_t> packs;
+    for (const auto &image : images)
+    {
+        // The background always uses entry 0; the other colors use the nearest palette entry.
+        array<uint8_t, 4> paletteIndices{};
+        for (size_t color = 1u; color < 4u; ++color)
+        {
+            uint8_t nearest = 1u;
+            for (uint8_t i = 2u; i < palette.size(); ++i)
+            {
+                if (getDistance(image.colors[color], palette[i]) < getDistance(image.colors[color], palette[nearest]))
+                {
+                    nearest = i;
+                }
+            }
+            paletteIndices[color] = nearest;
+        }
+
+        packs.clear();
+        VobSubWriter::writePacks(packs, VobSubWriter::buildSubpicture(image, paletteIndices), image.startTime);
+        sub.write(reinterpret_cast<const char *>(packs.data()), static_cast<std::streamsize>(packs.size()));
+
+        idx << "timestamp: ";
+        writeTimestamp(idx, image.startTime);
+        idx << ", filepos: " << std::hex << std::setfill('0') << std::setw(9) << filePos << std::dec << "\n";
+        filePos += packs.size();
+    }
+
+    if (!idx || !sub)
+    {
+        throw WriteError("VobSubWriter::write: failed to write to the output streams.");
+    }
+
+    return images.size();
+}
+
+uint64_t VobSubWriter::write(const char *data, const uint64_t &size, std::ostream &idx, std::ostream &sub) const
+{
+    return this->write(Subtitle::createAll(data, size), idx, sub);
+}
@@ -0,0 +1,156 @@
+/*
+ *  libpgs: A C++ library for reading Presentation Graphics Stream (PGS) subtitles.
+ *  Copyright (C) 2020  Brenden Davidson
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ *  USA
+*/
+
+#pragma once
+
+#include "Subtitle.hpp"
+#include "SupWriter.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Pgs
+{
+    /**
+     * \brief Converts Subtitles to VobSub (.idx/.sub), the DVD subtitle format.
+     *
+     * \details
+     * DVD subpictures only have 4 colors (background, pattern, emphasis 1 and emphasis 2), picked from a 16 color
+     * palette shared by the whole track, each with its own contrast (alpha) level. Every image is reduced with a
+     * single pass over its pixels: a histogram of palette indices is built, nearly transparent entries become the
+     * background, and the remaining entries are split into 3 luminance clusters weighted by how often they're used.
+     * The track palette is then built from the cluster colors of all images.
+     * <br/><br/>Images are decoded, reduced and RLE encoded in parallel; only the encoded subpictures are kept until
+     * the track palette is known and everything is written out.
+     * <br/><br/>Images keep the resolution of the PGS stream, which the idx "size" line tells players about.
+     */
+    class VobSubWriter
+    {
+    protected:
+        /**
+         * \brief A subpicture whose image has been reduced and encoded, waiting for the track palette.
+         */
+        struct EncodedImage
+        {
+            std::vector<uint8_t> rle; /**< Top field RLE data followed by the bottom field RLE data. */
+            uint32_t bottomFieldOffset = 0u; /**< Offset of the bottom field within rle. */
+            std::array<std::array<uint8_t, 3>, 4> colors{}; /**< RGB color of each of the 4 subpicture colors. */
+            std::array<uint8_t, 4> contrasts{}; /**< Contrast (0-15) of each of the 4 subpicture colors. */
+            std::array<uint64_t, 4> weights{}; /**< Number of pixels using each of the 4 subpicture colors. */
+            uint16_t x = 0u;
+            uint16_t y = 0u;
+            uint16_t width = 0u;
+            uint16_t height = 0u;
+            uint32_t startTime = 0u; /**< Presentation time with 90kHz accuracy. */
+            uint32_t endTime = 0u; /**< Time the image is removed with 90kHz accuracy. */
+            bool forced = false;
+        };
+
+        std::string languageCode; /**< 2 letter language code written to the idx file. */
+        unsigned numThreads; /**< Number of threads encoding images, or 0 for one per hardware thread. */
+
+        /**
+         * \brief Reduces a Subtitle's image to 4 colors and RLE encodes it.
+         * \param subtitle Subtitle containing an image
+         * \param image receives the encoded image, colors and contrasts
+         */
+        static void encodeImage(const Subtitle &subtitle, EncodedImage &image);
+
+        /**
+         * \brief Appends one field (every other line) of a 2-bit image as DVD RLE data.
+         * \param out buffer to append to
+         * \param pixels one subpicture color (0-3) per pixel, row by row
+         * \param width image width in pixels
+         * \param height image height in pixels
+         * \param firstLine 0 for the top field, 1 for the bottom field
+         */
+        static void encodeField(std::vector<uint8_t> &out, const std::vector<uint8_t> &pixels, const uint16_t &width,
+                                const uint16_t &height, const uint16_t &firstLine);
+
+        /**
+         * \brief Builds the 16 color track palette from the colors of all images.
+         * \param images encoded images
+         * \return track palette. Entry 0 is black and used for backgrounds.
+         */
+        static std::array<std::array<uint8_t, 3>, 16> buildPalette(const std::vector<EncodedImage> &images);
+
+        /**
+         * \brief Builds a complete subpicture unit (SPU) out of an encoded image.
+         * \param image encoded image
+         * \param paletteIndices track palette index of each of the 4 subpicture colors
+         * \return SPU data
+         *
+         * \throws WriteError if the SPU is larger than 64kb.
+         */
+        static std::vector<uint8_t> buildSubpicture(const EncodedImage &image,
+                                                    const std::array<uint8_t, 4> &paletteIndices);
+
+        /**
+         * \brief Wraps an SPU into 2048 byte MPEG program stream packs.
+         * \param out buffer to append to
+         * \param spu SPU data
+         * \param presentationTime presentation time with 90kHz accuracy
+         */
+        static void writePacks(std::vector<uint8_t> &out, const std::vector<uint8_t> &spu,
+                               const uint32_t &presentationTime);
+    public:
+        static constexpr size_t PACK_SIZE = 2048u; /**< Size of every MPEG program stream pack in the .sub file. */
+
+        /**
+         * \brief Creates a converter.
+         * \param languageCode 2 letter language code written to the idx file
+         * \param numThreads number of threads encoding images, or 0 to use one per hardware thread
+         */
+        explicit VobSubWriter(const std::string &languageCode = "en", const unsigned &numThreads = 0u);
+
+        /**
+         * \brief Converts Subtitles to VobSub.
+         *
+         * \details
+         * Each Subtitle containing an image is shown until the next Subtitle's presentation time. A final Subtitle
+         * that is never followed by another one is left out, since it doesn't have an end time.
+         *
+         * \param subtitles Subtitles in stream order
+         * \param idx stream receiving the .idx file
+         * \param sub stream receiving the .sub file
+         * \return number of subpictures written
+         *
+         * \throws WriteError
+         */
+        uint64_t write(const std::vector<std::shared_ptr<Subtitle>> &subtitles, std::ostream &idx,
+                       std::ostream &sub) const;
+
+        /**
+         * \brief Imports a PGS stream and converts it to VobSub.
+         * \param data pointer to raw PGS data
+         * \param size number of bytes in the data array
+         * \param idx stream receiving the .idx file
+         * \param sub stream receiving the .sub file
+         * \return number of subpictures written
+         *
+         * \throws WriteError
+         */
+        uint64_t write(const char *data, const uint64_t &size, std::ostream &idx, std::ostream &sub) const;
+    };
+}
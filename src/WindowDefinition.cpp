@@ -19,12 +19,8 @@
 */
 
 #include "WindowDefinition.hpp"
-#include "PgsUtil.hpp"
-
-extern "C"
-{
-#include <endian.h>
-}
+#include "ByteReader.hpp"
+#include "ByteWriter.hpp"
 
 using std::shared_ptr;
 using std::vector;
@@ -40,31 +36,56 @@ WindowObject::WindowObject()
     this->height = 0u;
 }
 
-shared_ptr<WindowObject> WindowObject::create(const char *data, const uint16_t &size, uint16_t &readPos)
+shared_ptr<WindowObject> WindowObject::tryCreate(const char *data, const uint16_t &size, uint16_t &readPos,
+                                                  ParseError &error)
 {
     if (!data)
     {
-        throw ImportException("WindowObject: did not receive input data.");
+        error = ParseError::NoData;
+        return nullptr;
     }
 
     if (size < WindowObject::MIN_BYTE_SIZE)
     {
-        throw ImportException("WindowObject: Not enough data to create basic structure.");
+        error = ParseError::InsufficientData;
+        return nullptr;
     }
 
     auto window = std::make_shared<WindowObject>();
 
-    const auto byteData = reinterpret_cast<const uint8_t *>(data);
-    window->id = byteData[readPos];
-    ++readPos;
-    window->hPos = be16toh(read2Bytes(byteData, readPos));
-    window->vPos = be16toh(read2Bytes(byteData, readPos));
-    window->width = be16toh(read2Bytes(byteData, readPos));
-    window->height = be16toh(read2Bytes(byteData, readPos));
+    ByteReader reader(data + readPos, size);
+    window->id = reader.read8();
+    window->hPos = reader.read16();
+    window->vPos = reader.read16();
+    window->width = reader.read16();
+    window->height = reader.read16();
+
+    readPos += reader.getPosition();
+    error = ParseError::None;
+    return window;
+}
+
+shared_ptr<WindowObject> WindowObject::create(const char *data, const uint16_t &size, uint16_t &readPos)
+{
+    ParseError error;
+    auto window = WindowObject::tryCreate(data, size, readPos, error);
+    if (!window)
+    {
+        throw ImportException(getParseErrorMessage(error));
+    }
 
     return window;
 }
 
+void WindowObject::serialize(ByteWriter &writer) const
+{
+    writer.write8(this->id);
+    writer.write16(this->hPos);
+    writer.write16(this->vPos);
+    writer.write16(this->width);
+    writer.write16(this->height);
+}
+
 // ====================
 // WindowObject Getters
 // ====================
@@ -106,43 +127,54 @@ WindowDefinition::WindowDefinition()
     this->windowObjects = vector<shared_ptr<WindowObject>>();
 }
 
-uint16_t WindowDefinition::import(const char *data, const uint16_t &size)
+ParseError WindowDefinition::tryImport(const char *data, const uint16_t &size, uint16_t &readSize)
 {
     if (!data)
     {
-        throw ImportException("WindowDefinition: did not receive input data.");
+        return ParseError::NoData;
     }
 
     if (size < WindowDefinition::MIN_BYTE_SIZE)
     {
-        throw ImportException("WindowDefinition: Not enough data to import basic structure.");
+        return ParseError::InsufficientData;
     }
 
-    const auto byteData = reinterpret_cast<const uint8_t *>(data);
+    this->windowObjects.clear();
 
     uint16_t readPos = 0u;
-    this->numWindows = byteData[readPos];
+    this->numWindows = static_cast<uint8_t>(data[readPos]);
+    ++readPos;
 
     uint16_t remainingSize = size - readPos;
     if (remainingSize < this->numWindows * WindowObject::MIN_BYTE_SIZE)
     {
-        throw ImportException("WindowDefinition: Not enough data to import all CompositionObjects.");
+        return ParseError::InsufficientData;
     }
 
+    ParseError error = ParseError::None;
     this->windowObjects.reserve(this->numWindows);
     for (uint8_t i = 0; i < this->numWindows; ++i)
     {
-        this->windowObjects.push_back(WindowObject::create(data, remainingSize, readPos));
+        auto window = WindowObject::tryCreate(data, remainingSize, readPos, error);
+        if (!window)
+        {
+            return error;
+        }
+        this->windowObjects.push_back(window);
         remainingSize = size - readPos;
     }
 
-    /*
-     * Counting the last readPos update here since weird things happen if this gets counted
-     * before the windows are imported.
-     */
-    ++readPos;
+    readSize = readPos;
+    return ParseError::None;
+}
 
-    return readPos;
+void WindowDefinition::serialize(ByteWriter &writer) const
+{
+    writer.write8(static_cast<uint8_t>(this->windowObjects.size()));
+    for (const auto &window : this->windowObjects)
+    {
+        window->serialize(writer);
+    }
 }
 
 // ========================
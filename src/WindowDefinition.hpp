@@ -68,6 +68,24 @@ namespace Pgs
          */
         static std::shared_ptr<WindowObject> create(const char* data, const uint16_t &size, uint16_t &readPos);
 
+        /**
+         * \brief imports the provided data into a new class instance without throwing on malformed data
+         *
+         * \param data pointer to raw import data array
+         * \param size number of bytes remaining in provided data array
+         * \param readPos position in data array to begin reading from. Updated on success.
+         * \param error set to the reason creation failed, or ParseError::None
+         * \return shared pointer to the new WindowObject, or nullptr on failure.
+         */
+        static std::shared_ptr<WindowObject> tryCreate(const char* data, const uint16_t &size, uint16_t &readPos,
+                                                       ParseError &error);
+
+        /**
+         * \brief Writes the window in the same format it's imported from.
+         * \param writer writer to append the data to
+         */
+        void serialize(ByteWriter &writer) const;
+
         // =======
         // Getters
         // =======
@@ -102,11 +120,15 @@ namespace Pgs
         WindowDefinition();
 
         /**
-         * \brief imports the provided data into the class instance
+         * \brief imports the provided data into the class instance without throwing on malformed data
          * \param data pointer to raw data array to import
          * \param size number of bytes in provided data array
+         * \param readSize set to the number of bytes read from the data array on success
+         * \return ParseError::None on success, or the reason the import failed.
          */
-        uint16_t import(const char *data, const uint16_t &size) override;
+        ParseError tryImport(const char *data, const uint16_t &size, uint16_t &readSize) override;
+
+        void serialize(ByteWriter &writer) const override;
 
         // =======
         // Getters
@@ -21,8 +21,24 @@
 #include <gtest/gtest.h>
 
 #include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <vector>
 #include <src/PgsUtil.hpp>
 #include <src/Segment.hpp>
+#include <src/StreamCursor.hpp>
+#include <src/WindowDefinition.hpp>
+#include <src/ObjectDefinition.hpp>
+#include <src/ByteWriter.hpp>
+#include <src/SupWriter.hpp>
+#include <src/TimeTransform.hpp>
+#include <src/ImageWriter.hpp>
+#include <src/BdnExporter.hpp>
+#include <src/MatroskaReader.hpp>
+#include <src/TransportStreamReader.hpp>
+#include <src/PerceptualHash.hpp>
+#include <src/TextSegmenter.hpp>
+#include <src/FrameBlender.hpp>
 
 class PgsTest : public ::testing::Test
 {
@@ -75,6 +91,31 @@ TEST_F(PgsTest, importValidPcsSegment)
     ASSERT_EQ(segment.getSegmentType(), Pgs::SegmentType::PresentationComposition);
 }
 
+TEST_F(PgsTest, importCompositionObjectFlags)
+{
+    const char data[] = {0, 1, 0, 0x40, 0, 10, 0, 20,
+                         0, 2, 1, (char)0x80, 0, 30, 0, 40, 0, 1, 0, 2, 0, 3, 0, 4};
+
+    uint16_t readPos = 0u;
+    const auto forced = Pgs::CompositionObject::create(data, sizeof(data), readPos);
+    ASSERT_EQ(readPos, 8u);
+    ASSERT_TRUE(forced->getForcedFlag());
+    ASSERT_FALSE(forced->getCroppedFlag());
+    ASSERT_EQ(forced->getVPos(), 20u);
+
+    const auto cropped = Pgs::CompositionObject::create(data, sizeof(data) - readPos, readPos);
+    ASSERT_EQ(readPos, sizeof(data));
+    ASSERT_FALSE(cropped->getForcedFlag());
+    ASSERT_TRUE(cropped->getCroppedFlag());
+    ASSERT_EQ(cropped->getCropHeight(), 4u);
+
+    std::vector<uint8_t> written;
+    Pgs::ByteWriter writer(written);
+    forced->serialize(writer);
+    cropped->serialize(writer);
+    ASSERT_TRUE(std::equal(written.begin(), written.end(), reinterpret_cast<const uint8_t *>(data)));
+}
+
 TEST_F(PgsTest, importShortPcsData)
 {
     const uint32_t dataSize = 5;
@@ -88,6 +129,19 @@ TEST_F(PgsTest, importShortPcsData)
     delete[] data;
 }
 
+TEST_F(PgsTest, tryImportReportsErrors)
+{
+    const char unknownSegment[] = {'P', 'G', 0, 0, 0, 1, 0, 0, 0, 1, 0x42, 0, 0};
+
+    Pgs::Segment segment;
+    uint32_t readSize = 0u;
+    ASSERT_EQ(segment.tryImport(nullptr, 0, readSize), Pgs::ParseError::NoData);
+    ASSERT_EQ(segment.tryImport(unknownSegment, 5, readSize), Pgs::ParseError::InsufficientData);
+    ASSERT_EQ(segment.tryImport(unknownSegment, sizeof(unknownSegment), readSize),
+              Pgs::ParseError::UnknownSegmentType);
+    ASSERT_EQ(readSize, 0u);
+}
+
 // =========
 // WDS Tests
 // =========
@@ -109,6 +163,27 @@ TEST_F(PgsTest, importValidWdsSegment)
     ASSERT_EQ(segment.getSegmentType(), Pgs::SegmentType::WindowDefinition);
 }
 
+TEST_F(PgsTest, importWdsFieldValues)
+{
+    const char data[] = {'P', 'G', 0x12, 0x34, 0x56, 0x78, 0, 0, 0, 0, 0x17, 0, 10,
+                         1, 3, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08};
+
+    Pgs::Segment segment;
+    ASSERT_EQ(segment.import(data, sizeof(data)), sizeof(data));
+    ASSERT_EQ(segment.getPresentationTimestamp(), 0x12345678u);
+    ASSERT_EQ(segment.getSegmentSize(), 10u);
+
+    const auto wds = std::dynamic_pointer_cast<Pgs::WindowDefinition>(segment.getData());
+    ASSERT_TRUE(wds);
+    ASSERT_EQ(wds->getNumWindows(), 1u);
+    const auto &window = wds->getWindowObjects()[0];
+    ASSERT_EQ(window->getId(), 3u);
+    ASSERT_EQ(window->getHPos(), 0x0102u);
+    ASSERT_EQ(window->getVPos(), 0x0304u);
+    ASSERT_EQ(window->getWidth(), 0x0506u);
+    ASSERT_EQ(window->getHeight(), 0x0708u);
+}
+
 TEST_F(PgsTest, importShortWdsSegment)
 {
     const uint32_t dataSize = 5;
@@ -211,6 +286,712 @@ TEST_F(PgsTest, importValidEndSegment)
     ASSERT_EQ(segment.getSegmentType(), Pgs::SegmentType::EndOfDisplaySet);
 }
 
+// ==============
+// Scanner Tests
+// ==============
+
+TEST_F(PgsTest, findMagicNumberAtEveryOffset)
+{
+    for (size_t offset = 0; offset < 80; ++offset)
+    {
+        std::vector<uint8_t> data(96, 'P');
+        data[offset + 1] = 'G';
+
+        const auto found = Pgs::findMagicNumber(data.data(), data.size());
+        ASSERT_EQ(found, data.data() + offset);
+    }
+
+    std::vector<uint8_t> noMagic(100, 'G');
+    ASSERT_EQ(Pgs::findMagicNumber(noMagic.data(), noMagic.size()), nullptr);
+}
+
+TEST_F(PgsTest, findNextSkipsFalseMagicAndGarbage)
+{
+    const char endSegment[] = {'P', 'G', 0, 0, 0, 1, 0, 0, 0, 1, static_cast<char>(0x80), 0, 0};
+    std::vector<char> data = {'x', 'P', 'G', 'P', 'G', 0, 0, 0, 0, 0, 0, 0x15, static_cast<char>(0xFF), 0x7F};
+    const auto validPos = static_cast<uint32_t>(data.size());
+    data.insert(data.end(), endSegment, endSegment + sizeof(endSegment));
+    data.insert(data.end(), endSegment, endSegment + sizeof(endSegment));
+
+    ASSERT_FALSE(Pgs::Segment::isPlausibleHeader(data.data() + 1, data.size() - 1));
+    ASSERT_TRUE(Pgs::Segment::isPlausibleHeader(data.data() + validPos, data.size() - validPos));
+    ASSERT_EQ(Pgs::Segment::findNext(data.data(), data.size(), 0), validPos);
+    ASSERT_EQ(Pgs::Segment::findNext(data.data(), data.size(), validPos + 1), validPos + sizeof(endSegment));
+    ASSERT_EQ(Pgs::Segment::findNext(data.data(), validPos, 0), validPos);
+}
+
+TEST_F(PgsTest, importSegmentFromLargeBuffer)
+{
+    // More than 64kb follows the segment, which used to wrap the 16-bit remaining size.
+    std::vector<char> data(0x10000u + 100u, 0);
+    const char endSegment[] = {'P', 'G', 0, 0, 0, 1, 0, 0, 0, 1, static_cast<char>(0x80), 0, 0};
+    std::copy(endSegment, endSegment + sizeof(endSegment), data.begin());
+
+    ASSERT_EQ(Pgs::Segment::getSegmentSize(data.data(), data.size()), 0u);
+
+    Pgs::Segment segment;
+    uint32_t readSize = 0u;
+    ASSERT_NO_THROW(readSize = segment.import(data.data(), data.size()));
+    ASSERT_EQ(readSize, Pgs::Segment::MIN_BYTE_SIZE);
+    ASSERT_EQ(segment.getSegmentType(), Pgs::SegmentType::EndOfDisplaySet);
+}
+
+TEST_F(PgsTest, streamCursorStaysInBounds)
+{
+    const char endSegment[] = {'P', 'G', 0, 0, 0, 1, 0, 0, 0, 1, static_cast<char>(0x80), 0, 0};
+    std::vector<char> data = {'x', 'x', 'x'};
+    data.insert(data.end(), endSegment, endSegment + sizeof(endSegment));
+
+    Pgs::StreamCursor cursor(data.data(), data.size());
+    ASSERT_FALSE(cursor.advance(data.size() + 1));
+    ASSERT_EQ(cursor.getPosition(), 0u);
+    ASSERT_TRUE(cursor.seekNextSegment());
+    ASSERT_EQ(cursor.getPosition(), 3u);
+    ASSERT_EQ(cursor.getRemaining(), sizeof(endSegment));
+
+    const auto limited = cursor.limit(5u);
+    ASSERT_EQ(limited.getPosition(), 3u);
+    ASSERT_EQ(limited.getSize(), 8u);
+    ASSERT_EQ(cursor.limit(UINT64_MAX).getSize(), data.size());
+
+    ASSERT_TRUE(cursor.advance(sizeof(endSegment)));
+    ASSERT_TRUE(cursor.atEnd());
+    ASSERT_FALSE(cursor.seekNextSegment());
+    ASSERT_FALSE(cursor.seek(data.size() + 1));
+    ASSERT_TRUE(cursor.seek(0u));
+}
+
+// =========
+// RLE Tests
+// =========
+
+TEST_F(PgsTest, findRunLengthAtEveryLength)
+{
+    for (size_t length = 1u; length < 100u; ++length)
+    {
+        std::vector<uint8_t> data(length, 7u);
+        data.push_back(8u);
+        data.push_back(7u);
+        ASSERT_EQ(Pgs::findRunLength(data.data(), data.size()), length);
+        ASSERT_EQ(Pgs::findRunLength(data.data(), length), length);
+    }
+    ASSERT_EQ(Pgs::findRunLength(nullptr, 10u), 0u);
+}
+
+TEST_F(PgsTest, encodeUsesShortestCodes)
+{
+    const auto encode = [](const std::vector<uint8_t> &line) {
+        return Pgs::ObjectDefinition::encodeObjectData(line.data(), line.size(), 1u, line.size());
+    };
+
+    ASSERT_EQ(encode({5}), std::vector<uint8_t>({5, 0, 0}));
+    ASSERT_EQ(encode({5, 5}), std::vector<uint8_t>({5, 5, 0, 0}));
+    ASSERT_EQ(encode({5, 5, 5}), std::vector<uint8_t>({0, 0x83, 5, 0, 0}));
+    ASSERT_EQ(encode({0}), std::vector<uint8_t>({0, 1, 0, 0}));
+    ASSERT_EQ(encode(std::vector<uint8_t>(70, 0)), std::vector<uint8_t>({0, 0x40, 70, 0, 0}));
+    ASSERT_EQ(encode(std::vector<uint8_t>(300, 9)), std::vector<uint8_t>({0, 0xC1, 0x2C, 9, 0, 0}));
+    ASSERT_EQ(encode(std::vector<uint8_t>(0x4000, 0)), std::vector<uint8_t>({0, 0x7F, 0xFF, 0, 1, 0, 0}));
+}
+
+TEST_F(PgsTest, encodeDecodeRoundTrip)
+{
+    const uint16_t width = 1000u, height = 40u;
+    std::vector<uint8_t> pixels(width * height);
+    uint32_t state = 12345u;
+    for (size_t i = 0u; i < pixels.size(); ++i)
+    {
+        // Mix of long runs, short runs and noise.
+        state = state * 1103515245u + 12345u;
+        const uint16_t x = i % width;
+        pixels[i] = x < 300u ? 0u : x < 600u ? static_cast<uint8_t>(i / width) : static_cast<uint8_t>((state >> 16u) % 4u);
+    }
+
+    const auto encoded = Pgs::ObjectDefinition::encodeObjectData(pixels.data(), width, height, width);
+    const auto decoded = Pgs::ObjectDefinition::decodeObjectData(encoded, width, height);
+    ASSERT_EQ(decoded.size(), height);
+    for (uint16_t y = 0u; y < height; ++y)
+    {
+        ASSERT_EQ(decoded[y], std::vector<uint8_t>(pixels.begin() + y * width, pixels.begin() + (y + 1) * width));
+    }
+}
+
+TEST_F(PgsTest, createFragmentsSplitsLargeObjects)
+{
+    // Alternating colors can't be compressed, so this needs more than one segment.
+    const uint16_t width = 400u, height = 400u;
+    std::vector<uint8_t> pixels(width * height);
+    for (size_t i = 0u; i < pixels.size(); ++i)
+    {
+        pixels[i] = static_cast<uint8_t>(1u + (i % 2u));
+    }
+
+    const auto fragments = Pgs::ObjectDefinition::createFragments(3u, 1u, pixels.data(), width, height, width);
+    ASSERT_EQ(fragments.size(), 3u);
+    ASSERT_EQ(fragments[0]->getSequenceFlag(), Pgs::SequenceFlag::First);
+    ASSERT_EQ(fragments[1]->getSequenceFlag(), Pgs::SequenceFlag::Middle);
+    ASSERT_EQ(fragments[2]->getSequenceFlag(), Pgs::SequenceFlag::Last);
+    ASSERT_EQ(fragments[0]->getEncodedObjectData().size(),
+              Pgs::ObjectDefinition::MAX_SEGMENT_DATA_SIZE - Pgs::ObjectDefinition::MIN_BYTE_SIZE);
+    ASSERT_EQ(fragments[0]->getDataLength(), width * height + height * 2u + 4u);
+
+    // Continuation fragments only have the ID, version and sequence flag before their data.
+    const auto &last = fragments[2]->getEncodedObjectData();
+    std::vector<char> segmentData = {0, 3, 1, 0x40};
+    segmentData.insert(segmentData.end(), last.begin(), last.end());
+    Pgs::ObjectDefinition parsed;
+    uint16_t readSize = 0u;
+    ASSERT_EQ(parsed.tryImport(segmentData.data(), segmentData.size(), readSize), Pgs::ParseError::None);
+    ASSERT_EQ(readSize, segmentData.size());
+    ASSERT_EQ(parsed.getEncodedObjectData(), last);
+    ASSERT_FALSE(parsed.isFirstFragment());
+
+    Pgs::ObjectDefinition joined = *fragments[0];
+    joined.appendFragment(*fragments[1]);
+    joined.appendFragment(parsed);
+    ASSERT_EQ(joined.getSequenceFlag(), Pgs::SequenceFlag::Only);
+    const auto decoded = joined.getDecodedObjectData();
+    ASSERT_EQ(decoded.size(), height);
+    ASSERT_EQ(decoded[height - 1], std::vector<uint8_t>(pixels.end() - width, pixels.end()));
+}
+
+// ============
+// Writer Tests
+// ============
+
+TEST_F(PgsTest, writeSegmentsAsImported)
+{
+    const char wdsSegment[] = {'P', 'G', 0x12, 0x34, 0x56, 0x78, 0, 0, 0, 0, 0x17, 0, 10,
+                               1, 3, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08};
+    const char endSegment[] = {'P', 'G', 0, 0, 0, 1, 0, 0, 0, 1, static_cast<char>(0x80), 0, 0};
+
+    std::ostringstream stream;
+    {
+        Pgs::SupWriter writer(stream, 0u);
+        for (const auto &segmentData : {std::vector<char>(wdsSegment, wdsSegment + sizeof(wdsSegment)),
+                                        std::vector<char>(endSegment, endSegment + sizeof(endSegment))})
+        {
+            Pgs::Segment segment;
+            segment.import(segmentData);
+            writer.write(segment);
+        }
+        ASSERT_TRUE(writer.getBuffer().empty());
+        ASSERT_EQ(writer.getBytesWritten(), sizeof(wdsSegment) + sizeof(endSegment));
+    }
+
+    std::string expected(wdsSegment, sizeof(wdsSegment));
+    expected.append(endSegment, sizeof(endSegment));
+    ASSERT_EQ(stream.str(), expected);
+}
+
+TEST_F(PgsTest, retimeSegmentHeadersInPlace)
+{
+    const char endSegment[] = {'P', 'G', 0, 0, 0x03, static_cast<char>(0x84), 0, 0, 0, 0, static_cast<char>(0x80), 0, 0};
+    std::vector<char> data = {'x'};
+    data.insert(data.end(), endSegment, endSegment + sizeof(endSegment));
+    data.insert(data.end(), endSegment, endSegment + sizeof(endSegment));
+    data[sizeof(endSegment) + 1 + 9] = 1; // Second segment has a decoding timestamp of 1.
+
+    // 900 ticks (10ms) * 2 - 100
+    const Pgs::TimeTransform transform(-100, 2u, 1u);
+    ASSERT_EQ(transform.apply(900u), 1700u);
+    ASSERT_EQ(transform.apply(10u), 0u);
+    ASSERT_EQ(transform.applyInPlace(data), 2u);
+
+    Pgs::Segment first, second;
+    first.import(data.data() + 1, sizeof(endSegment));
+    second.import(data.data() + 1 + sizeof(endSegment), sizeof(endSegment));
+    ASSERT_EQ(first.getPresentationTimestamp(), 1700u);
+    ASSERT_EQ(first.getDecodingTimestamp(), 0u);
+    ASSERT_EQ(second.getDecodingTimestamp(), 0u);
+    ASSERT_EQ(data[0], 'x');
+
+    const auto ntscToPal = Pgs::TimeTransform::fromFrameRates(24000u, 1001u, 25u, 1u);
+    ASSERT_EQ(ntscToPal.getNumerator(), 960u);
+    ASSERT_EQ(ntscToPal.getDenominator(), 1001u);
+}
+
+TEST_F(PgsTest, encodeImageFormats)
+{
+    const std::vector<uint8_t> pixels = {10, 20, 30, 255, 10, 20, 30, 255};
+
+    const auto qoi = Pgs::ImageWriter::encode(pixels.data(), 2u, 1u, Pgs::ImageFormat::QOI);
+    const std::vector<uint8_t> expectedQoi = {'q', 'o', 'i', 'f', 0, 0, 0, 2, 0, 0, 0, 1, 4, 0,
+                                              0xFE, 10, 20, 30, 0xC0, 0, 0, 0, 0, 0, 0, 0, 1};
+    ASSERT_EQ(qoi, expectedQoi);
+
+    const auto pam = Pgs::ImageWriter::encode(pixels.data(), 2u, 1u, Pgs::ImageFormat::PAM);
+    const std::string pamHeader = "P7\nWIDTH 2\nHEIGHT 1\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+    ASSERT_EQ(pam.size(), pamHeader.size() + pixels.size());
+    ASSERT_TRUE(std::equal(pamHeader.begin(), pamHeader.end(), pam.begin()));
+    ASSERT_TRUE(std::equal(pixels.begin(), pixels.end(), pam.end() - pixels.size()));
+
+    // Signature, IHDR, IDAT holding one stored block with the filtered row, and IEND.
+    const auto png = Pgs::ImageWriter::encode(pixels.data(), 2u, 1u, Pgs::ImageFormat::PNG);
+    ASSERT_EQ(png.size(), 8u + 25u + 12u + 2u + 5u + 9u + 4u + 12u);
+    ASSERT_TRUE(std::equal(png.begin() + 12, png.begin() + 16, "IHDR"));
+    ASSERT_TRUE(std::equal(png.begin() + 37, png.begin() + 41, "IDAT"));
+    const std::vector<uint8_t> storedBlock = {0x78, 0x01, 1, 9, 0, 0xF6, 0xFF, 0};
+    ASSERT_TRUE(std::equal(storedBlock.begin(), storedBlock.end(), png.begin() + 41));
+    ASSERT_TRUE(std::equal(pixels.begin(), pixels.end(), png.begin() + 49));
+    const std::vector<uint8_t> iend = {0, 0, 0, 0, 'I', 'E', 'N', 'D', 0xAE, 0x42, 0x60, 0x82};
+    ASSERT_TRUE(std::equal(iend.begin(), iend.end(), png.end() - 12));
+}
+
+TEST_F(PgsTest, formatBdnTimecodes)
+{
+    ASSERT_EQ(Pgs::BdnExporter::toTimecode(0u, 0x10u), "00:00:00:00");
+    ASSERT_EQ(Pgs::BdnExporter::toTimecode(3661u * 90000u + 45045u, 0x10u), "01:01:01:12");
+    ASSERT_EQ(Pgs::BdnExporter::toTimecode(89999u, 0x30u), "00:00:00:24");
+    ASSERT_EQ(Pgs::BdnExporter::toTimecode(90000u + 3600u, 0x30u), "00:00:01:01");
+}
+
+TEST_F(PgsTest, extractMatroskaTrack)
+{
+    using Bytes = std::vector<uint8_t>;
+    auto element = [](const Bytes &id, const std::initializer_list<Bytes> &children) {
+        Bytes out(id);
+        size_t size = 0;
+        for (const auto &child : children)
+        {
+            size += child.size();
+        }
+        // 8 byte size, so that positions don't depend on the element sizes.
+        out.push_back(0x01);
+        for (int shift = 48; shift >= 0; shift -= 8)
+        {
+            out.push_back(static_cast<uint8_t>(size >> shift));
+        }
+        for (const auto &child : children)
+        {
+            out.insert(out.end(), child.begin(), child.end());
+        }
+        return out;
+    };
+    auto text = [](const std::string &value) { return Bytes(value.begin(), value.end()); };
+
+    // A PCS and an END segment without their magic number and timestamps.
+    const Bytes frame = {0x16, 0, 11, 0x07, 0x80, 0x04, 0x38, 0x10, 0, 1, 0x80, 0, 0, 0, 0x80, 0, 0};
+
+    const auto info = element({0x15, 0x49, 0xA9, 0x66}, {element({0x2A, 0xD7, 0xB1}, {{0x0F, 0x42, 0x40}})});
+    const auto tracks = element({0x16, 0x54, 0xAE, 0x6B},
+                                {element({0xAE}, {element({0xD7}, {{1}}), element({0x86}, {text("V_MPEG4/ISO/AVC")})}),
+                                 element({0xAE}, {element({0xD7}, {{2}}), element({0x86}, {text("S_HDMV/PGS")}),
+                                                  element({0x22, 0xB5, 0x9C}, {text("ger")}),
+                                                  element({0x55, 0xAA}, {{1}})})});
+    auto cues = element({0x1C, 0x53, 0xBB, 0x6B},
+                        {element({0xBB}, {element({0xB3}, {{0}}),
+                                          element({0xB7}, {element({0xF7}, {{2}}),
+                                                           element({0xF1}, {{0, 0, 0, 0, 0, 0, 0, 0}})})})});
+    const auto clusterPosition = info.size() + tracks.size() + cues.size();
+    cues.back() = static_cast<uint8_t>(clusterPosition);
+    cues[cues.size() - 2] = static_cast<uint8_t>(clusterPosition >> 8);
+
+    // Cluster at 2s with a video block, a SimpleBlock at +500ms and a BlockGroup at -1000ms.
+    Bytes simpleBlock = {0x82, 0x01, 0xF4, 0x80};
+    simpleBlock.insert(simpleBlock.end(), frame.begin(), frame.end());
+    Bytes block = {0x82, 0xFC, 0x18, 0x00};
+    block.insert(block.end(), frame.begin(), frame.end());
+    const auto cluster = element({0x1F, 0x43, 0xB6, 0x75},
+                                 {element({0xE7}, {{0x07, 0xD0}}), element({0xA3}, {{0x81, 0, 0, 0x80, 1, 2, 3, 4}}),
+                                  element({0xA3}, {simpleBlock}), element({0xA0}, {element({0xA1}, {block})})});
+
+    const auto header = element({0x1A, 0x45, 0xDF, 0xA3}, {element({0x42, 0x82}, {text("matroska")})});
+    const auto segment = element({0x18, 0x53, 0x80, 0x67}, {info, tracks, cues, cluster});
+    std::string file(header.begin(), header.end());
+    file.append(segment.begin(), segment.end());
+
+    std::istringstream stream(file);
+    Pgs::MatroskaReader reader(stream);
+    ASSERT_EQ(reader.getTimestampScale(), 1000000u);
+    ASSERT_EQ(reader.getTracks().size(), 1u);
+    ASSERT_EQ(reader.getTracks()[0].getNumber(), 2u);
+    ASSERT_EQ(reader.getTracks()[0].getLanguage(), "ger");
+    ASSERT_TRUE(reader.getTracks()[0].isForced());
+    ASSERT_EQ(reader.getTracks()[0].getCompressionAlgorithm(), Pgs::MatroskaTrack::NO_COMPRESSION);
+    ASSERT_THROW(reader.extract(1u), Pgs::ImportException);
+    ASSERT_EQ(reader.extract(2u), reader.extract(2u, false));
+
+    for (const bool useCues : {true, false})
+    {
+        const auto sup = reader.extract(2u, useCues);
+        ASSERT_EQ(sup.size(), 2u * (2u * Pgs::Segment::MIN_BYTE_SIZE + 11u));
+
+        Pgs::Segment pcs;
+        pcs.import(sup.data(), sup.size());
+        ASSERT_EQ(pcs.getSegmentType(), Pgs::SegmentType::PresentationComposition);
+        ASSERT_EQ(pcs.getPresentationTimestamp(), 2500u * 90u);
+        ASSERT_EQ(pcs.getSegmentSize(), 11u);
+
+        Pgs::Segment end;
+        end.import(sup.data() + 24, sup.size() - 24u);
+        ASSERT_EQ(end.getSegmentType(), Pgs::SegmentType::EndOfDisplaySet);
+
+        Pgs::Segment second;
+        second.import(sup.data() + 37, sup.size() - 37u);
+        ASSERT_EQ(second.getPresentationTimestamp(), 1000u * 90u);
+    }
+}
+
+TEST_F(PgsTest, demuxTransportStream)
+{
+    using Bytes = std::vector<uint8_t>;
+    // 192 byte BDAV packets, filled up with adaptation field stuffing.
+    auto packet = [](const uint16_t &pid, const bool &unitStart, const uint8_t &counter, const Bytes &payload) {
+        Bytes out = {0, 0, 0, 0, 0x47, static_cast<uint8_t>((unitStart ? 0x40 : 0) | pid >> 8),
+                     static_cast<uint8_t>(pid), static_cast<uint8_t>(0x10 | counter)};
+        const size_t stuffing = 184 - payload.size();
+        if (stuffing > 0)
+        {
+            out[7] |= 0x20;
+            out.push_back(static_cast<uint8_t>(stuffing - 1));
+            if (stuffing > 1)
+            {
+                out.push_back(0);
+                out.insert(out.end(), stuffing - 2, 0xFF);
+            }
+        }
+        out.insert(out.end(), payload.begin(), payload.end());
+        return out;
+    };
+    auto pes = [](const uint32_t &pts, const Bytes &segments) {
+        const size_t length = segments.size() + 8;
+        Bytes out = {0, 0, 1, 0xBD, static_cast<uint8_t>(length >> 8), static_cast<uint8_t>(length), 0x81, 0x80, 5,
+                     static_cast<uint8_t>(0x21 | (pts >> 29 & 0x0E)), static_cast<uint8_t>(pts >> 22),
+                     static_cast<uint8_t>(pts >> 14 | 1), static_cast<uint8_t>(pts >> 7),
+                     static_cast<uint8_t>(pts << 1 | 1)};
+        out.insert(out.end(), segments.begin(), segments.end());
+        return out;
+    };
+
+    // An ODS spread over two packets, with a video packet in between, followed by an END segment.
+    Bytes ods = {0x15, 0x01, 0x2C};
+    ods.resize(3 + 300, 0xAB);
+    const auto first = pes(900000u, ods);
+    const auto end = pes(900000u, {0x80, 0, 0});
+
+    Bytes file;
+    for (const auto &part : {packet(0x1200, true, 0, Bytes(first.begin(), first.begin() + 184)),
+                             packet(0x1011, true, 0, Bytes(184, 0x00)),
+                             packet(0x1200, false, 1, Bytes(first.begin() + 184, first.end())),
+                             packet(0x1201, true, 0, end), packet(0x1200, true, 2, end)})
+    {
+        file.insert(file.end(), part.begin(), part.end());
+    }
+
+    std::istringstream stream(std::string(file.begin(), file.end()));
+    Pgs::TransportStreamReader reader(stream);
+    ASSERT_EQ(reader.getPacketSize(), 192u);
+    ASSERT_THROW(reader.extract(0x1011u), std::invalid_argument);
+
+    const auto sup = reader.extract(0x1200u);
+    ASSERT_EQ(sup.size(), 2u * Pgs::Segment::MIN_BYTE_SIZE + 300u);
+    Pgs::Segment segment;
+    ASSERT_EQ(segment.import(sup.data(), sup.size()), Pgs::Segment::MIN_BYTE_SIZE + 300u);
+    ASSERT_EQ(segment.getSegmentType(), Pgs::SegmentType::ObjectDefinition);
+    ASSERT_EQ(segment.getPresentationTimestamp(), 900000u);
+    ASSERT_EQ(static_cast<uint8_t>(sup[Pgs::Segment::MIN_BYTE_SIZE + 299u]), 0xABu);
+    segment.import(sup.data() + 313, sup.size() - 313u);
+    ASSERT_EQ(segment.getSegmentType(), Pgs::SegmentType::EndOfDisplaySet);
+
+    const auto streams = reader.extractAll();
+    ASSERT_EQ(streams.size(), 2u);
+    ASSERT_EQ(streams.at(0x1200u), sup);
+    ASSERT_EQ(streams.at(0x1201u).size(), Pgs::Segment::MIN_BYTE_SIZE);
+
+    // Losing the second packet drops the ODS, but not the segments after it.
+    file.erase(file.begin() + 2 * 192, file.begin() + 3 * 192);
+    std::istringstream lossyStream(std::string(file.begin(), file.end()));
+    ASSERT_EQ(Pgs::TransportStreamReader(lossyStream).extract(0x1200u).size(), Pgs::Segment::MIN_BYTE_SIZE);
+}
+
+TEST_F(PgsTest, hashBytesMatchesXxh64)
+{
+    std::vector<uint8_t> data(100);
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = static_cast<uint8_t>(i);
+    }
+    const std::string abc = "abc";
+
+    ASSERT_EQ(Pgs::hashBytes(nullptr, 0u), 0xEF46DB3751D8E999u);
+    ASSERT_EQ(Pgs::hashBytes(reinterpret_cast<const uint8_t *>(abc.data()), abc.size()), 0x44BC2CF5AD770999u);
+    ASSERT_EQ(Pgs::hashBytes(data.data(), data.size(), 5u), 0x9C502A83DCB7C69Eu);
+
+    // The same object data gives a different content hash with different dimensions.
+    const std::vector<uint8_t> pixels(16u, 3u);
+    const auto square = Pgs::ObjectDefinition::createFragments(0u, 0u, pixels.data(), 4u, 4u, 4u);
+    const auto wide = Pgs::ObjectDefinition::createFragments(0u, 0u, pixels.data(), 8u, 2u, 8u);
+    const auto copy = Pgs::ObjectDefinition::createFragments(1u, 1u, pixels.data(), 4u, 4u, 4u);
+    ASSERT_EQ(square[0]->getContentHash(), copy[0]->getContentHash());
+    ASSERT_NE(square[0]->getContentHash(), wide[0]->getContentHash());
+}
+
+TEST_F(PgsTest, perceptualHashNearDuplicates)
+{
+    std::array<uint8_t, 256> intensities{};
+    for (size_t i = 0; i < intensities.size(); ++i)
+    {
+        intensities[i] = static_cast<uint8_t>(i);
+    }
+
+    // Brightness rises from left to right, so every cell is darker than its right neighbour.
+    std::vector<std::vector<uint8_t>> image(16, std::vector<uint8_t>(36));
+    for (auto &line : image)
+    {
+        for (size_t x = 0; x < line.size(); ++x)
+        {
+            line[x] = static_cast<uint8_t>(x * 7);
+        }
+    }
+    const auto hash = Pgs::PerceptualHash::compute(image, intensities);
+    ASSERT_EQ(hash, UINT64_MAX);
+    ASSERT_EQ(Pgs::PerceptualHash::compute({}, intensities), 0u);
+
+    // In an evenly lit image narrower than the grid, every filled cell is brighter than the empty cell before it.
+    const std::vector<std::vector<uint8_t>> narrow(8, std::vector<uint8_t>(4, 200u));
+    ASSERT_EQ(Pgs::PerceptualHash::compute(narrow, intensities), 0x5454545454545454u);
+
+    // A few changed pixels keep the hash close, a mirrored image doesn't.
+    auto tweaked = image;
+    tweaked[3][5] = 0;
+    tweaked[9][20] = 255;
+    const auto tweakedHash = Pgs::PerceptualHash::compute(tweaked, intensities);
+    ASSERT_LE(Pgs::PerceptualHash::distance(hash, tweakedHash), 4u);
+
+    auto mirrored = image;
+    for (auto &line : mirrored)
+    {
+        std::reverse(line.begin(), line.end());
+    }
+    const auto mirroredHash = Pgs::PerceptualHash::compute(mirrored, intensities);
+    ASSERT_EQ(mirroredHash, 0u);
+    ASSERT_EQ(Pgs::PerceptualHash::distance(hash, mirroredHash), 64u);
+
+    Pgs::PerceptualHashIndex index;
+    index.insert(hash, 0u);
+    index.insert(mirroredHash, 1u);
+    index.insert(tweakedHash, 2u);
+    ASSERT_EQ(index.getSize(), 3u);
+    auto matches = index.find(hash, 4u);
+    std::sort(matches.begin(), matches.end());
+    ASSERT_EQ(matches, std::vector<uint32_t>({0u, 2u}));
+    ASSERT_EQ(index.find(mirroredHash, 0u), std::vector<uint32_t>({1u}));
+
+    const auto clusters = Pgs::PerceptualHashIndex::cluster({hash, mirroredHash, tweakedHash, mirroredHash}, 4u);
+    ASSERT_EQ(clusters, std::vector<uint32_t>({0u, 1u, 0u, 1u}));
+}
+
+TEST_F(PgsTest, findObjectBoundingBox)
+{
+    // 12x6 image, transparent (index 0) except for a 3x2 block of index 5 and one pixel of index 7.
+    std::vector<uint8_t> pixels(12u * 6u, 0u);
+    for (size_t y = 2; y < 4; ++y)
+    {
+        std::fill_n(pixels.begin() + y * 12 + 4, 3, 5u);
+    }
+    pixels[4 * 12 + 9] = 7u;
+
+    const auto fragments = Pgs::ObjectDefinition::createFragments(0u, 0u, pixels.data(), 12u, 6u, 12u);
+    std::array<bool, 256> transparent{};
+    transparent[0] = true;
+
+    auto box = fragments[0]->getBoundingBox(transparent);
+    ASSERT_EQ(box.x, 4u);
+    ASSERT_EQ(box.y, 2u);
+    ASSERT_EQ(box.width, 6u);
+    ASSERT_EQ(box.height, 3u);
+
+    transparent[7] = true;
+    box = fragments[0]->getBoundingBox(transparent);
+    ASSERT_EQ(box.width, 3u);
+    ASSERT_EQ(box.height, 2u);
+
+    transparent[5] = true;
+    ASSERT_TRUE(fragments[0]->getBoundingBox(transparent).isEmpty());
+
+    // Decoding through the shared run reader is unchanged.
+    const auto decoded = fragments[0]->getDecodedObjectData();
+    for (size_t y = 0; y < 6; ++y)
+    {
+        ASSERT_TRUE(std::equal(decoded[y].begin(), decoded[y].end(), pixels.begin() + y * 12));
+    }
+}
+
+TEST_F(PgsTest, segmentTextLines)
+{
+    // Text line 1 on lines 2-9: a block, an "i" with its dot on line 2, and an accent on line 0 above the block.
+    // Text line 2 on lines 14-16: a diagonal stroke, connected only through corners.
+    std::vector<uint8_t> pixels(24u * 18u, 0u);
+    auto set = [&](const size_t &x, const size_t &y) { pixels[y * 24u + x] = 1u; };
+    for (size_t y = 2; y < 10; ++y)
+    {
+        for (size_t x = 2; x < 6; ++x)
+        {
+            set(x, y);
+        }
+    }
+    set(3, 0);
+    set(4, 0);
+    set(9, 2);
+    for (size_t y = 4; y < 10; ++y)
+    {
+        set(9, y);
+    }
+    set(12, 14);
+    set(13, 15);
+    set(14, 16);
+
+    const auto fragments = Pgs::ObjectDefinition::createFragments(0u, 0u, pixels.data(), 24u, 18u, 24u);
+    std::array<bool, 256> ink{};
+    ink[1] = true;
+    const auto spans = Pgs::ObjectDefinition::findSpans(fragments[0]->getEncodedObjectData(), 24u, 18u, ink);
+    ASSERT_EQ(spans.size(), 19u);
+    ASSERT_EQ(spans[0].x, 3u);
+    ASSERT_EQ(spans[0].width, 2u);
+
+    const Pgs::TextSegmenter segmenter(spans);
+    const auto &lines = segmenter.getLines();
+    ASSERT_EQ(lines.size(), 2u);
+    ASSERT_EQ(lines[0].y, 0u);
+    ASSERT_EQ(lines[0].height, 10u);
+    ASSERT_EQ(lines[0].x, 2u);
+    ASSERT_EQ(lines[0].width, 8u);
+    ASSERT_EQ(lines[1].y, 14u);
+    ASSERT_EQ(lines[1].height, 3u);
+
+    const auto &glyphs = segmenter.getGlyphs();
+    ASSERT_EQ(glyphs.size(), 3u);
+    ASSERT_EQ(segmenter.getGlyphLines(), std::vector<uint32_t>({0u, 0u, 1u}));
+    ASSERT_EQ(glyphs[0].x, 2u);
+    ASSERT_EQ(glyphs[0].y, 0u);
+    ASSERT_EQ(glyphs[0].height, 10u);
+    ASSERT_EQ(glyphs[1].x, 9u);
+    ASSERT_EQ(glyphs[1].y, 2u);
+    ASSERT_EQ(glyphs[1].width, 1u);
+    ASSERT_EQ(glyphs[1].height, 8u);
+    ASSERT_EQ(glyphs[2].width, 3u);
+    ASSERT_EQ(glyphs[2].height, 3u);
+
+    ASSERT_TRUE(Pgs::TextSegmenter(std::vector<Pgs::Span>()).getLines().empty());
+}
+
+TEST_F(PgsTest, blendOntoYuvFrames)
+{
+    // Opaque white on the left half, half transparent color on the right half, and a transparent last line.
+    std::vector<std::vector<uint8_t>> image(4, std::vector<uint8_t>(20, 2u));
+    for (size_t y = 0; y < 3; ++y)
+    {
+        std::fill_n(image[y].begin(), 10, 1u);
+    }
+    std::fill(image[3].begin(), image[3].end(), 0u);
+    std::array<std::array<uint8_t, 4>, 256> colors{};
+    colors[1] = {235u, 128u, 128u, 255u};
+    colors[2] = {16u, 200u, 60u, 128u};
+
+    const uint32_t width = 32u, height = 8u;
+    std::vector<uint8_t> lumaI420(width * height, 100u), uI420(width * height / 4u, 100u), vI420(uI420);
+    std::vector<uint8_t> lumaNv12(lumaI420), uvNv12(width * height / 2u, 100u);
+    std::vector<uint16_t> luma10(width * height, 400u), u10(width * height / 4u, 400u), v10(u10);
+    std::vector<uint16_t> lumaP010(width * height, 400u << 6u), uvP010(width * height / 2u, 400u << 6u);
+
+    auto blend = [&](const Pgs::FrameFormat &format, void *y, void *u, void *v, const size_t &sampleSize) {
+        Pgs::VideoFrame frame = {format, width, height,
+                                 {static_cast<uint8_t *>(y), static_cast<uint8_t *>(u), static_cast<uint8_t *>(v)},
+                                 {width * sampleSize, (v ? width / 2u : width) * sampleSize, width / 2u * sampleSize}};
+        Pgs::FrameBlender::blend(image, colors, frame, 3, 1);
+    };
+    blend(Pgs::FrameFormat::I420, lumaI420.data(), uI420.data(), vI420.data(), 1u);
+    blend(Pgs::FrameFormat::NV12, lumaNv12.data(), uvNv12.data(), nullptr, 1u);
+    blend(Pgs::FrameFormat::I420P10, luma10.data(), u10.data(), v10.data(), 2u);
+    blend(Pgs::FrameFormat::P010, lumaP010.data(), uvP010.data(), nullptr, 2u);
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            uint8_t expected = 100u;
+            if (y >= 1u && y < 4u && x >= 3u && x < 13u)
+            {
+                expected = 235u;
+            }
+            else if (y >= 1u && y < 4u && x >= 13u && x < 23u)
+            {
+                expected = (16u * 129u + 100u * 127u + 128u) >> 8u;
+            }
+            const size_t i = y * width + x;
+            ASSERT_EQ(lumaI420[i], expected);
+            ASSERT_EQ(lumaNv12[i], expected);
+            ASSERT_LE(std::abs(static_cast<int>(luma10[i]) - expected * 4), 4);
+            ASSERT_EQ(lumaP010[i], luma10[i] << 6u);
+        }
+    }
+
+    // Chroma of both layouts matches, and the 10-bit layouts match each other.
+    for (size_t i = 0; i < uI420.size(); ++i)
+    {
+        ASSERT_EQ(uvNv12[i * 2u], uI420[i]);
+        ASSERT_EQ(uvNv12[i * 2u + 1u], vI420[i]);
+        ASSERT_EQ(uvP010[i * 2u], u10[i] << 6u);
+        ASSERT_EQ(uvP010[i * 2u + 1u], v10[i] << 6u);
+        ASSERT_LE(std::abs(static_cast<int>(u10[i]) - uI420[i] * 4), 4);
+    }
+    // The sample covering only the top left image pixel gets a quarter of its alpha.
+    ASSERT_EQ(uI420[1], (128u * 64u + 100u * 192u + 128u) >> 8u);
+    ASSERT_EQ(uI420[0], 100u);
+    ASSERT_EQ(vI420[3 * width / 2u + 3u], 100u);
+
+    Pgs::VideoFrame missingPlane = {Pgs::FrameFormat::I420, width, height, {lumaI420.data(), uI420.data(), nullptr},
+                                    {width, width / 2u, width / 2u}};
+    ASSERT_THROW(Pgs::FrameBlender::blend(image, colors, missingPlane, 0, 0), std::invalid_argument);
+}
+
+TEST_F(PgsTest, blendOntoPackedFrames)
+{
+    // Per line: 3 transparent pixels, 9 opaque red, 13 half transparent green and 3 transparent.
+    std::vector<uint8_t> pixels;
+    for (size_t y = 0; y < 3; ++y)
+    {
+        pixels.insert(pixels.end(), 3, 0u);
+        pixels.insert(pixels.end(), 9, 1u);
+        pixels.insert(pixels.end(), 13, 2u);
+        pixels.insert(pixels.end(), 3, 0u);
+    }
+    const auto fragments = Pgs::ObjectDefinition::createFragments(0u, 0u, pixels.data(), 28u, 3u, 28u);
+    std::array<std::array<uint8_t, 4>, 256> colors{};
+    colors[1] = {255u, 0u, 0u, 255u};
+    colors[2] = {0u, 200u, 0u, 128u};
+
+    // The image starts 5 pixels left of the frame and its last line is below the frame.
+    const uint32_t width = 24u, height = 4u;
+    const size_t stride = width * 4u + 8u;
+    for (const auto &format : {Pgs::PackedFormat::BGRA, Pgs::PackedFormat::RGBA})
+    {
+        std::vector<uint8_t> frame(stride * height, 50u);
+        Pgs::FrameBlender::blendPacked(fragments[0]->getEncodedObjectData(), 28u, 3u, colors, frame.data(), width,
+                                       height, stride, format, -5, 2);
+
+        const size_t red = format == Pgs::PackedFormat::BGRA ? 2u : 0u;
+        for (size_t y = 0; y < height; ++y)
+        {
+            for (size_t x = 0; x < stride; ++x)
+            {
+                const size_t column = x / 4u + 5u, channel = x % 4u;
+                uint8_t expected = 50u;
+                if (y >= 2u && x < width * 4u && column >= 3u && column < 12u)
+                {
+                    expected = channel == red || channel == 3u ? 255u : 0u;
+                }
+                else if (y >= 2u && x < width * 4u && column >= 12u && column < 25u)
+                {
+                    const uint32_t color = channel == 1u ? 200u : channel == 3u ? 255u : 0u;
+                    expected = static_cast<uint8_t>((color * 129u + 128u + 50u * 127u) >> 8u);
+                }
+                ASSERT_EQ(frame[y * stride + x], expected) << "x " << x << " y " << y;
+            }
+        }
+    }
+}
+
 int main(int argc, char *argv[])
 {
     ::testing::InitGoogleTest(&argc, argv);
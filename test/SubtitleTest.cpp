@@ -23,11 +23,31 @@
 #include <omp.h>
 
 #include <src/Subtitle.hpp>
+#include <src/DisplaySetInfo.hpp>
+#include <src/SubtitleEvent.hpp>
+#include <src/EventIndex.hpp>
+#include <src/SupWriter.hpp>
+#include <src/ByteReader.hpp>
+#include <src/ByteWriter.hpp>
+#include <src/TimeTransform.hpp>
+#include <src/StreamEditor.hpp>
+#include <src/StreamOptimizer.hpp>
+#include <src/ImageWriter.hpp>
+#include <src/BdnExporter.hpp>
+#include <src/VobSubWriter.hpp>
+#include <src/DedupIndex.hpp>
+#include <src/PerceptualHash.hpp>
+#include <src/TextSegmenter.hpp>
+#include <src/FrameBlender.hpp>
 #include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
 #include <memory>
 #include <vector>
 #include <filesystem>
 #include <string>
+#include <algorithm>
 
 using std::vector;
 using std::shared_ptr;
@@ -78,7 +98,7 @@ protected:
 
 TEST_F(SubtitleTest, importNullData)
 {
-    uint32_t readPos = 0u;
+    uint64_t readPos = 0u;
     ASSERT_THROW(Pgs::Subtitle::create(nullptr, 0, readPos), Pgs::CreateError);
 }
 
@@ -91,7 +111,7 @@ TEST_F(SubtitleTest, importSmallSubtitle)
     this->shortSUPStream.readsome(data, dataSize);
 
     shared_ptr<Pgs::Subtitle> subtitle;
-    uint32_t readPos = 0u;
+    uint64_t readPos = 0u;
     ASSERT_NO_THROW(subtitle = Pgs::Subtitle::create(data, dataSize, readPos));
     delete[] data;
 
@@ -107,7 +127,7 @@ TEST_F(SubtitleTest, importLargeSubtitle)
     this->shortSUPStream.readsome(data, dataSize);
 
     shared_ptr<Pgs::Subtitle> subtitle;
-    uint32_t readPos = 0u;
+    uint64_t readPos = 0u;
     ASSERT_NO_THROW(subtitle = Pgs::Subtitle::create(data, dataSize, readPos));
     delete[] data;
 
@@ -123,7 +143,7 @@ TEST_F(SubtitleTest, importEmptySubtitle)
     this->shortSUPStream.readsome(data, dataSize);
 
     shared_ptr<Pgs::Subtitle> subtitle;
-    uint32_t readPos = 0u;
+    uint64_t readPos = 0u;
     ASSERT_NO_THROW(subtitle = Pgs::Subtitle::create(data, dataSize, readPos));
     delete[] data;
 
@@ -290,6 +310,945 @@ TEST_F(SubtitleTest, exportSubtitleImagesFull)
     }
 }
 
+TEST_F(SubtitleTest, scanShortSubtitleFile)
+{
+    const auto data = std::unique_ptr<char>(new char[this->shortFileSize]);
+    this->shortSUPStream.readsome(data.get(), this->shortFileSize);
+
+    vector<shared_ptr<Pgs::Subtitle>> subtitles;
+    ASSERT_NO_THROW(subtitles = Pgs::Subtitle::createAll(data.get(), this->shortFileSize));
+
+    vector<Pgs::DisplaySetInfo> displaySets;
+    ASSERT_NO_THROW(displaySets = Pgs::DisplaySetInfo::scanAll(data.get(), this->shortFileSize));
+
+    ASSERT_EQ(displaySets.size(), subtitles.size());
+    for (size_t i = 0; i < displaySets.size(); ++i)
+    {
+        const auto &info = displaySets[i];
+        const auto &sub = subtitles[i];
+        ASSERT_EQ(info.getPresentationTime(), sub->getPresentationTime());
+        ASSERT_EQ(info.containsImage(), sub->containsImage());
+        for (const auto &ods : info.getObjectDefinitions())
+        {
+            ASSERT_TRUE(ods->getEncodedObjectData().empty());
+        }
+        if (sub->containsImage())
+        {
+            ASSERT_EQ(info.getObjectDefinitions()[0]->getWidth(), sub->getOds(0)->getWidth());
+            ASSERT_EQ(info.getObjectDefinitions()[0]->getHeight(), sub->getOds(0)->getHeight());
+        }
+    }
+}
+
+TEST_F(SubtitleTest, importTruncatedFileWithReport)
+{
+    const auto data = std::unique_ptr<char>(new char[this->shortFileSize]);
+    this->shortSUPStream.readsome(data.get(), this->shortFileSize);
+
+    Pgs::ParseReport report;
+    const auto subtitles = Pgs::Subtitle::createAll(data.get(), this->shortFileSize, report);
+    ASSERT_FALSE(report.hasErrors());
+
+    // Cut the stream in the middle of a display set.
+    const auto displaySets = Pgs::DisplaySetInfo::scanAll(data.get(), this->shortFileSize);
+    ASSERT_GE(displaySets.size(), 2u);
+    const auto &lastSet = displaySets.back();
+    const uint32_t truncatedSize = lastSet.getOffset() + lastSet.getSize() - 1;
+
+    vector<shared_ptr<Pgs::Subtitle>> truncated;
+    ASSERT_NO_THROW(truncated = Pgs::Subtitle::createAll(data.get(), truncatedSize, report));
+    ASSERT_EQ(truncated.size(), subtitles.size() - 1);
+    ASSERT_TRUE(report.hasErrors());
+    ASSERT_EQ(report.getDiagnostics().size(), 1u);
+    ASSERT_EQ(report.getDiagnostics()[0].getDisplaySetOffset(), lastSet.getOffset());
+    ASSERT_EQ(report.getDiagnostics()[0].getError(), Pgs::ParseError::IncompleteDisplaySet);
+}
+
+TEST_F(SubtitleTest, writeShortFileRoundTrip)
+{
+    const auto data = std::unique_ptr<char>(new char[this->shortFileSize]);
+    this->shortSUPStream.readsome(data.get(), this->shortFileSize);
+    const auto subtitles = Pgs::Subtitle::createAll(data.get(), this->shortFileSize);
+
+    Pgs::SupWriter writer;
+    ASSERT_NO_THROW(writer.write(subtitles));
+    const auto &written = writer.getBuffer();
+    ASSERT_EQ(written.size(), writer.getBytesWritten());
+
+    Pgs::ParseReport report;
+    const auto reread = Pgs::Subtitle::createAll(reinterpret_cast<const char *>(written.data()), written.size(),
+                                                 report);
+    ASSERT_FALSE(report.hasErrors());
+    ASSERT_EQ(reread.size(), subtitles.size());
+    for (size_t i = 0; i < subtitles.size(); ++i)
+    {
+        const auto &original = subtitles[i];
+        const auto &copy = reread[i];
+        ASSERT_EQ(copy->getPresentationTime(), original->getPresentationTime());
+        ASSERT_EQ(copy->getDecodingTime(), original->getDecodingTime());
+        ASSERT_EQ(copy->getPcs()->getCompositionNumber(), original->getPcs()->getCompositionNumber());
+        ASSERT_EQ(copy->getPcs()->getCompositionObjects().size(), original->getPcs()->getCompositionObjects().size());
+        ASSERT_EQ(copy->containsImage(), original->containsImage());
+        if (original->containsImage())
+        {
+            ASSERT_EQ(copy->getOds(0)->getDecodedObjectData(), original->getOds(0)->getDecodedObjectData());
+        }
+    }
+
+    // Writing the re-read subtitles gives the same bytes again.
+    Pgs::SupWriter secondWriter;
+    secondWriter.write(reread);
+    ASSERT_EQ(secondWriter.getBuffer(), written);
+}
+
+TEST_F(SubtitleTest, retimeShortFile)
+{
+    std::vector<char> data(this->shortFileSize);
+    this->shortSUPStream.readsome(data.data(), this->shortFileSize);
+    const auto subtitles = Pgs::Subtitle::createAll(data.data(), data.size());
+
+    const auto transform = Pgs::TimeTransform::fromFrameRates(24000u, 1001u, 25u, 1u, 90000);
+    ASSERT_GT(transform.applyInPlace(data), subtitles.size());
+
+    const auto retimed = Pgs::Subtitle::createAll(data.data(), data.size());
+    ASSERT_EQ(retimed.size(), subtitles.size());
+    for (size_t i = 0; i < subtitles.size(); ++i)
+    {
+        ASSERT_EQ(retimed[i]->getPresentationTime(), transform.apply(subtitles[i]->getPresentationTime()));
+        ASSERT_EQ(retimed[i]->getNumObjectDefinitions(), subtitles[i]->getNumObjectDefinitions());
+    }
+}
+
+TEST_F(SubtitleTest, cutAndConcatenateShortFile)
+{
+    std::vector<char> data(this->shortFileSize);
+    this->shortSUPStream.readsome(data.data(), this->shortFileSize);
+    const auto displaySets = Pgs::DisplaySetInfo::scanAll(data.data(), data.size());
+    ASSERT_GT(displaySets.size(), 4u);
+
+    // Start the range in the middle of the stream so that the first set has to be promoted.
+    const auto startTime = displaySets[2].getPresentationTime();
+    const auto endTime = displaySets.back().getPresentationTime();
+
+    const auto secondStart = endTime - startTime + 90000u;
+
+    Pgs::StreamEditor editor;
+    const auto firstCount = editor.append(data.data(), data.size(), startTime, endTime, 0u);
+    const auto secondCount = editor.append(data.data(), data.size(), startTime, endTime, secondStart);
+    ASSERT_GT(firstCount, 0u);
+    ASSERT_EQ(firstCount, secondCount);
+
+    const auto &output = editor.getOutput();
+    const auto edited = Pgs::DisplaySetInfo::scanAll(output.data(), output.size());
+    ASSERT_EQ(edited.size(), editor.getNumDisplaySets());
+    ASSERT_EQ(edited.size(), firstCount + secondCount);
+
+    for (size_t i = 0; i < edited.size(); ++i)
+    {
+        ASSERT_EQ(edited[i].getPcs()->getCompositionNumber(), i);
+    }
+    ASSERT_EQ(edited[0].getPcs()->getCompositionState(), Pgs::CompositionState::EpochStart);
+    ASSERT_EQ(edited[firstCount].getPcs()->getCompositionState(), Pgs::CompositionState::EpochStart);
+    ASSERT_LT(edited[firstCount - 1].getPresentationTime(), edited[firstCount].getPresentationTime());
+    ASSERT_EQ(edited[firstCount].getPresentationTime() - edited[0].getPresentationTime(), secondStart);
+
+    const auto subtitles = Pgs::Subtitle::createAll(output.data(), output.size());
+    ASSERT_EQ(subtitles.size(), edited.size());
+}
+
+TEST_F(SubtitleTest, cutInsideEpoch)
+{
+    std::vector<char> data(this->shortFileSize);
+    this->shortSUPStream.readsome(data.data(), this->shortFileSize);
+    const auto displaySets = Pgs::DisplaySetInfo::scanAll(data.data(), data.size());
+    ASSERT_GT(displaySets.size(), 2u);
+    const auto &shown = displaySets[0];
+    const auto &cleared = displaySets[1];
+    ASSERT_TRUE(shown.containsImage());
+    ASSERT_FALSE(cleared.containsImage());
+
+    // Shown, cleared, then shown again by a Normal update holding nothing but a PCS and END.
+    const uint32_t updateTime = cleared.getPresentationTime() + 90000u;
+    const auto pcsSize = 13u + Pgs::Segment::getSegmentSize(data.data() + shown.getOffset(), shown.getSize());
+    std::vector<char> update(data.begin() + shown.getOffset(), data.begin() + shown.getOffset() + pcsSize);
+    update.insert(update.end(), data.begin() + shown.getOffset() + shown.getSize() - 13u,
+                  data.begin() + shown.getOffset() + shown.getSize());
+    for (const auto &segmentStart : {size_t(0u), size_t(pcsSize)})
+    {
+        Pgs::storeBigEndian32(reinterpret_cast<uint8_t *>(update.data() + segmentStart + 2u), updateTime);
+        Pgs::storeBigEndian32(reinterpret_cast<uint8_t *>(update.data() + segmentStart + 6u), updateTime);
+    }
+    update[13u + 7u] = static_cast<char>(Pgs::CompositionState::Normal);
+
+    std::vector<char> stream(data.begin() + shown.getOffset(), data.begin() + cleared.getOffset() + cleared.getSize());
+    stream.insert(stream.end(), update.begin(), update.end());
+    const auto original = Pgs::Subtitle::createAll(stream.data(), stream.size());
+    const uint32_t endTime = updateTime + 45000u;
+
+    // Cutting while the first image is on screen shows it again at the start of the piece.
+    const uint32_t startTime = shown.getPresentationTime() + 45000u;
+    Pgs::StreamEditor whileShown;
+    ASSERT_EQ(whileShown.append(stream.data(), stream.size(), startTime, endTime, 0u), 4u);
+    ASSERT_EQ(whileShown.getNumSkippedDisplaySets(), 0u);
+    const auto &shownOutput = whileShown.getOutput();
+    const auto shownSets = Pgs::DisplaySetInfo::scanAll(shownOutput.data(), shownOutput.size());
+    ASSERT_EQ(shownSets.size(), 4u);
+    ASSERT_EQ(shownSets[0].getPcs()->getCompositionState(), Pgs::CompositionState::EpochStart);
+    ASSERT_EQ(shownSets[0].getPresentationTime(), 0u);
+    ASSERT_EQ(shownSets[1].getPresentationTime(), cleared.getPresentationTime() - startTime);
+    // The object is already held from the first display set, so the update isn't given a copy.
+    ASSERT_EQ(shownSets[2].getPcs()->getCompositionState(), Pgs::CompositionState::Normal);
+    ASSERT_EQ(shownSets[2].getPresentationTime(), updateTime - startTime);
+    ASSERT_TRUE(shownSets[2].getObjectDefinitions().empty());
+    ASSERT_FALSE(shownSets[3].containsImage());
+    ASSERT_EQ(shownSets[3].getPresentationTime(), endTime - startTime);
+
+    const auto shownSubtitles = Pgs::Subtitle::createAll(shownOutput.data(), shownOutput.size());
+    ASSERT_EQ(shownSubtitles[0]->getImage(Pgs::ColorSpace::YCrCb), original[0]->getImage(Pgs::ColorSpace::YCrCb));
+
+    // Cutting right before the update promotes it, along with the windows, palette and object it uses.
+    const uint32_t updateStart = updateTime - 45000u;
+    Pgs::StreamEditor beforeUpdate;
+    ASSERT_EQ(beforeUpdate.append(stream.data(), stream.size(), updateStart, endTime, 0u), 2u);
+    ASSERT_EQ(beforeUpdate.getNumSkippedDisplaySets(), 0u);
+    const auto &updateOutput = beforeUpdate.getOutput();
+    const auto updateSets = Pgs::DisplaySetInfo::scanAll(updateOutput.data(), updateOutput.size());
+    ASSERT_EQ(updateSets.size(), 2u);
+    ASSERT_EQ(updateSets[0].getPcs()->getCompositionState(), Pgs::CompositionState::EpochStart);
+    ASSERT_EQ(updateSets[0].getPresentationTime(), 45000u);
+    ASSERT_TRUE(updateSets[0].getWds());
+    ASSERT_EQ(updateSets[0].getNumPaletteDefinitions(), shown.getNumPaletteDefinitions());
+    ASSERT_EQ(updateSets[0].getObjectDefinitions().size(), shown.getObjectDefinitions().size());
+
+    const auto updateSubtitles = Pgs::Subtitle::createAll(updateOutput.data(), updateOutput.size());
+    ASSERT_EQ(updateSubtitles.size(), 2u);
+    ASSERT_EQ(updateSubtitles[0]->getImage(Pgs::ColorSpace::YCrCb), original[0]->getImage(Pgs::ColorSpace::YCrCb));
+}
+
+TEST_F(SubtitleTest, extractForcedShortFile)
+{
+    std::vector<char> data(this->shortFileSize);
+    this->shortSUPStream.readsome(data.data(), this->shortFileSize);
+    auto displaySets = Pgs::DisplaySetInfo::scanAll(data.data(), data.size());
+
+    // Nothing in the file is forced, so mark the objects of the first shown display set as forced.
+    const auto shown = std::find_if(displaySets.begin(), displaySets.end(), [](const Pgs::DisplaySetInfo &info) {
+        return info.containsImage();
+    });
+    ASSERT_NE(shown, displaySets.end());
+    ASSERT_TRUE(Pgs::StreamEditor::extractForced(data.data(), data.size()).empty());
+
+    const uint64_t firstObjectFlags = shown->getOffset() + 13u + 11u + 3u;
+    data[firstObjectFlags] = static_cast<char>(data[firstObjectFlags] | 0x40);
+
+    const auto forced = Pgs::StreamEditor::extractForced(data.data(), data.size());
+    const auto extracted = Pgs::DisplaySetInfo::scanAll(forced.data(), forced.size());
+    ASSERT_EQ(extracted.size(), 2u);
+    ASSERT_TRUE(extracted[0].containsForcedImage());
+    ASSERT_EQ(extracted[0].getPcs()->getCompositionObjectCount(), 1u);
+    ASSERT_EQ(extracted[0].getPresentationTime(), shown->getPresentationTime());
+    ASSERT_EQ(extracted[0].getPcs()->getCompositionState(), Pgs::CompositionState::EpochStart);
+    ASSERT_FALSE(extracted[1].containsImage());
+    ASSERT_EQ(extracted[1].getPresentationTime(), (shown + 1)->getPresentationTime());
+    ASSERT_EQ(extracted[1].getDecodingTime(), extracted[1].getPresentationTime());
+    ASSERT_TRUE(extracted[1].getWds());
+    ASSERT_EQ(extracted[1].getWds()->getWindowObjects().size(), shown->getWds()->getWindowObjects().size());
+
+    const auto subtitles = Pgs::Subtitle::createAll(forced.data(), forced.size());
+    ASSERT_EQ(subtitles.size(), 2u);
+    ASSERT_EQ(subtitles[0]->getNumObjectDefinitions(), shown->getObjectDefinitions().size());
+}
+
+TEST_F(SubtitleTest, extractForcedNormalUpdate)
+{
+    std::vector<char> data(this->shortFileSize);
+    this->shortSUPStream.readsome(data.data(), this->shortFileSize);
+    const auto displaySets = Pgs::DisplaySetInfo::scanAll(data.data(), data.size());
+    ASSERT_GT(displaySets.size(), 2u);
+    const auto &shown = displaySets[0];
+    const auto &cleared = displaySets[1];
+    ASSERT_TRUE(shown.containsImage());
+    ASSERT_FALSE(cleared.containsImage());
+
+    // A Normal update showing the object of the first display set again, forced, with nothing but a PCS and END.
+    const uint32_t time = cleared.getPresentationTime() + 90000u;
+    const auto pcsSize = 13u + Pgs::Segment::getSegmentSize(data.data() + shown.getOffset(), shown.getSize());
+    std::vector<char> update(data.begin() + shown.getOffset(), data.begin() + shown.getOffset() + pcsSize);
+    update.insert(update.end(), data.begin() + shown.getOffset() + shown.getSize() - 13u,
+                  data.begin() + shown.getOffset() + shown.getSize());
+    for (const auto &segmentStart : {size_t(0u), size_t(pcsSize)})
+    {
+        Pgs::storeBigEndian32(reinterpret_cast<uint8_t *>(update.data() + segmentStart + 2u), time);
+        Pgs::storeBigEndian32(reinterpret_cast<uint8_t *>(update.data() + segmentStart + 6u), time);
+    }
+    update[13u + 7u] = static_cast<char>(Pgs::CompositionState::Normal);
+    update[13u + 11u + 3u] = static_cast<char>(update[13u + 11u + 3u] | 0x40);
+
+    std::vector<char> stream(data.begin() + shown.getOffset(), data.begin() + cleared.getOffset() + cleared.getSize());
+    stream.insert(stream.end(), update.begin(), update.end());
+
+    // The update is promoted to an EpochStart holding the windows, palette and object it uses.
+    Pgs::StreamEditor editor;
+    ASSERT_EQ(editor.appendForced(stream.data(), stream.size()), 1u);
+    ASSERT_EQ(editor.getNumSkippedDisplaySets(), 0u);
+    const auto &forced = editor.getOutput();
+    const auto extracted = Pgs::DisplaySetInfo::scanAll(forced.data(), forced.size());
+    ASSERT_EQ(extracted.size(), 1u);
+    ASSERT_EQ(extracted[0].getPcs()->getCompositionState(), Pgs::CompositionState::EpochStart);
+    ASSERT_EQ(extracted[0].getPresentationTime(), time);
+    ASSERT_TRUE(extracted[0].getWds());
+    ASSERT_EQ(extracted[0].getNumPaletteDefinitions(), shown.getNumPaletteDefinitions());
+    ASSERT_EQ(extracted[0].getObjectDefinitions().size(), shown.getObjectDefinitions().size());
+
+    const auto original = Pgs::Subtitle::createAll(stream.data(), stream.size());
+    const auto subtitles = Pgs::Subtitle::createAll(forced.data(), forced.size());
+    ASSERT_EQ(subtitles.size(), 1u);
+    ASSERT_EQ(subtitles[0]->getImage(Pgs::ColorSpace::YCrCb), original[0]->getImage(Pgs::ColorSpace::YCrCb));
+
+    // Without the earlier definitions, the update can't be shown and is counted as skipped.
+    Pgs::StreamEditor updateOnly;
+    ASSERT_EQ(updateOnly.appendForced(update.data(), update.size()), 0u);
+    ASSERT_EQ(updateOnly.getNumSkippedDisplaySets(), 1u);
+    ASSERT_TRUE(updateOnly.getOutput().empty());
+}
+
+TEST_F(SubtitleTest, optimizeShortFile)
+{
+    std::vector<char> data(this->shortFileSize);
+    this->shortSUPStream.readsome(data.data(), this->shortFileSize);
+    const auto displaySets = Pgs::DisplaySetInfo::scanAll(data.data(), data.size());
+    const auto shown = std::find_if(displaySets.begin(), displaySets.end(), [](const Pgs::DisplaySetInfo &info) {
+        return info.containsImage() && info.getPcs()->getCompositionState() == Pgs::CompositionState::EpochStart;
+    });
+    ASSERT_NE(shown, displaySets.end());
+
+    // Send the shown display set again as an AcquisitionPoint, which the optimizer should reduce to a Normal update.
+    std::vector<char> stream(data.begin() + shown->getOffset(), data.begin() + shown->getOffset() + shown->getSize());
+    stream.insert(stream.end(), stream.begin(), stream.end());
+    stream[shown->getSize() + 13u + 7u] = static_cast<char>(Pgs::CompositionState::AcquisitionPoint);
+
+    Pgs::StreamOptimizer optimizer;
+    Pgs::SupWriter writer;
+    ASSERT_EQ(optimizer.optimize(stream.data(), stream.size(), writer), 2u);
+    ASSERT_EQ(optimizer.getNumConvertedDisplaySets(), 1u);
+    ASSERT_EQ(optimizer.getNumDroppedPalettes(), shown->getNumPaletteDefinitions());
+
+    const auto &buffer = writer.getBuffer();
+    const auto optimized = Pgs::DisplaySetInfo::scanAll(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+    ASSERT_EQ(optimized.size(), 2u);
+    ASSERT_EQ(optimized[1].getPcs()->getCompositionState(), Pgs::CompositionState::Normal);
+    ASSERT_TRUE(optimized[1].getObjectDefinitions().empty());
+    ASSERT_EQ(optimized[1].getNumPaletteDefinitions(), 0u);
+
+    // The whole file has to keep showing the same images.
+    const auto whole = Pgs::StreamOptimizer::optimize(data.data(), data.size());
+    ASSERT_LE(whole.size(), data.size());
+
+    const auto subtitles = Pgs::Subtitle::createAll(data.data(), data.size());
+    const auto optimizedSubtitles = Pgs::Subtitle::createAll(reinterpret_cast<const char *>(whole.data()),
+                                                             whole.size());
+    ASSERT_EQ(optimizedSubtitles.size(), subtitles.size());
+    for (size_t i = 0; i < subtitles.size(); ++i)
+    {
+        if (subtitles[i]->getNumObjectDefinitions() > 0u && optimizedSubtitles[i]->getNumObjectDefinitions() > 0u)
+        {
+            ASSERT_EQ(optimizedSubtitles[i]->getImage(Pgs::ColorSpace::YCrCb),
+                      subtitles[i]->getImage(Pgs::ColorSpace::YCrCb));
+        }
+    }
+}
+
+TEST_F(SubtitleTest, optimizeKeepsAcquisitionPointDefinitions)
+{
+    std::vector<char> data(this->shortFileSize);
+    this->shortSUPStream.readsome(data.data(), this->shortFileSize);
+    const auto displaySets = Pgs::DisplaySetInfo::scanAll(data.data(), data.size());
+    const auto shown = std::find_if(displaySets.begin(), displaySets.end(), [](const Pgs::DisplaySetInfo &info) {
+        return info.getPcs()->getCompositionState() == Pgs::CompositionState::EpochStart &&
+               info.getObjectDefinitions().size() == 2u && info.getPcs()->getCompositionObjectCount() == 2u;
+    });
+    ASSERT_NE(shown, displaySets.end());
+
+    // Send the display set again as an AcquisitionPoint, with its second object given a new ID, so one object is
+    // re-sent unchanged and the other one is new.
+    std::vector<char> resent(data.begin() + shown->getOffset(), data.begin() + shown->getOffset() + shown->getSize());
+    const uint16_t newID = 0x100u;
+    const auto &secondID = shown->getPcs()->getCompositionObjects()[1]->getObjectID();
+    uint64_t readPos = 0u;
+    while (readPos < resent.size())
+    {
+        auto *segment = reinterpret_cast<uint8_t *>(resent.data() + readPos);
+        if (segment[10] == static_cast<uint8_t>(Pgs::SegmentType::ObjectDefinition) &&
+            Pgs::loadBigEndian16(segment + 13u) == secondID)
+        {
+            Pgs::storeBigEndian16(segment + 13u, newID);
+        }
+        readPos += 13u + Pgs::Segment::getSegmentSize(resent.data() + readPos, resent.size() - readPos);
+    }
+    ASSERT_EQ(Pgs::loadBigEndian16(reinterpret_cast<uint8_t *>(resent.data()) + 13u + 11u + 8u), secondID);
+    Pgs::storeBigEndian16(reinterpret_cast<uint8_t *>(resent.data()) + 13u + 11u + 8u, newID);
+    resent[13u + 7u] = static_cast<char>(Pgs::CompositionState::AcquisitionPoint);
+
+    std::vector<char> stream(data.begin() + shown->getOffset(), data.begin() + shown->getOffset() + shown->getSize());
+    stream.insert(stream.end(), resent.begin(), resent.end());
+
+    // Decoding has to be able to start at the AcquisitionPoint, so nothing is left out of it.
+    Pgs::StreamOptimizer optimizer;
+    Pgs::SupWriter writer;
+    ASSERT_EQ(optimizer.optimize(stream.data(), stream.size(), writer), 2u);
+    ASSERT_EQ(optimizer.getNumDroppedObjects(), 0u);
+    ASSERT_EQ(optimizer.getNumDroppedPalettes(), 0u);
+    ASSERT_EQ(optimizer.getNumConvertedDisplaySets(), 0u);
+
+    const auto &buffer = writer.getBuffer();
+    const auto optimized = Pgs::DisplaySetInfo::scanAll(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+    ASSERT_EQ(optimized.size(), 2u);
+    ASSERT_EQ(optimized[1].getPcs()->getCompositionState(), Pgs::CompositionState::AcquisitionPoint);
+    ASSERT_EQ(optimized[1].getObjectDefinitions().size(), 2u);
+    ASSERT_EQ(optimized[1].getNumPaletteDefinitions(), shown->getNumPaletteDefinitions());
+
+    const auto original = Pgs::Subtitle::createAll(resent.data(), resent.size());
+    const auto fromAcquisitionPoint = Pgs::Subtitle::createAll(
+            reinterpret_cast<const char *>(buffer.data()) + optimized[1].getOffset(), optimized[1].getSize());
+    ASSERT_EQ(fromAcquisitionPoint.size(), 1u);
+    ASSERT_EQ(fromAcquisitionPoint[0]->getImage(Pgs::ColorSpace::YCrCb), original[0]->getImage(Pgs::ColorSpace::YCrCb));
+}
+
+TEST_F(SubtitleTest, optimizeKeepsObjectTimingAndBrokenObjects)
+{
+    std::vector<char> data(this->shortFileSize);
+    this->shortSUPStream.readsome(data.data(), this->shortFileSize);
+    const auto displaySets = Pgs::DisplaySetInfo::scanAll(data.data(), data.size());
+    const auto shown = std::find_if(displaySets.begin(), displaySets.end(), [](const Pgs::DisplaySetInfo &info) {
+        return info.containsImage() && info.getPcs()->getCompositionState() == Pgs::CompositionState::EpochStart;
+    });
+    ASSERT_NE(shown, displaySets.end());
+    std::vector<char> stream(data.begin() + shown->getOffset(), data.begin() + shown->getOffset() + shown->getSize());
+
+    const auto findFirstObject = [](const char *set, const uint64_t &size, Pgs::Segment &found) -> uint64_t {
+        uint64_t readPos = 0u;
+        while (readPos < size)
+        {
+            Pgs::Segment segment;
+            uint32_t segmentSize = 0u;
+            if (segment.tryImport(set + readPos, size - readPos, segmentSize) != Pgs::ParseError::None)
+            {
+                break;
+            }
+            if (segment.getSegmentType() == Pgs::SegmentType::ObjectDefinition)
+            {
+                found = segment;
+                return readPos;
+            }
+            readPos += segmentSize;
+        }
+        return size;
+    };
+
+    // Write the objects with a long code per pixel, so the optimizer has to re-encode them.
+    Pgs::SupWriter bloatedWriter;
+    uint64_t readPos = 0u;
+    while (readPos < stream.size())
+    {
+        Pgs::Segment segment;
+        uint32_t segmentSize = 0u;
+        ASSERT_EQ(segment.tryImport(stream.data() + readPos, stream.size() - readPos, segmentSize),
+                  Pgs::ParseError::None);
+        const auto object = std::dynamic_pointer_cast<Pgs::ObjectDefinition>(segment.getData());
+        if (object && object->getSequenceFlag() == Pgs::SequenceFlag::Only)
+        {
+            std::vector<uint8_t> encoded;
+            for (const auto &line : object->getDecodedObjectData())
+            {
+                for (const auto &color : line)
+                {
+                    encoded.insert(encoded.end(), {0u, 0xC0u, 1u, color});
+                }
+                encoded.insert(encoded.end(), {0u, 0u});
+            }
+            for (const auto &fragment : Pgs::ObjectDefinition::createFragments(
+                     object->getId(), object->getVersion(), object->getWidth(), object->getHeight(), encoded))
+            {
+                bloatedWriter.write(*fragment, segment.getPresentationTimestamp(), segment.getDecodingTimestamp());
+            }
+        }
+        else
+        {
+            bloatedWriter.write(stream.data() + readPos, segmentSize);
+        }
+        readPos += segmentSize;
+    }
+    const auto &bloated = bloatedWriter.getBuffer();
+
+    // Re-encoded objects keep the timestamps of their own segments rather than those of the END segment.
+    Pgs::Segment original;
+    const auto objectOffset = findFirstObject(stream.data(), stream.size(), original);
+    ASSERT_LT(objectOffset, stream.size());
+    Pgs::StreamOptimizer reencoder;
+    Pgs::SupWriter reencodedWriter;
+    reencoder.optimize(reinterpret_cast<const char *>(bloated.data()), bloated.size(), reencodedWriter);
+    ASSERT_GT(reencoder.getNumReencodedObjects(), 0u);
+    const auto &reencoded = reencodedWriter.getBuffer();
+    ASSERT_LT(reencoded.size(), bloated.size());
+    Pgs::Segment written;
+    ASSERT_LT(findFirstObject(reinterpret_cast<const char *>(reencoded.data()), reencoded.size(), written),
+              reencoded.size());
+    ASSERT_EQ(written.getPresentationTimestamp(), original.getPresentationTimestamp());
+    ASSERT_EQ(written.getDecodingTimestamp(), original.getDecodingTimestamp());
+
+    // Claiming one more line than the data holds leaves the object incomplete, so it's never dropped or re-encoded.
+    auto &heightHigh = stream[objectOffset + 13u + 9u];
+    auto &heightLow = stream[objectOffset + 13u + 10u];
+    const auto height = static_cast<uint16_t>((static_cast<uint8_t>(heightHigh) << 8u) | static_cast<uint8_t>(heightLow));
+    heightHigh = static_cast<char>((height + 1u) >> 8u);
+    heightLow = static_cast<char>((height + 1u) & 0xFFu);
+    stream.insert(stream.end(), stream.begin(), stream.end());
+    stream[shown->getSize() + 13u + 7u] = static_cast<char>(Pgs::CompositionState::Normal);
+
+    Pgs::StreamOptimizer optimizer;
+    Pgs::SupWriter writer;
+    ASSERT_EQ(optimizer.optimize(stream.data(), stream.size(), writer), 2u);
+    ASSERT_EQ(optimizer.getNumDroppedObjects(), 0u);
+    ASSERT_EQ(optimizer.getNumReencodedObjects(), 0u);
+    const auto &buffer = writer.getBuffer();
+    const auto sets = Pgs::DisplaySetInfo::scanAll(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+    ASSERT_EQ(sets.size(), 2u);
+    ASSERT_EQ(sets[1].getObjectDefinitions().size(), shown->getObjectDefinitions().size());
+}
+
+TEST_F(SubtitleTest, writeShortFileImages)
+{
+    std::vector<char> data(this->shortFileSize);
+    this->shortSUPStream.readsome(data.data(), this->shortFileSize);
+    const auto subtitles = Pgs::Subtitle::createAll(data.data(), data.size());
+    const auto numImages = std::count_if(subtitles.begin(), subtitles.end(),
+                                         [](const std::shared_ptr<Pgs::Subtitle> &subtitle) {
+                                             return subtitle->containsImage();
+                                         });
+    ASSERT_GT(numImages, 0);
+
+    const std::string prefix = "pam_export_";
+    ASSERT_EQ(Pgs::ImageWriter::writeAll(subtitles, prefix, Pgs::ImageFormat::PAM, 4u),
+              static_cast<uint64_t>(numImages));
+
+    for (size_t i = 0; i < subtitles.size(); ++i)
+    {
+        if (!subtitles[i]->containsImage())
+        {
+            continue;
+        }
+
+        std::ostringstream path;
+        path << prefix << std::setw(5) << std::setfill('0') << i << ".pam";
+        std::ifstream image(path.str(), std::ios::binary | std::ios::ate);
+        ASSERT_TRUE(image.is_open());
+
+        uint16_t width, height;
+        const auto pixels = subtitles[i]->getImageData(Pgs::ColorSpace::RGBA, width, height);
+        ASSERT_EQ(pixels.size(), static_cast<size_t>(width) * height * 4u);
+        ASSERT_GT(static_cast<size_t>(image.tellg()), pixels.size());
+
+        image.close();
+        std::remove(path.str().c_str());
+    }
+}
+
+TEST_F(SubtitleTest, exportBdnShortFile)
+{
+    std::vector<char> data(this->shortFileSize);
+    this->shortSUPStream.readsome(data.data(), this->shortFileSize);
+    const auto events = Pgs::SubtitleEvent::deriveAll(Pgs::DisplaySetInfo::scanAll(data.data(), data.size()));
+    const auto numClosed = std::count_if(events.begin(), events.end(), [](const Pgs::SubtitleEvent &event) {
+        return !event.isOpen();
+    });
+
+    std::ostringstream xml;
+    const Pgs::BdnExporter exporter("Short", "eng", 2u);
+    const auto numExported = exporter.write(data.data(), data.size(), xml, ".");
+    ASSERT_GT(numExported, 0u);
+    ASSERT_EQ(numExported, static_cast<uint64_t>(numClosed));
+
+    const auto document = xml.str();
+    ASSERT_NE(document.find("NumberofEvents=\"" + std::to_string(numExported) + "\""), std::string::npos);
+    ASSERT_NE(document.find("</BDN>"), std::string::npos);
+
+    for (uint64_t i = 0; i < numExported; ++i)
+    {
+        std::ostringstream name;
+        name << std::setw(5) << std::setfill('0') << i << ".png";
+        ASSERT_NE(document.find(">" + name.str() + "</Graphic>"), std::string::npos);
+
+        std::ifstream image(name.str(), std::ios::binary);
+        ASSERT_TRUE(image.is_open());
+        image.close();
+        std::remove(name.str().c_str());
+    }
+}
+
+TEST_F(SubtitleTest, writeVobSubShortFile)
+{
+    std::vector<char> data(this->shortFileSize);
+    this->shortSUPStream.readsome(data.data(), this->shortFileSize);
+
+    std::ostringstream idx, sub;
+    const Pgs::VobSubWriter writer("en", 2u);
+    const auto numSubpictures = writer.write(data.data(), data.size(), idx, sub);
+    ASSERT_GT(numSubpictures, 0u);
+
+    // Every subpicture starts a new 2048 byte pack, which the idx file points at.
+    const auto packs = sub.str();
+    ASSERT_EQ(packs.size() % Pgs::VobSubWriter::PACK_SIZE, 0u);
+    for (size_t pos = 0; pos < packs.size(); pos += Pgs::VobSubWriter::PACK_SIZE)
+    {
+        ASSERT_EQ(packs.compare(pos, 4, std::string("\0\0\1\xBA", 4)), 0);
+    }
+
+    std::istringstream index(idx.str());
+    std::string line;
+    uint64_t numTimestamps = 0u;
+    while (std::getline(index, line))
+    {
+        if (line.compare(0, 11, "timestamp: ") == 0)
+        {
+            const auto filePos = std::stoull(line.substr(line.find("filepos: ") + 9u), nullptr, 16);
+            ASSERT_EQ(filePos % Pgs::VobSubWriter::PACK_SIZE, 0u);
+            ASSERT_LT(filePos, packs.size());
+            ASSERT_EQ(static_cast<uint8_t>(packs[filePos + 14u + 7u]) & 0x80u, 0x80u);
+            ++numTimestamps;
+        }
+    }
+    ASSERT_EQ(numTimestamps, numSubpictures);
+}
+
+TEST_F(SubtitleTest, dedupShortFile)
+{
+    std::vector<char> data(this->shortFileSize);
+    this->shortSUPStream.readsome(data.data(), this->shortFileSize);
+
+    const auto subtitles = Pgs::Subtitle::createAll(data.data(), data.size());
+    const Pgs::DedupIndex index(subtitles);
+    ASSERT_EQ(index.getCanonicalIndices().size(), subtitles.size());
+    ASSERT_FALSE(index.getUniqueIndices().empty());
+
+    for (uint32_t i = 0; i < subtitles.size(); ++i)
+    {
+        const auto canonical = index.getCanonicalIndex(i);
+        if (!subtitles[i]->containsImage())
+        {
+            ASSERT_EQ(canonical, Pgs::DedupIndex::NO_INDEX);
+            continue;
+        }
+
+        ASSERT_LE(canonical, i);
+        ASSERT_EQ(index.getCanonicalIndex(canonical), canonical);
+        ASSERT_EQ(index.getHashes()[i], subtitles[i]->getContentHash());
+        ASSERT_EQ(subtitles[canonical]->decodeImage(), subtitles[i]->decodeImage());
+    }
+
+    // Every unique image is canonical for itself, and no two of them are the same image.
+    for (const auto &unique : index.getUniqueIndices())
+    {
+        ASSERT_EQ(index.getCanonicalIndex(unique), unique);
+    }
+    ASSERT_THROW((void) index.getCanonicalIndex(static_cast<uint32_t>(subtitles.size())), std::out_of_range);
+
+    const Pgs::DedupIndex paletteIndex(subtitles, true);
+    ASSERT_GE(paletteIndex.getUniqueIndices().size(), index.getUniqueIndices().size());
+}
+
+TEST_F(SubtitleTest, perceptualHashShortFile)
+{
+    std::vector<char> data(this->shortFileSize);
+    this->shortSUPStream.readsome(data.data(), this->shortFileSize);
+
+    const auto subtitles = Pgs::Subtitle::createAll(data.data(), data.size());
+    const Pgs::DedupIndex dedupIndex(subtitles);
+
+    std::vector<uint64_t> hashes;
+    std::vector<uint32_t> imageIndices;
+    for (uint32_t i = 0; i < subtitles.size(); ++i)
+    {
+        if (subtitles[i]->containsImage())
+        {
+            hashes.push_back(Pgs::PerceptualHash::compute(*subtitles[i]));
+            imageIndices.push_back(i);
+        }
+    }
+    ASSERT_FALSE(hashes.empty());
+
+    // Identical images always share a cluster, so there are at most as many clusters as unique images.
+    const auto clusters = Pgs::PerceptualHashIndex::cluster(hashes, 0u);
+    size_t numClusters = 0u;
+    for (size_t i = 0; i < hashes.size(); ++i)
+    {
+        numClusters += clusters[i] == i ? 1u : 0u;
+        const auto canonical = dedupIndex.getCanonicalIndex(imageIndices[i]);
+        const auto canonicalPosition = std::find(imageIndices.begin(), imageIndices.end(), canonical);
+        ASSERT_EQ(hashes[canonicalPosition - imageIndices.begin()], hashes[i]);
+    }
+    ASSERT_LE(numClusters, dedupIndex.getUniqueIndices().size());
+}
+
+TEST_F(SubtitleTest, ocrMasksShortFile)
+{
+    std::vector<char> data(this->shortFileSize);
+    this->shortSUPStream.readsome(data.data(), this->shortFileSize);
+
+    for (const auto &subtitle : Pgs::Subtitle::createAll(data.data(), data.size()))
+    {
+        uint16_t width, height;
+        if (!subtitle->containsImage())
+        {
+            ASSERT_THROW((void) subtitle->getMask(Pgs::MaskFormat::Binary8, width, height), std::runtime_error);
+            continue;
+        }
+
+        const auto binary = subtitle->getMask(Pgs::MaskFormat::Binary8, width, height);
+        ASSERT_EQ(binary.size(), static_cast<size_t>(width) * height);
+        const auto numText = static_cast<size_t>(std::count(binary.begin(), binary.end(), 0u));
+        ASSERT_EQ(numText + std::count(binary.begin(), binary.end(), 255u), binary.size());
+        // The outline and background are dropped, the fill is kept.
+        ASSERT_GT(numText, 0u);
+        ASSERT_LT(numText, binary.size());
+
+        const auto bits = subtitle->getMask(Pgs::MaskFormat::Binary1, width, height);
+        const size_t stride = (width + 7u) / 8u;
+        ASSERT_EQ(bits.size(), stride * height);
+        for (size_t y = 0; y < height; ++y)
+        {
+            for (size_t x = 0; x < width; ++x)
+            {
+                const bool isText = bits[y * stride + x / 8u] & (0x80u >> (x % 8u));
+                ASSERT_EQ(isText, binary[y * width + x] == 0u);
+            }
+        }
+
+        // Text fill is the darkest part of the grayscale mask.
+        const auto gray = subtitle->getMask(Pgs::MaskFormat::Gray8, width, height);
+        ASSERT_EQ(gray.size(), binary.size());
+        ASSERT_EQ(*std::min_element(gray.begin(), gray.end()), 0u);
+        for (size_t i = 0; i < gray.size(); ++i)
+        {
+            if (gray[i] == 0u)
+            {
+                ASSERT_EQ(binary[i], 0u);
+            }
+        }
+    }
+}
+
+TEST_F(SubtitleTest, boundingBoxShortFile)
+{
+    std::vector<char> data(this->shortFileSize);
+    this->shortSUPStream.readsome(data.data(), this->shortFileSize);
+
+    for (const auto &subtitle : Pgs::Subtitle::createAll(data.data(), data.size()))
+    {
+        const auto box = subtitle->getBoundingBox();
+        if (!subtitle->containsImage())
+        {
+            ASSERT_TRUE(box.isEmpty());
+            continue;
+        }
+
+        // Every pixel outside of the box is transparent, and every edge of the box touches a visible pixel.
+        uint16_t width, height;
+        const auto image = subtitle->getImageData(Pgs::ColorSpace::RGBA, width, height);
+        ASSERT_FALSE(box.isEmpty());
+        ASSERT_LE(box.x + box.width, width);
+        ASSERT_LE(box.y + box.height, height);
+
+        uint16_t left = width, right = 0u, top = height, bottom = 0u;
+        for (uint16_t y = 0; y < height; ++y)
+        {
+            for (uint16_t x = 0; x < width; ++x)
+            {
+                if (image[(static_cast<size_t>(y) * width + x) * 4u + 3u] != 0u)
+                {
+                    left = std::min(left, x);
+                    right = std::max(right, static_cast<uint16_t>(x + 1u));
+                    top = std::min(top, y);
+                    bottom = static_cast<uint16_t>(y + 1u);
+                }
+            }
+        }
+        ASSERT_EQ(box.x, left);
+        ASSERT_EQ(box.y, top);
+        ASSERT_EQ(box.width, right - left);
+        ASSERT_EQ(box.height, bottom - top);
+    }
+}
+
+TEST_F(SubtitleTest, segmentTextShortFile)
+{
+    std::vector<char> data(this->shortFileSize);
+    this->shortSUPStream.readsome(data.data(), this->shortFileSize);
+
+    for (const auto &subtitle : Pgs::Subtitle::createAll(data.data(), data.size()))
+    {
+        if (!subtitle->containsImage())
+        {
+            ASSERT_TRUE(subtitle->getTextSpans().empty());
+            continue;
+        }
+
+        // The spans hold exactly the text pixels of the binary mask.
+        uint16_t width, height;
+        const auto mask = subtitle->getMask(Pgs::MaskFormat::Binary8, width, height);
+        const auto spans = subtitle->getTextSpans();
+        size_t numSpanPixels = 0u;
+        for (const auto &span : spans)
+        {
+            numSpanPixels += span.width;
+            for (size_t x = span.x; x < span.x + span.width; ++x)
+            {
+                ASSERT_EQ(mask[span.y * width + x], 0u);
+            }
+        }
+        ASSERT_EQ(numSpanPixels, static_cast<size_t>(std::count(mask.begin(), mask.end(), 0u)));
+
+        // Every glyph lies within its text line, and lines don't overlap.
+        const Pgs::TextSegmenter segmenter(*subtitle);
+        const auto &lines = segmenter.getLines();
+        const auto &glyphs = segmenter.getGlyphs();
+        ASSERT_FALSE(lines.empty());
+        ASSERT_GE(glyphs.size(), lines.size());
+        for (size_t i = 1; i < lines.size(); ++i)
+        {
+            ASSERT_GE(lines[i].y, lines[i - 1].y + lines[i - 1].height);
+        }
+        for (size_t i = 0; i < glyphs.size(); ++i)
+        {
+            const auto &line = lines[segmenter.getGlyphLines()[i]];
+            ASSERT_GE(glyphs[i].x, line.x);
+            ASSERT_GE(glyphs[i].y, line.y);
+            ASSERT_LE(glyphs[i].x + glyphs[i].width, line.x + line.width);
+            ASSERT_LE(glyphs[i].y + glyphs[i].height, line.y + line.height);
+        }
+    }
+}
+
+TEST_F(SubtitleTest, blendPackedShortFile)
+{
+    std::vector<char> data(this->shortFileSize);
+    this->shortSUPStream.readsome(data.data(), this->shortFileSize);
+
+    // Blending from runs gives the same frame as blending the decoded image pixel by pixel.
+    for (const auto &subtitle : Pgs::Subtitle::createAll(data.data(), data.size()))
+    {
+        if (!subtitle->containsImage())
+        {
+            continue;
+        }
+
+        uint16_t width, height;
+        const auto image = subtitle->getImageData(Pgs::ColorSpace::RGBA, width, height);
+        const uint32_t frameWidth = width + 16u, frameHeight = height + 8u;
+        std::vector<uint8_t> frame(static_cast<size_t>(frameWidth) * frameHeight * 4u, 30u);
+        Pgs::FrameBlender::blendPacked(*subtitle, frame.data(), frameWidth, frameHeight, frameWidth * 4u,
+                                       Pgs::PackedFormat::BGRA, 8, 4);
+
+        for (uint32_t y = 0; y < frameHeight; ++y)
+        {
+            for (uint32_t x = 0; x < frameWidth; ++x)
+            {
+                std::array<uint8_t, 4> expected = {30u, 30u, 30u, 30u};
+                if (x >= 8u && x < 8u + width && y >= 4u && y < 4u + height)
+                {
+                    const uint8_t *color = image.data() + ((y - 4u) * width + (x - 8u)) * 4u;
+                    const uint32_t weight = color[3] + (color[3] >> 7u);
+                    const std::array<uint8_t, 4> bgra = {color[2], color[1], color[0], 255u};
+                    for (size_t channel = 0; channel < 4u; ++channel)
+                    {
+                        expected[channel] = color[3] == 0u ? 30u : static_cast<uint8_t>(
+                                (bgra[channel] * weight + 30u * (256u - weight) + 128u) >> 8u);
+                    }
+                }
+                const uint8_t *pixel = frame.data() + (static_cast<size_t>(y) * frameWidth + x) * 4u;
+                ASSERT_TRUE(std::equal(expected.begin(), expected.end(), pixel)) << "x " << x << " y " << y;
+            }
+        }
+        break;
+    }
+}
+
+TEST_F(SubtitleTest, deriveEventsShortFile)
+{
+    const auto data = std::unique_ptr<char>(new char[this->shortFileSize]);
+    this->shortSUPStream.readsome(data.get(), this->shortFileSize);
+
+    const auto subtitles = Pgs::Subtitle::createAll(data.get(), this->shortFileSize);
+    const auto displaySets = Pgs::DisplaySetInfo::scanAll(data.get(), this->shortFileSize);
+
+    const auto events = Pgs::SubtitleEvent::deriveAll(displaySets);
+    const auto subtitleEvents = Pgs::SubtitleEvent::deriveAll(subtitles);
+    ASSERT_EQ(events.size(), subtitleEvents.size());
+
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        const auto &event = events[i];
+        ASSERT_EQ(event.getStartTime(), subtitleEvents[i].getStartTime());
+        ASSERT_EQ(event.getEndTime(), subtitleEvents[i].getEndTime());
+        ASSERT_TRUE(displaySets[event.getStartIndex()].containsImage());
+        if (!event.isOpen())
+        {
+            ASSERT_GT(event.getEndIndex(), event.getStartIndex());
+            ASSERT_EQ(event.getEndTime(), displaySets[event.getEndIndex()].getPresentationTime());
+            ASSERT_EQ(event.getDuration(), event.getEndTime() - event.getStartTime());
+        }
+        if (i > 0)
+        {
+            ASSERT_LE(events[i - 1].getStartTime(), event.getStartTime());
+        }
+    }
+}
+
+TEST_F(SubtitleTest, queryEventIndexFullFile)
+{
+    const auto data = std::unique_ptr<char>(new char[this->fullFileSize]);
+    this->fullSUPStream.readsome(data.get(), this->fullFileSize);
+
+    const auto displaySets = Pgs::DisplaySetInfo::scanAll(data.get(), this->fullFileSize);
+    const Pgs::EventIndex index(displaySets);
+    const auto &events = index.getEvents();
+    ASSERT_FALSE(events.empty());
+
+    const uint32_t lastTime = displaySets.back().getPresentationTime();
+    const uint32_t step = std::max<uint32_t>(lastTime / 997u, 1u);
+    for (uint32_t time = 0u; time <= lastTime + step; time += step)
+    {
+        auto expected = vector<uint32_t>();
+        auto expectedRange = vector<uint32_t>();
+        for (uint32_t i = 0u; i < events.size(); ++i)
+        {
+            if (events[i].getStartTime() <= time && time < events[i].getEndTime())
+            {
+                expected.push_back(i);
+            }
+            if (events[i].getStartTime() < time + step && time < events[i].getEndTime() &&
+                events[i].getStartTime() < events[i].getEndTime())
+            {
+                expectedRange.push_back(i);
+            }
+        }
+
+        auto found = index.findAt(time);
+        std::sort(found.begin(), found.end());
+        ASSERT_EQ(found, expected);
+
+        auto foundRange = index.findInRange(time, time + step);
+        std::sort(foundRange.begin(), foundRange.end());
+        ASSERT_EQ(foundRange, expectedRange);
+
+        const auto rap = index.findRandomAccessPoint(time);
+        if (rap != Pgs::EventIndex::NO_INDEX)
+        {
+            ASSERT_LE(displaySets[rap].getPresentationTime(), time);
+            ASSERT_NE(displaySets[rap].getPcs()->getCompositionState(), Pgs::CompositionState::Normal);
+        }
+    }
+}
+
 int main(int argc, char *argv[])
 {
     ::testing::InitGoogleTest(&argc, argv);